@@ -0,0 +1,282 @@
+/* Benchmark of the driver hot paths: CPU cycles counted with TIMER1 (no prescaler) */
+
+/* Constraints:
+ * built with the drivers of both projects (HMI: LCD, keypad, UART, TIMERS, Control: EEPROM, hash)
+ * the simulator (bench_sim.c, Host/bench_host.c) answers each line sent on the UART with BENCH_ACK:
+ *   "<name> <runs> <cycles>"	result of a benchmark (cycles of all runs)
+ *   "@key <key>"				hold a keypad key ('-' releases it)
+ *   "@rx <n>"					send n bytes on the UART line (they are the answer)
+ *   "@end"						all results were sent
+ * every call is timed alone (it must take less than 65536 cycles) and the cycles of an empty
+ * measurement are subtracted, the interrupts a call triggers run after its measurement
+ */
+
+
+#include <stdlib.h>
+#include <string.h>
+#include <avr/sleep.h>
+#include "external_eeprom.h"
+#include "hash.h"
+#include "keypad.h"
+#include "lcd.h"
+#include "timers.h"
+#include "uart.h"
+
+
+/* Benchmark configurations */
+#define BENCH_RUNS 8					/* calls timed in each benchmark (less than the UART RX buffer) */
+#define BENCH_ACK '!'					/* answer of the simulator to a key request */
+#define BENCH_EEPROM_ADDRESS 0x7F0		/* scratch page of the EEPROM benchmarks (last page of a 24C16) */
+#define BENCH_ISR_DELAY 200				/* cycles between arming the compare interrupt and its match */
+#define BENCH_PASS_SIZE 5				/* digits of a password (control.c) */
+
+/* Time a call: TIMER1 counts between the start and the end, without the cost of the measurement */
+#define BENCH_TIME(call) do { \
+		uint16 start = TCNT1; \
+		call; \
+		g_cycles += (uint16)(TCNT1 - start) - g_overhead; \
+	} while (0)
+
+
+/* global cycles of the timed calls of the current benchmark and cycles of an empty measurement */
+uint32 g_cycles = 0;
+uint16 g_overhead = 0;
+
+/* global TIMER1 count read by the compare match callback (ISR dispatch benchmark) */
+volatile uint16 g_isr_time;
+volatile bool g_isr_done;
+
+
+void bench_overhead(void);		/* measure the cycles of an empty measurement */
+void bench_uart(void);			/* UART_sendByte, UART_receiveByte */
+void bench_eeprom(void);		/* EEPROM_writeByte, EEPROM_readByte */
+void bench_lcd(void);			/* LCD_displayCharacter, LCD_pump (one LCD_sendData bus write) */
+void bench_keypad(void);		/* Keypad_scan, Keypad_getPressedKey */
+void bench_timers(void);		/* TIMERS_init, ISR dispatch of timers.c */
+void bench_hash(void);			/* HASH_compute of a password (one verification of control.c) */
+void bench_result(const char *name);	/* send the result of a benchmark and start the next one */
+void bench_key(const char key);			/* ask the simulator to hold a key ('-' releases it) */
+void bench_send(const char *line);		/* send a line and wait for the answer of the simulator */
+void bench_wait(const uint8 count);		/* wait until count bytes are received */
+void bench_isr(void);			/* TIMER1 compare B callback function */
+
+
+int main(void) {
+	UART_ConfigType uart_config = {ONE_BIT, DISABLE, BIT_8, INTERRUPT};
+	TIMERS_ConfigType timer1_config = {TIMER1, NORMAL, F_CPU_1, DISCONNECT_OC, 0, 0};
+
+	UART_init(&uart_config);
+	EEPROM_init();
+	LCD_init();
+	Keypad_init();
+	sei();
+
+	/* the free running count wraps, each call is timed alone */
+	TIMERS_init(&timer1_config);
+	CLEAR_BIT(TIMSK,TOIE1);
+	bench_overhead();
+
+	bench_uart();
+	bench_eeprom();
+	bench_lcd();
+	bench_keypad();
+	bench_timers();
+	bench_hash();
+	bench_send("@end\n");
+
+	/* done (if the simulator didn't stop at "@end"): a sleep with the interrupts disabled stops it */
+	cli();
+	sleep_enable();
+	sleep_cpu();
+	return 0;
+}
+
+void bench_overhead(void) {
+	uint8 i;
+	uint16 min = 0xFFFF;
+
+	g_overhead = 0;
+	for (i = 0; i < BENCH_RUNS; i++) {
+		g_cycles = 0;
+		BENCH_TIME();
+		if (g_cycles < min)
+			min = g_cycles;
+	}
+	g_overhead = min;
+	g_cycles = 0;
+}
+
+void bench_uart(void) {
+	char line[8] = "@rx ";
+	uint8 i;
+
+	/* a byte queued in the empty TX buffer (an empty line, answered once it is sent) */
+	for (i = 0; i < BENCH_RUNS; i++) {
+		BENCH_TIME(UART_sendByte('\n'));
+		bench_wait(1);
+		UART_receiveByte();
+	}
+	bench_result("uart_sendByte");
+
+	/* a byte taken from the RX buffer */
+	itoa(BENCH_RUNS, &line[4], 10);
+	strcat(line, "\n");
+	UART_sendString((const uint8 *)line);
+	bench_wait(BENCH_RUNS);
+	for (i = 0; i < BENCH_RUNS; i++)
+		BENCH_TIME(UART_receiveByte());
+	bench_result("uart_receiveByte");
+}
+
+void bench_eeprom(void) {
+	uint8 data;
+	uint8 i;
+
+	/* a byte written after the previous write cycle is done */
+	for (i = 0; i < BENCH_RUNS; i++) {
+		BENCH_TIME(EEPROM_writeByte(BENCH_EEPROM_ADDRESS + i, i));
+		_delay_ms(EEPROM_WRITE_CYCLE_MS);
+	}
+	bench_result("eeprom_writeByte");
+
+	/* a random read */
+	for (i = 0; i < BENCH_RUNS; i++)
+		BENCH_TIME(EEPROM_readByte(BENCH_EEPROM_ADDRESS + i, &data));
+	bench_result("eeprom_readByte");
+}
+
+void bench_lcd(void) {
+	uint8 i;
+
+	/* a character written in the frame buffer */
+	LCD_moveCursorTo(0, 0);
+	for (i = 0; i < BENCH_RUNS; i++)
+		BENCH_TIME(LCD_displayCharacter('A' + i));
+	bench_result("lcd_displayCharacter");
+
+	/* send the frame then one changed character per tick: busy flag read + one LCD_sendData
+	 * (the first character of the second row moves the LCD cursor there before the timed ones) */
+	LCD_moveCursorTo(1, 0);
+	LCD_displayCharacter('0');
+	for (i = 0; i < LCD_ROWS * LCD_COLS; i++) {
+		LCD_pump();
+		_delay_us(LCD_TICK_US);
+	}
+	for (i = 1; i <= BENCH_RUNS; i++) {
+		LCD_displayCharacter('0' + i);
+		BENCH_TIME(LCD_pump());
+		_delay_us(LCD_TICK_US);
+	}
+	bench_result("lcd_pump");
+}
+
+void bench_keypad(void) {
+	uint8 i, j;
+
+	/* a scan of the idle keypad */
+	bench_key('-');
+	for (i = 0; i < BENCH_RUNS; i++)
+		BENCH_TIME(Keypad_scan());
+	bench_result("keypad_scan");
+
+	/* a scan with a key held (the press is reported by the KEYPAD_DEBOUNCE_SCANS-th one) */
+	bench_key('5');
+	for (i = 0; i < BENCH_RUNS; i++)
+		BENCH_TIME(Keypad_scan());
+	bench_result("keypad_scan_held");
+
+	/* a key press waiting in the queue */
+	for (i = 0; i < BENCH_RUNS; i++) {
+		bench_key('-');
+		for (j = 0; j < KEYPAD_DEBOUNCE_SCANS; j++)
+			Keypad_scan();
+		Keypad_clearEvents();
+		bench_key('5');
+		for (j = 0; j < KEYPAD_DEBOUNCE_SCANS; j++)
+			Keypad_scan();
+		BENCH_TIME(Keypad_getPressedKey());
+	}
+	bench_result("keypad_getPressedKey");
+}
+
+void bench_timers(void) {
+	TIMERS_ConfigType timer0_config = {TIMER0, CTC, F_CPU_64, DISCONNECT_OC, 0, 124};
+	uint16 match, end;
+	uint32 back = 0;
+	uint8 i;
+
+	/* the 1 ms tick of the HMI */
+	for (i = 0; i < BENCH_RUNS; i++) {
+		BENCH_TIME(TIMERS_init(&timer0_config));
+		TIMERS_deInit(TIMER0);
+	}
+	bench_result("timers_init");
+
+	/* compare match -> callback (vector, ISR prologue, call through the callback pointer)
+	 * then callback -> back in the interrupted loop (return, ISR epilogue, RETI, loop exit) */
+	TIMERS_setCallBack(TIMER1B, NORMAL, bench_isr);
+	for (i = 0; i < BENCH_RUNS; i++) {
+		g_isr_done = FALSE;
+		SET_BIT(TIFR,OCF1B);
+		match = TCNT1 + BENCH_ISR_DELAY;
+		OCR1B = match;
+		SET_BIT(TIMSK,OCIE1B);
+		while (!g_isr_done);
+		end = TCNT1;
+		CLEAR_BIT(TIMSK,OCIE1B);
+		g_cycles += (uint16)(g_isr_time - match);
+		back += (uint16)(end - g_isr_time);
+	}
+	bench_result("timers_isr_entry");
+	g_cycles = back;
+	bench_result("timers_isr_return");
+}
+
+void bench_hash(void) {
+	uint8 salt[HASH_KEY_SIZE] = {0x3A, 0x91, 0x5C, 0x07, 0xE4, 0x28, 0xB6, 0x6F};
+	uint8 pass[BENCH_PASS_SIZE] = {1, 2, 3, 4, 5};
+	uint8 digest[HASH_SIZE];
+	uint8 i;
+
+	/* the salted hash match_password compares with the saved one */
+	for (i = 0; i < BENCH_RUNS; i++)
+		BENCH_TIME(HASH_compute(salt, pass, BENCH_PASS_SIZE, digest));
+	bench_result("hash_verify");
+}
+
+void bench_result(const char *name) {
+	char line[40];
+
+	strcpy(line, name);
+	strcat(line, " ");
+	itoa(BENCH_RUNS, &line[strlen(line)], 10);
+	strcat(line, " ");
+	ultoa(g_cycles, &line[strlen(line)], 10);
+	strcat(line, "\n");
+	bench_send(line);
+	g_cycles = 0;
+}
+
+void bench_key(const char key) {
+	char line[] = "@key ?\n";
+
+	line[5] = key;
+	bench_send(line);
+}
+
+void bench_send(const char *line) {
+	UART_sendString((const uint8 *)line);
+	do
+		bench_wait(1);
+	while (UART_receiveByte() != BENCH_ACK);
+}
+
+void bench_wait(const uint8 count) {
+	while (UART_getRxCount() < count)
+		_delay_us(100);
+}
+
+void bench_isr(void) {
+	g_isr_time = TCNT1;
+	g_isr_done = TRUE;
+}
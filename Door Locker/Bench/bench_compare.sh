@@ -0,0 +1,38 @@
+#!/bin/sh
+# Compare the results of the driver benchmark with a baseline
+#
+# Usage: bench_compare.sh <baseline> <results> [tolerance %]
+# compares the "<name>_cycles:" lines, prints the change of each benchmark and fails (exit 1)
+# when one is slower than the baseline by more than the tolerance (default 5%) OR is missing
+
+if [ $# -lt 2 ]; then
+	echo "usage: $0 <baseline> <results> [tolerance %]" >&2
+	exit 2
+fi
+
+awk -v tolerance="${3:-5}" '
+	FNR == 1 { file++ }
+	$1 !~ /_cycles:$/ { next }
+	{ name = substr($1, 1, length($1) - 8) }
+	file == 1 { base[name] = $2; order[++count] = name; next }
+	{ result[name] = $2 }
+	END {
+		failed = 0
+		for (i = 1; i <= count; i++) {
+			name = order[i]
+			if (!(name in result)) {
+				printf "%-24s %10.1f %10s  MISSING\n", name, base[name], "-"
+				failed = 1
+				continue
+			}
+			change = (base[name] != 0) ? (result[name] - base[name]) * 100 / base[name] : 0
+			status = ""
+			if (result[name] > base[name] && (base[name] == 0 || change > tolerance)) {
+				status = "  SLOWER"
+				failed = 1
+			}
+			printf "%-24s %10.1f %10.1f %+7.1f%%%s\n", name, base[name], result[name], change, status
+		}
+		exit failed
+	}
+' "$1" "$2"
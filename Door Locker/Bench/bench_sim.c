@@ -0,0 +1,260 @@
+/* Runner of the driver benchmark (bench.c) on simavr: cycle accurate Atmega16 with a 24C16 and a keypad */
+
+/* Usage: bench_sim <bench.elf> [time limit ms]
+ * answers the lines of the benchmark (keypad keys, UART bytes, results) and prints its results:
+ * "<name>_cycles: <cycles of one call>" and "<name>_us: <time of one call at F_CPU>" lines,
+ * then the simulated and host times of the run
+ * Constraints:
+ * the LCD isn't modelled: its data pins read 0 (not busy), the benchmark writes it once per LCD_TICK_US
+ * which is more than the execution time of an instruction, so a real LCD is never busy either
+ * simavr doesn't model the pull ups: the keypad rows are driven high unless a held key pulls them low
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "sim_avr.h"
+#include "sim_elf.h"
+#include "sim_irq.h"
+#include "sim_io.h"
+#include "sim_cycle_timers.h"
+#include "avr_ioport.h"
+#include "avr_uart.h"
+#include "avr_twi.h"
+
+
+/* Board wiring (keypad.h, external_eeprom.c) */
+#define KEYPAD_PORT 'B'
+#define KEYPAD_DDR 0x37				/* DDRB data address */
+#define KEYPAD_OUT 0x38				/* PORTB data address */
+#define KEYPAD_ROWS 4				/* rows on pins 0 -> 3 */
+#define KEYPAD_COLS 3
+#define KEYPAD_FIRST_COL 4			/* columns on pins 4 -> 6 */
+#define EEPROM_ADDRESS 0xA0			/* SLA+W of the first block of the 24C16 */
+#define EEPROM_SIZE 2048
+#define EEPROM_PAGE_SIZE 16
+#define EEPROM_WRITE_CYCLE_US 5000
+
+/* Runner configurations (see bench.c) */
+#define BENCH_ACK '!'				/* answer to a line */
+#define BENCH_RX_DATA 0x55			/* bytes sent for a "@rx" request */
+#define LINE_SIZE 64
+#define TIME_LIMIT_MS 10000			/* default time limit */
+
+
+static void bench_tx(struct avr_irq_t *irq, uint32_t value, void *param);
+static void bench_line(const char *line);
+static void keypad_port(struct avr_irq_t *irq, uint32_t value, void *param);
+static void eeprom_twi(struct avr_irq_t *irq, uint32_t value, void *param);
+static avr_cycle_count_t eeprom_ready(struct avr_t *avr, avr_cycle_count_t when, void *param);
+
+
+static const char g_keys[] = "123456789*0#";
+static const char *g_eeprom_names[2] = {"8>eeprom.in", "32<eeprom.out"};
+
+/* Global state of the runner */
+static avr_t *g_avr;
+static avr_irq_t *g_uart_in;
+static char g_line[LINE_SIZE];
+static uint8_t g_length = 0;
+static char g_key = '-';
+static int g_done = 0;
+
+/* Global state of the 24C16: selected block (SLA+R/W, 0 when not selected), address, page write */
+static avr_irq_t *g_eeprom_irq;
+static uint8_t g_eeprom[EEPROM_SIZE];
+static uint8_t g_selected = 0;
+static uint16_t g_address = 0;
+static uint8_t g_index = 0;
+static uint8_t g_page[EEPROM_PAGE_SIZE];
+static uint8_t g_page_count = 0;
+static int g_busy = 0;
+
+
+int main(int argc, char *argv[]) {
+	elf_firmware_t firmware;
+	avr_cycle_count_t limit;
+	struct timespec cpu;
+	uint32_t flags = 0;
+	int state;
+	uint8_t pin;
+
+	if (argc < 2) {
+		fprintf(stderr, "usage: %s <bench.elf> [time limit ms]\n", argv[0]);
+		return 2;
+	}
+	memset(&firmware, 0, sizeof(firmware));
+	if (elf_read_firmware(argv[1], &firmware) != 0) {
+		fprintf(stderr, "%s: can't read the firmware\n", argv[1]);
+		return 2;
+	}
+	firmware.frequency = F_CPU;
+	limit = (avr_cycle_count_t)((argc > 2) ? strtoul(argv[2], NULL, 10) : TIME_LIMIT_MS) * (F_CPU / 1000);
+
+	g_avr = avr_make_mcu_by_name("atmega16");
+	if (g_avr == NULL) {
+		fprintf(stderr, "simavr doesn't support the atmega16\n");
+		return 2;
+	}
+	avr_init(g_avr);
+	avr_load_firmware(g_avr, &firmware);
+
+	/* UART: the lines of the benchmark are handled here, not printed by simavr */
+	avr_ioctl(g_avr, AVR_IOCTL_UART_GET_FLAGS('0'), &flags);
+	flags &= ~AVR_UART_FLAG_STDIO;
+	avr_ioctl(g_avr, AVR_IOCTL_UART_SET_FLAGS('0'), &flags);
+	avr_irq_register_notify(avr_io_getirq(g_avr, AVR_IOCTL_UART_GETIRQ('0'), UART_IRQ_OUTPUT), bench_tx, NULL);
+	g_uart_in = avr_io_getirq(g_avr, AVR_IOCTL_UART_GETIRQ('0'), UART_IRQ_INPUT);
+
+	/* keypad: released rows high, the scan writes DDRB then PORTB */
+	for (pin = 0; pin < KEYPAD_ROWS; pin++)
+		avr_raise_irq(avr_io_getirq(g_avr, AVR_IOCTL_IOPORT_GETIRQ(KEYPAD_PORT), pin), 1);
+	avr_irq_register_notify(avr_io_getirq(g_avr, AVR_IOCTL_IOPORT_GETIRQ(KEYPAD_PORT), IOPORT_IRQ_PIN_ALL), keypad_port, NULL);
+
+	/* 24C16 on the TWI bus (erased) */
+	memset(g_eeprom, 0xFF, sizeof(g_eeprom));
+	g_eeprom_irq = avr_alloc_irq(&g_avr->irq_pool, 0, 2, g_eeprom_names);
+	avr_irq_register_notify(g_eeprom_irq + TWI_IRQ_OUTPUT, eeprom_twi, NULL);
+	avr_connect_irq(g_eeprom_irq + TWI_IRQ_INPUT, avr_io_getirq(g_avr, AVR_IOCTL_TWI_GETIRQ(0), TWI_IRQ_INPUT));
+	avr_connect_irq(avr_io_getirq(g_avr, AVR_IOCTL_TWI_GETIRQ(0), TWI_IRQ_OUTPUT), g_eeprom_irq + TWI_IRQ_OUTPUT);
+
+	do
+		state = avr_run(g_avr);
+	while (!g_done && state != cpu_Done && state != cpu_Crashed && g_avr->cycle < limit);
+
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &cpu);
+	printf("sim_time_ms: %.3f\n", g_avr->cycle * 1000.0 / F_CPU);
+	printf("host_cpu_ms: %.3f\n", cpu.tv_sec * 1000.0 + cpu.tv_nsec / 1000000.0);
+	printf("cpu_cycles: %llu\n", (unsigned long long)g_avr->cycle);
+	if (!g_done) {
+		fprintf(stderr, "bench: not done (%s)\n", (state == cpu_Crashed) ? "crashed" : "time limit");
+		return 1;
+	}
+	return 0;
+}
+
+
+static void bench_tx(struct avr_irq_t *irq, uint32_t value, void *param) {
+	(void)irq;
+	(void)param;
+	if (value != '\n') {
+		if (g_length < LINE_SIZE - 1)
+			g_line[g_length++] = value;
+		return;
+	}
+	g_line[g_length] = '\0';
+	g_length = 0;
+	bench_line(g_line);
+}
+
+/* Answer a line of the benchmark: a request OR a result */
+static void bench_line(const char *line) {
+	char name[LINE_SIZE];
+	unsigned long runs, cycles;
+	unsigned long i;
+
+	if (strncmp(line, "@rx ", 4) == 0) {
+		for (i = strtoul(&line[4], NULL, 10); i > 0; i--)
+			avr_raise_irq(g_uart_in, BENCH_RX_DATA);
+		return;
+	}
+	if (strcmp(line, "@end") == 0) {
+		g_done = 1;
+		return;
+	}
+
+	if (strncmp(line, "@key ", 5) == 0) {
+		g_key = line[5];
+		keypad_port(NULL, g_avr->data[KEYPAD_OUT], NULL);
+	}
+	else if (sscanf(line, "%63s %lu %lu", name, &runs, &cycles) == 3 && runs != 0) {
+		printf("%s_cycles: %.1f\n", name, (double)cycles / runs);
+		printf("%s_us: %.3f\n", name, (double)cycles / runs * 1000000.0 / F_CPU);
+	}
+	else if (*line != '\0')
+		fprintf(stderr, "bench: unexpected line \"%s\"\n", line);
+	avr_raise_irq(g_uart_in, BENCH_ACK);
+}
+
+/* PORTB written: the row of the held key is low while its column is driven low */
+static void keypad_port(struct avr_irq_t *irq, uint32_t value, void *param) {
+	static int busy = 0;
+	const char *key = (g_key != '-') ? strchr(g_keys, g_key) : NULL;
+	uint8_t ddr = g_avr->data[KEYPAD_DDR];
+	uint8_t row, col, low;
+	(void)irq;
+	(void)param;
+
+	/* driving a row notifies the port again */
+	if (busy)
+		return;
+	busy = 1;
+	for (row = 0; row < KEYPAD_ROWS; row++) {
+		low = 0;
+		if (key != NULL && (key - g_keys) / KEYPAD_COLS == row) {
+			col = KEYPAD_FIRST_COL + (key - g_keys) % KEYPAD_COLS;
+			low = (ddr & (1 << col)) && !(value & (1 << col));
+		}
+		avr_raise_irq(avr_io_getirq(g_avr, AVR_IOCTL_IOPORT_GETIRQ(KEYPAD_PORT), row), !low);
+	}
+	busy = 0;
+}
+
+/* TWI message of the master: the 24C16 answers its 8 blocks (0xA0 -> 0xAF) when it isn't busy */
+static void eeprom_twi(struct avr_irq_t *irq, uint32_t value, void *param) {
+	avr_twi_msg_irq_t message;
+	uint8_t i;
+	(void)irq;
+	(void)param;
+
+	message.u.v = value;
+
+	/* a stop commits the page write and starts the write cycle */
+	if (message.u.twi.msg & TWI_COND_STOP) {
+		if (g_selected && g_page_count != 0) {
+			for (i = 0; i < g_page_count; i++)
+				g_eeprom[(g_address & ~(EEPROM_PAGE_SIZE - 1)) | ((g_address + i) & (EEPROM_PAGE_SIZE - 1))] = g_page[i];
+			g_address = (g_address & ~(EEPROM_PAGE_SIZE - 1)) | ((g_address + g_page_count) & (EEPROM_PAGE_SIZE - 1));
+			g_busy = 1;
+			avr_cycle_timer_register_usec(g_avr, EEPROM_WRITE_CYCLE_US, eeprom_ready, NULL);
+		}
+		g_selected = 0;
+	}
+
+	/* a (repeated) start selects a block, the address isn't acknowledged during a write cycle */
+	if (message.u.twi.msg & TWI_COND_START) {
+		g_selected = 0;
+		g_index = 0;
+		g_page_count = 0;
+		if (!g_busy && (message.u.twi.addr & 0xF0) == EEPROM_ADDRESS) {
+			g_selected = message.u.twi.addr;
+			avr_raise_irq(g_eeprom_irq + TWI_IRQ_INPUT, avr_twi_irq_msg(TWI_COND_ACK, g_selected, 1));
+		}
+	}
+	if (!g_selected)
+		return;
+
+	/* write: the word address then the data bytes buffered for the page write */
+	if (message.u.twi.msg & TWI_COND_WRITE) {
+		avr_raise_irq(g_eeprom_irq + TWI_IRQ_INPUT, avr_twi_irq_msg(TWI_COND_ACK, g_selected, 1));
+		if (g_index++ == 0)
+			g_address = ((g_selected & 0x0E) << 7) | message.u.twi.data;
+		else if (g_page_count < EEPROM_PAGE_SIZE)
+			g_page[g_page_count++] = message.u.twi.data;
+	}
+
+	/* read: sequential from the current address */
+	if (message.u.twi.msg & TWI_COND_READ) {
+		avr_raise_irq(g_eeprom_irq + TWI_IRQ_INPUT, avr_twi_irq_msg(TWI_COND_READ, g_selected, g_eeprom[g_address]));
+		g_address = (g_address + 1) & (EEPROM_SIZE - 1);
+	}
+}
+
+static avr_cycle_count_t eeprom_ready(struct avr_t *avr, avr_cycle_count_t when, void *param) {
+	(void)avr;
+	(void)when;
+	(void)param;
+	g_busy = 0;
+	return 0;
+}
@@ -5,24 +5,51 @@
 # Add inputs and outputs from these tool invocations to the build variables 
 C_SRCS += \
 ../control.c \
+../event_log.c \
 ../external_eeprom.c \
+../hash.c \
 ../i2c.c \
+../power.c \
+../protocol.c \
+../sched.c \
+../store.c \
+../swtimer.c \
 ../timers.c \
-../uart.c 
+../trace.c \
+../uart.c \
+../users.c 
 
 OBJS += \
 ./control.o \
+./event_log.o \
 ./external_eeprom.o \
+./hash.o \
 ./i2c.o \
+./power.o \
+./protocol.o \
+./sched.o \
+./store.o \
+./swtimer.o \
 ./timers.o \
-./uart.o 
+./trace.o \
+./uart.o \
+./users.o 
 
 C_DEPS += \
 ./control.d \
+./event_log.d \
 ./external_eeprom.d \
+./hash.d \
 ./i2c.d \
+./power.d \
+./protocol.d \
+./sched.d \
+./store.d \
+./swtimer.d \
 ./timers.d \
-./uart.d 
+./trace.d \
+./uart.d \
+./users.d 
 
 
 # Each subdirectory must supply rules for building sources it contributes
@@ -6,119 +6,648 @@
  */
 
 
+#include "event_log.h"
 #include "external_eeprom.h"
+#include "hash.h"
+#include "power.h"
+#include "protocol.h"
+#include "sched.h"
+#include "store.h"
+#include "swtimer.h"
 #include "timers.h"
+#include "trace.h"
 #include "uart.h"
+#include "users.h"
 
 
-/* UART commands */
-#define GET_PASS 0x69			/* get saved password */
-#define NEW_PASS 0x29			/* set new password */
-#define OPEN_DOOR 0x0D			/* open door */
-#define THEFT_ALERT 0x7A		/* theft alert */
-#define CONTROL_READY 0xC0		/* control is ready to transmit or receive */
-
 /* constants */
 #define PASS_SIZE 5				/* number of password digits */
-#define PASS_ADDRESS 0x00AD		/* address of password in eeprom */
+#define CREDENTIAL_SIZE (HASH_KEY_SIZE + HASH_SIZE)		/* salt + hash of password */
+#define WRONG_ATTEMPTS 3		/* max number of consecutive wrong attempts */
+#define QUEUE_SIZE 4			/* max number of commands waiting to be dispatched */
+#define DOOR_TIME 10			/* seconds of motor rotation in each direction */
+#define ALERT_TIME 60			/* seconds of buzzer alert */
+#define STORAGE_TIME 2			/* seconds before a stuck EEPROM operation is aborted */
+#define ADMIN_TIME 30			/* seconds user commands are accepted after the main password is verified */
+#define OPEN_TIME 5				/* seconds one OPEN_DOOR is accepted after a password OR user code is verified */
+#define LOG_DUMP_BLOCK 4		/* number of events read from EEPROM at once while dumping the log */
+#define TICK_MS 10				/* period of the system tick */
+#define SECONDS(s) ((uint16)(s) * (1000 / TICK_MS))		/* number of ticks in s seconds */
+
+
+/* door state machine states */
+typedef enum {
+	DOOR_CLOSED, DOOR_OPENING, DOOR_CLOSING
+} DoorState;
+
+/* theft alert state machine states */
+typedef enum {
+	ALERT_OFF, ALERT_ON
+} AlertState;
 
+/* software timers */
+typedef enum {
+	DOOR_TIMER, ALERT_TIMER, ADMIN_TIMER, OPEN_TIMER, STORAGE_TIMER, LOG_TIMER
+} Timer;
 
-/* global variable containing the number of timer ticks */
+/* scheduler events (posted by the ISRs OR the idle check) */
+typedef enum {
+	EV_UART,					/* bytes received (link task) */
+	EV_COMMAND,					/* a queued command can be dispatched (link task) */
+	EV_TIMER,					/* software timers expired (actuator task) */
+	EV_STORAGE,					/* the EEPROM operation of a command is done (storage task) */
+	EV_LOG,						/* buffered events can be written (storage task) */
+	EV_DUMP,					/* the next event of the log dump can be sent (storage task) */
+	EV_TRACE					/* the next frame of the trace dump can be sent (-DTRACE only) */
+} Event;
+
+
+/* global variable containing the number of ticks in the current second */
 uint8 g_ticks = 0;
 
-/* global configuration struct of TIMER1 */
-TIMERS_ConfigType timer1a_config = {TIMER1A, CTC_OCR1A, F_CPU_1024, DISCONNECT_OC, 0, 60000};
+/* global variable containing the seconds since power up (time of the logged events) */
+volatile uint32 g_seconds = 0;
+
+/* global configuration struct of TIMER1 (system tick) */
+TIMERS_ConfigType timer1a_config = {TIMER1A, CTC_OCR1A, F_CPU_64, DISCONNECT_OC, 0,
+	(uint16)((F_CPU / 64UL) * TICK_MS / 1000UL - 1)};
+
+/* global command queue (filled from UART, drained by the dispatcher) */
+PROTOCOL_Frame g_queue[QUEUE_SIZE];
+uint8 g_queue_head = 0;
+uint8 g_queue_count = 0;
+
+/* global state of each actuator (the time left in that state is its software timer) */
+DoorState g_door_state = DOOR_CLOSED;
+AlertState g_alert_state = ALERT_OFF;
+
+/* global cache of the saved credential: salt then salted hash of the password
+ * (loaded once at start up, written through on change) */
+uint8 g_credential[CREDENTIAL_SIZE];
+bool g_pass_valid = FALSE;
+
+/* global counter of scheduler idle checks (timing jitter used to generate new salts) */
+uint16 g_entropy = 0;
+
+#ifdef HASH_BENCHMARK
+/* number of verifications timed at start up and the measured CPU cycles of one verification
+ * (read it with the debugger, build with -DHASH_BENCHMARK) */
+#define BENCHMARK_RUNS 16
+volatile uint32 g_verify_cycles = 0;
+volatile uint16 g_benchmark_overflows = 0;
+#endif
+
+/* global number of consecutive wrong password attempts (cleared when the alert of a lockout ends) */
+uint8 g_wrong_attempts = 0;
+
+/* global user of the last correct code (user of the logged door openings) */
+uint8 g_last_user = LOG_USER_NONE;
+
+/* global state of the event log dump in progress (index of the next event to send) and the
+ * block of events read from EEPROM (next event of the block to send, events in the block) */
+uint8 g_dump_index = 0;
+uint8 g_dump_count = 0;
+uint8 g_dump_events[LOG_DUMP_BLOCK * LOG_EVENT_SIZE];
+uint8 g_dump_next = 0;
+uint8 g_dump_read = 0;
+
+/* global state of the EEPROM operation of the password command in progress */
+PROTOCOL_Frame g_storage_request;
+uint8 g_storage_buf[CREDENTIAL_SIZE];
+uint8 g_storage_slot;
+bool g_storage_busy = FALSE;
+volatile bool g_storage_done = FALSE;
+volatile uint8 g_storage_result;
 
 
-void new_password(void);			/* save a new password in EEPROM */
-void get_password(void);			/* get current password from EEPROM */
-void open_door(void);				/* rotate motor CW for 10 sec then CCW for 10 sec */
-void theft_alert(void);				/* turn on buzzer to alert for a theft attempt for 1 min */
-void timer_open_door(void);			/* timer callback function when opening / closing door */
-void timer_theft_alert(void);		/* timer callback function when alerting for theft */
+void load_password(void);			/* load the latest password record from EEPROM into the cache */
+void receive_commands(void);		/* move received requests from UART to the command queue */
+void dispatch_command(void);		/* execute the oldest command in the queue */
+void complete_storage(void);		/* answer the password / user command when its EEPROM operation is done */
+void start_storage(void);			/* wait for the EEPROM operation of the current command */
+void flush_log(void);				/* write the buffered events when the EEPROM is free */
+void dump_log(void);				/* send the next event of the dump in progress */
+bool dump_ready(void);				/* check if the next event of the dump can be sent without waiting */
+uint32 get_time(void);				/* get the seconds since power up */
+void idle_check(void);				/* post the events of the work left before sleeping */
+void uart_received(void);			/* UART callback function when a byte is received */
+bool match_password(const uint8 * const pass);				/* compare a code with the saved password */
+void new_password(const PROTOCOL_Frame * const request);	/* save a new password in the cache and EEPROM */
+void verify_password(const PROTOCOL_Frame * const request);	/* compare entered password with the saved one and the users */
+void add_user(const PROTOCOL_Frame * const request);		/* save a new user code */
+void set_user(const PROTOCOL_Frame * const request);		/* revoke, enable OR disable a user */
+void list_users(const PROTOCOL_Frame * const request);		/* send the states of all user slots */
+void start_dump(const PROTOCOL_Frame * const request);		/* start sending the event log */
+void power_report(const PROTOCOL_Frame * const request);	/* send the CPU duty cycle */
+void open_door(const PROTOCOL_Frame * const request);		/* rotate motor CW for 10 sec then CCW for 10 sec */
+void theft_alert(const PROTOCOL_Frame * const request);		/* turn on buzzer to alert for a theft attempt for 1 min */
+void start_alert(void);				/* turn on buzzer for 1 min (OR extend the current alert) */
+void new_salt(uint8 * const salt, const PROTOCOL_Frame * const request);	/* generate a salt for a new password */
+void timer_tick(void);				/* timer callback function every system tick */
+void door_timeout(void);			/* software timer callback function when the door motion ends */
+void alert_timeout(void);			/* software timer callback function when the alert ends */
+void storage_timeout(void);			/* software timer callback function when an EEPROM operation is stuck */
+void log_timeout(void);				/* software timer callback function when an event log write is stuck */
+void storage_done(const uint8 result);	/* EEPROM callback function when an operation is done */
+#ifdef HASH_BENCHMARK
+void benchmark_verify(void);		/* measure CPU cycles of one password verification */
+void benchmark_overflow(void);		/* timer callback function on TIMER1 overflow */
+#endif
 
 
 int main() {
-	uint8 command;					/* received command via UART from HMI microcontroller */
-	UART_ConfigType uart_config = {ONE_BIT, DISABLE, BIT_8};
+	UART_ConfigType uart_config = {ONE_BIT, DISABLE, BIT_8, INTERRUPT};
 	
 	SET_BIT(DDRA,PA0);				/* configure buzzer pin (PA0) as output pin */
 	DDRB |= 0x03;					/* configure motor pins (PB0, PB1) as output pins */
 	CLEAR_BIT(PORTA,PA0);			/* turn off buzzer initially */
 	PORTB &= 0xFC;					/* turn off motor initially */
 	SREG |= (1<<7);
+	POWER_init();
 	EEPROM_init();
 	UART_init(&uart_config);
+	load_password();
+	USERS_init();
+	LOG_init();
+	LOG_event(0, LOG_POWER_UP, LOG_USER_NONE, 0);
+#ifdef HASH_BENCHMARK
+	benchmark_verify();
+#endif
+	SCHED_init();
+	SCHED_setHandler(EV_UART, receive_commands);
+	SCHED_setHandler(EV_COMMAND, dispatch_command);
+	SCHED_setHandler(EV_TIMER, SWTIMER_dispatch);
+	SCHED_setHandler(EV_STORAGE, complete_storage);
+	SCHED_setHandler(EV_LOG, flush_log);
+	SCHED_setHandler(EV_DUMP, dump_log);
+#ifdef TRACE
+	SCHED_setHandler(EV_TRACE, TRACE_continueDump);
+#endif
+	SCHED_setIdleCheck(idle_check);
+	UART_setRxCallBack(uart_received);
+	SCHED_post(EV_UART);				/* bytes received before the callback was set */
+	SWTIMER_init();
+	TIMERS_setCallBack(TIMER1A, CTC_OCR1A, timer_tick);
+	TIMERS_init(&timer1a_config);		/* the tick keeps the time so it never stops */
+	TRACE_init();						/* timestamps on the tick count */
 
-	while(1) {
-		command = UART_receiveByte();
-		switch(command) {
-			case GET_PASS:		get_password();		break;
-			case NEW_PASS:		new_password();		break;
-			case OPEN_DOOR:		open_door();		break;
-			case THEFT_ALERT:	theft_alert();		break;
+	/* sleep until an interrupt (UART, tick OR EEPROM) posts an event */
+	SCHED_run();
+}
+
+void load_password(void) {
+	/* no valid record means the password was never set */
+	g_pass_valid = STORE_load(g_credential, CREDENTIAL_SIZE);
+}
+
+void receive_commands(void) {
+	PROTOCOL_Frame request;
+	PROTOCOL_Status status;
+	uint8 i;
+
+	while ((status = PROTOCOL_receiveFrame(&request)) != NO_FRAME) {
+		if (status == FRAME_ERROR) {
+			PROTOCOL_reply(&request, NAK, NULL_PTR, 0);
+			continue;
+		}
+		if (PROTOCOL_replyRetransmission(&request))
+			continue;
+
+		/* a retransmission of a request still waiting in the queue is dropped */
+		for (i = 0; i < g_queue_count; i++) {
+			PROTOCOL_Frame *queued = &g_queue[(g_queue_head + i) % QUEUE_SIZE];
+			if (PROTOCOL_isSameRequest(queued, &request))
+				break;
 		}
+		if (i < g_queue_count)
+			continue;
+
+		/* reject the request if the queue is full, HMI will send it again */
+		if (g_queue_count == QUEUE_SIZE) {
+			PROTOCOL_reply(&request, NAK, NULL_PTR, 0);
+			continue;
+		}
+		g_queue[(g_queue_head + g_queue_count) % QUEUE_SIZE] = request;
+		g_queue_count++;
+	}
+}
+
+void dispatch_command(void) {
+	PROTOCOL_Frame *request;
+	if (g_queue_count == 0)
+		return;
+
+	request = &g_queue[g_queue_head];
+
+	/* password and user commands wait for the password, user OR events being saved */
+	if ((g_storage_busy || LOG_isBusy()) && request->cmd != OPEN_DOOR && request->cmd != THEFT_ALERT)
+		return;
+
+	switch(request->cmd) {
+		case VERIFY_PASS:	verify_password(request);	break;
+		case NEW_PASS:		new_password(request);		break;
+		case OPEN_DOOR:		open_door(request);			break;
+		case THEFT_ALERT:	theft_alert(request);		break;
+		case ADD_USER:		add_user(request);			break;
+		case REVOKE_USER:
+		case ENABLE_USER:	set_user(request);			break;
+		case LIST_USERS:	list_users(request);		break;
+		case DUMP_LOG:		start_dump(request);		break;
+		case POWER_REPORT:	power_report(request);		break;
+#ifdef TRACE
+		case DUMP_TRACE:	TRACE_sendDump(request);	break;
+#endif
+		default:			PROTOCOL_reply(request, NAK, NULL_PTR, 0);
 	}
+	g_queue_head = (g_queue_head + 1) % QUEUE_SIZE;
+	g_queue_count--;
 }
 
-void new_password(void) {
+void complete_storage(void) {
 	uint8 i;
-	uint8 pass[5];
-	UART_sendByte(CONTROL_READY);
-	for (i = 0; i < PASS_SIZE; i++)
-		pass[i] = UART_receiveByte();
-	for (i = 0; i < PASS_SIZE; i++) {
-		EEPROM_writeByte(PASS_ADDRESS + i, pass[i]);
-		_delay_ms(10);
+	uint8 result[2] = {USER_DONE, 0};
+	if (!g_storage_busy || !g_storage_done)
+		return;
+
+	g_storage_busy = FALSE;
+	SWTIMER_cancel(STORAGE_TIMER);
+	if (g_storage_result == ERROR) {
+		PROTOCOL_reply(&g_storage_request, NAK, NULL_PTR, 0);
+		if (g_storage_request.cmd == NEW_PASS)
+			LOG_event(get_time(), LOG_NEW_PASS, LOG_USER_MAIN, ERROR);
+		else if (g_storage_request.cmd == ADD_USER)
+			LOG_event(get_time(), LOG_ADD_USER, g_storage_slot, ERROR);
+		return;
+	}
+
+	if (g_storage_request.cmd == NEW_PASS) {
+		/* the new password is saved, now it can be used */
+		for (i = 0; i < CREDENTIAL_SIZE; i++)
+			g_credential[i] = g_storage_buf[i];
+		g_pass_valid = TRUE;
+		PROTOCOL_reply(&g_storage_request, ACK, NULL_PTR, 0);
+		LOG_event(get_time(), LOG_NEW_PASS, LOG_USER_MAIN, SUCCESS);
+	}
+	else if (g_storage_request.cmd == ADD_USER) {
+		result[1] = g_storage_slot;
+		PROTOCOL_reply(&g_storage_request, ACK, result, 2);
+		LOG_event(get_time(), LOG_ADD_USER, g_storage_slot, SUCCESS);
+	}
+	else {
+		PROTOCOL_reply(&g_storage_request, ACK, result, 1);
+		LOG_event(get_time(), LOG_SET_USER, g_storage_request.payload[0], USERS_getState(g_storage_request.payload[0]));
+	}
+}
+
+void start_storage(void) {
+	g_storage_busy = TRUE;
+	SWTIMER_start(STORAGE_TIMER, SECONDS(STORAGE_TIME), 0, storage_timeout);
+}
+
+void flush_log(void) {
+	/* only one interrupt driven EEPROM operation at a time */
+	if (!g_storage_busy && LOG_flush())
+		SWTIMER_start(LOG_TIMER, SECONDS(STORAGE_TIME), 0, log_timeout);
+}
+
+void dump_log(void) {
+	uint8 j;
+	PROTOCOL_Frame frame;
+
+	if (!dump_ready())
+		return;
+
+	/* one sequential read per block, then one frame per event and per pass (SEQ is the event index) */
+	if (g_dump_next == g_dump_read) {
+		g_dump_next = 0;
+		g_dump_read = LOG_read(g_dump_index, g_dump_events, LOG_DUMP_BLOCK);
+		if (g_dump_read == 0) {
+			g_dump_count = g_dump_index;		/* EEPROM failure: end the dump */
+			return;
+		}
 	}
+	frame.cmd = LOG_DATA;
+	frame.len = LOG_EVENT_SIZE;
+	frame.seq = g_dump_index;
+	for (j = 0; j < LOG_EVENT_SIZE; j++)
+		frame.payload[j] = g_dump_events[g_dump_next * LOG_EVENT_SIZE + j];
+	PROTOCOL_sendFrame(&frame);
+	g_dump_next++;
+	g_dump_index++;
 }
 
-void get_password(void) {
+bool dump_ready(void) {
+	/* the TX buffer must take the whole frame, reading the next block would abort the EEPROM write in progress */
+	return g_dump_index != g_dump_count && PROTOCOL_canSend(LOG_EVENT_SIZE) &&
+		(g_dump_next != g_dump_read || (!LOG_isBusy() && !g_storage_busy));
+}
+
+void idle_check(void) {
+	/* a password OR user command waiting for an EEPROM write is resumed after its interrupt */
+	bool stalled = (g_storage_busy || LOG_isBusy()) && g_queue_count != 0 &&
+		g_queue[g_queue_head].cmd != OPEN_DOOR && g_queue[g_queue_head].cmd != THEFT_ALERT;
+
+	g_entropy++;
+	if (g_queue_count != 0 && !stalled)
+		SCHED_post(EV_COMMAND);
+	if (dump_ready())
+		SCHED_post(EV_DUMP);
+#ifdef TRACE
+	if (TRACE_isDumpReady())
+		SCHED_post(EV_TRACE);
+#endif
+	if (LOG_isPending() && !LOG_isBusy() && !g_storage_busy)
+		SCHED_post(EV_LOG);
+}
+
+void uart_received(void) {
+	SCHED_post(EV_UART);
+}
+
+uint32 get_time(void) {
+	uint32 time;
+	cli();
+	time = g_seconds;
+	sei();
+	return time;
+}
+
+void new_password(const PROTOCOL_Frame * const request) {
+	/* the first password is free, changing it needs the main password (admin session) */
+	if (request->len != PASS_SIZE || (g_pass_valid && !SWTIMER_isRunning(ADMIN_TIMER))) {
+		PROTOCOL_reply(request, NAK, NULL_PTR, 0);
+		return;
+	}
+
+	/* only the salt and the salted hash are saved, never the digits */
+	new_salt(g_storage_buf, request);
+	HASH_compute(g_storage_buf, request->payload, PASS_SIZE, &g_storage_buf[HASH_KEY_SIZE]);
+
+	/* write in the background, the reply is sent by complete_storage */
+	g_storage_request = *request;
+	g_storage_done = FALSE;
+	if (STORE_appendAsync(g_storage_buf, CREDENTIAL_SIZE, storage_done) == ERROR) {
+		PROTOCOL_reply(request, NAK, NULL_PTR, 0);
+		return;
+	}
+	start_storage();
+}
+
+void verify_password(const PROTOCOL_Frame * const request) {
+	uint8 result[2];
+	uint8 len = 1;
+
+	if (request->len != PASS_SIZE) {
+		PROTOCOL_reply(request, NAK, NULL_PTR, 0);
+		return;
+	}
+
+	/* any verification ends the user commands session, the main password starts a new one */
+	SWTIMER_cancel(ADMIN_TIMER);
+	SWTIMER_cancel(OPEN_TIMER);
+	g_last_user = LOG_USER_NONE;
+	if (g_alert_state == ALERT_ON) {
+		/* locked out until the alert ends: no code is checked */
+		result[0] = PASS_LOCKED;
+	}
+	else if (match_password(request->payload)) {
+		g_wrong_attempts = 0;
+		SWTIMER_start(ADMIN_TIMER, SECONDS(ADMIN_TIME), 0, NULL_PTR);
+		g_last_user = LOG_USER_MAIN;
+		SWTIMER_start(OPEN_TIMER, SECONDS(OPEN_TIME), 0, NULL_PTR);
+		result[0] = PASS_CORRECT;
+	}
+	else if ((result[1] = USERS_find(request->payload, PASS_SIZE)) != USERS_NONE &&
+			 USERS_getState(result[1]) == USER_ENABLED) {
+		g_wrong_attempts = 0;
+		g_last_user = result[1];
+		SWTIMER_start(OPEN_TIMER, SECONDS(OPEN_TIME), 0, NULL_PTR);
+		result[0] = PASS_USER;
+		len = 2;
+	}
+	else if (++g_wrong_attempts >= WRONG_ATTEMPTS) {
+		start_alert();
+		result[0] = PASS_LOCKED;
+	}
+	else
+		result[0] = PASS_WRONG;
+
+	PROTOCOL_reply(request, ACK, result, len);
+	LOG_event(get_time(), LOG_VERIFY, g_last_user, result[0]);
+}
+
+bool match_password(const uint8 * const pass) {
 	uint8 i;
-	uint8 pass[5];
-	for (i = 0; i < PASS_SIZE; i++) {
-		EEPROM_readByte(PASS_ADDRESS + i, &pass[i]);
-		_delay_ms(10);
+	uint8 diff = 0;
+	uint8 digest[HASH_SIZE];
+
+	/* constant time comparison of the salted hashes: always check all bytes */
+	HASH_compute(g_credential, pass, PASS_SIZE, digest);
+	for (i = 0; i < HASH_SIZE; i++)
+		diff |= g_credential[HASH_KEY_SIZE + i] ^ digest[i];
+	return diff == 0 && g_pass_valid;
+}
+
+void add_user(const PROTOCOL_Frame * const request) {
+	uint8 result[2] = {USER_REJECTED, USERS_NONE};
+	uint8 salt[HASH_KEY_SIZE];
+
+	if (request->len != PASS_SIZE) {
+		PROTOCOL_reply(request, NAK, NULL_PTR, 0);
+		return;
+	}
+
+	/* codes must be unique (the main password included) to know who entered a code */
+	if (!SWTIMER_isRunning(ADMIN_TIMER) || match_password(request->payload) ||
+		USERS_find(request->payload, PASS_SIZE) != USERS_NONE) {
+		PROTOCOL_reply(request, ACK, result, 2);
+		return;
 	}
-	UART_sendByte(CONTROL_READY);
-	for (i = 0; i < PASS_SIZE; i++)
-		UART_sendByte(pass[i]);
+
+	/* the first user gets a salt for the whole table */
+	if (!USERS_isFormatted()) {
+		new_salt(salt, request);
+		if (USERS_format(salt) == ERROR) {
+			PROTOCOL_reply(request, NAK, NULL_PTR, 0);
+			return;
+		}
+	}
+
+	/* write in the background, the reply is sent by complete_storage */
+	g_storage_request = *request;
+	g_storage_done = FALSE;
+	g_storage_slot = USERS_addAsync(request->payload, PASS_SIZE, storage_done);
+	if (g_storage_slot == USERS_NONE) {
+		PROTOCOL_reply(request, ACK, result, 2);
+		return;
+	}
+	start_storage();
+}
+
+void set_user(const PROTOCOL_Frame * const request) {
+	uint8 result = USER_REJECTED;
+	USERS_State state;
+
+	if ((request->cmd == REVOKE_USER && request->len != 1) || (request->cmd == ENABLE_USER && request->len != 2)) {
+		PROTOCOL_reply(request, NAK, NULL_PTR, 0);
+		return;
+	}
+
+	if (request->cmd == REVOKE_USER)
+		state = USER_EMPTY;
+	else
+		state = request->payload[1] ? USER_ENABLED : USER_DISABLED;
+
+	/* write in the background, the reply is sent by complete_storage */
+	g_storage_request = *request;
+	g_storage_done = FALSE;
+	if (!SWTIMER_isRunning(ADMIN_TIMER) || USERS_setStateAsync(request->payload[0], state, storage_done) == ERROR) {
+		PROTOCOL_reply(request, ACK, &result, 1);
+		return;
+	}
+	start_storage();
+}
+
+void list_users(const PROTOCOL_Frame * const request) {
+	uint8 bitmaps[8];
+	USERS_list(bitmaps);
+	PROTOCOL_reply(request, ACK, bitmaps, 8);
+}
+
+void power_report(const PROTOCOL_Frame * const request) {
+	uint16 duty = POWER_getDutyCycle();
+	uint8 payload[2] = {(uint8)duty, (uint8)(duty >> 8)};
+	PROTOCOL_reply(request, ACK, payload, 2);
 }
 
-void open_door(void) {
-	UART_sendByte(CONTROL_READY);
-	timer1a_config.initial_value = 41875;
-	TIMERS_setCallBack(TIMER1A, CTC_OCR1A, timer_open_door);
-	TIMERS_init(&timer1a_config);
+void start_dump(const PROTOCOL_Frame * const request) {
+	/* a new dump request restarts the dump from the oldest event */
+	g_dump_index = 0;
+	g_dump_count = LOG_getCount();
+	g_dump_next = g_dump_read = 0;
+	PROTOCOL_reply(request, ACK, &g_dump_count, 1);
+}
+
+void open_door(const PROTOCOL_Frame * const request) {
+	/* only right after a successful verification, which opens the door once */
+	if (!SWTIMER_isRunning(OPEN_TIMER)) {
+		PROTOCOL_reply(request, NAK, NULL_PTR, 0);
+		return;
+	}
+	SWTIMER_cancel(OPEN_TIMER);
+	PROTOCOL_reply(request, ACK, NULL_PTR, 0);
+	LOG_event(get_time(), LOG_OPEN_DOOR, g_last_user, g_door_state == DOOR_CLOSED);
+
+	/* the door is already moving: coalesce, don't restart the sequence */
+	if (g_door_state != DOOR_CLOSED)
+		return;
+
+	g_door_state = DOOR_OPENING;
+	SWTIMER_start(DOOR_TIMER, SECONDS(DOOR_TIME), 0, door_timeout);
 	SET_BIT(PORTB,PB0);
 }
 
-void theft_alert(void) {
-	UART_sendByte(CONTROL_READY);
-	timer1a_config.initial_value = 11250;
-	TIMERS_setCallBack(TIMER1A, CTC_OCR1A, timer_theft_alert);
-	TIMERS_init(&timer1a_config);
+void theft_alert(const PROTOCOL_Frame * const request) {
+	PROTOCOL_reply(request, ACK, NULL_PTR, 0);
+	start_alert();
+}
+
+void start_alert(void) {
+	/* a new alert while alerting extends the current one to a full minute */
+	LOG_event(get_time(), LOG_THEFT_ALERT, LOG_USER_NONE, 0);
+	g_alert_state = ALERT_ON;
+	SWTIMER_start(ALERT_TIMER, SECONDS(ALERT_TIME), 0, alert_timeout);
 	SET_BIT(PORTA,PA0);
 }
 
-void timer_open_door(void) {
+void new_salt(uint8 * const salt, const PROTOCOL_Frame * const request) {
+	uint8 entropy[5];
+	uint16 timer = TCNT1;
+
+	/* mix the previous salt with the timing of this request (scheduler idle checks and TIMER1 count)
+	 * so every device and every password change gets a different salt */
+	entropy[0] = (uint8)g_entropy;
+	entropy[1] = (uint8)(g_entropy >> 8);
+	entropy[2] = (uint8)timer;
+	entropy[3] = (uint8)(timer >> 8);
+	entropy[4] = request->seq;
+	HASH_compute(g_credential, entropy, sizeof(entropy), salt);
+}
+
+void timer_tick(void) {
+	if (SWTIMER_tick())
+		SCHED_post(EV_TIMER);
+
+	/* the time is kept in the ISR, a late dispatch can't lose a second */
 	g_ticks++;
-	if (g_ticks == 2) {
-		TCNT1 = 41875;
-		PORTB ^= 0x03;
-	}
-	else if (g_ticks == 4) {
-		CLEAR_BIT(PORTB,PB1);
+	if (g_ticks == SECONDS(1)) {
 		g_ticks = 0;
-		TIMERS_deInit(TIMER1A);
+		g_seconds++;
 	}
 }
 
-void timer_theft_alert(void) {
-	g_ticks++;
-	if (g_ticks == 8) {
-		CLEAR_BIT(PORTA,PA0);
-		g_ticks = 0;
-		TIMERS_deInit(TIMER1A);
+void door_timeout(void) {
+	if (g_door_state == DOOR_OPENING) {
+		PORTB ^= 0x03;				/* reverse the motor direction */
+		g_door_state = DOOR_CLOSING;
+		SWTIMER_start(DOOR_TIMER, SECONDS(DOOR_TIME), 0, door_timeout);
 	}
+	else {
+		CLEAR_BIT(PORTB,PB1);		/* stop the motor */
+		g_door_state = DOOR_CLOSED;
+	}
+}
+
+void alert_timeout(void) {
+	CLEAR_BIT(PORTA,PA0);			/* turn off buzzer */
+	g_alert_state = ALERT_OFF;
+	g_wrong_attempts = 0;			/* end of the lockout */
+}
+
+void storage_timeout(void) {
+	/* the I2C bus is stuck: abort, the callback reports the error */
+	if (g_storage_busy && !g_storage_done)
+		EEPROM_cancel();
+}
+
+void log_timeout(void) {
+	if (LOG_isBusy())
+		EEPROM_cancel();
+}
+
+void storage_done(const uint8 result) {
+	g_storage_result = result;
+	g_storage_done = TRUE;
+	SCHED_post(EV_STORAGE);
+}
+
+#ifdef HASH_BENCHMARK
+void benchmark_verify(void) {
+	uint8 i;
+	uint8 pass[PASS_SIZE] = {1, 2, 3, 4, 5};
+	uint8 digest[HASH_SIZE];
+	uint16 count;
+	TIMERS_ConfigType timer1_config = {TIMER1, NORMAL, F_CPU_1, DISCONNECT_OC, 0, 0};
+
+	/* count CPU cycles with TIMER1 (no prescaler) and its overflows */
+	g_benchmark_overflows = 0;
+	TIMERS_setCallBack(TIMER1, NORMAL, benchmark_overflow);
+	TIMERS_init(&timer1_config);
+	for (i = 0; i < BENCHMARK_RUNS; i++)
+		HASH_compute(g_credential, pass, PASS_SIZE, digest);
+	TIMERS_deInit(TIMER1);
+	CLEAR_BIT(TIMSK,TOIE1);
+	count = TCNT1;
+
+	/* an overflow pending at the stop wasn't counted yet */
+	if (BIT_IS_SET(TIFR,TOV1)) {
+		g_benchmark_overflows++;
+		SET_BIT(TIFR,TOV1);
+	}
+	g_verify_cycles = (((uint32)g_benchmark_overflows << 16) + count) / BENCHMARK_RUNS;
+}
+
+void benchmark_overflow(void) {
+	g_benchmark_overflows++;
 }
+#endif
@@ -0,0 +1,188 @@
+/* Append-only log of access events in a ring in the external EEPROM */
+
+#include "external_eeprom.h"
+#include "protocol.h"
+#include "event_log.h"
+
+
+#if (LOG_EVENTS & (LOG_EVENTS - 1)) != 0 || LOG_EVENTS > 128
+#error "LOG_EVENTS must be a power of 2 (max 128)"
+#endif
+
+#if (LOG_BUFFER_EVENTS & (LOG_BUFFER_EVENTS - 1)) != 0
+#error "LOG_BUFFER_EVENTS must be a power of 2"
+#endif
+
+#if (EEPROM_PAGE_SIZE % LOG_EVENT_SIZE) != 0 || (LOG_ADDRESS % EEPROM_PAGE_SIZE) != 0
+#error "events must not cross page boundaries"
+#endif
+
+#define EVENT_ADDRESS(slot) (LOG_ADDRESS + (uint16)(slot) * LOG_EVENT_SIZE)
+#define RING(slot) ((slot) & (LOG_EVENTS - 1))
+#define CRC_OFFSET (LOG_EVENT_SIZE - 1)
+
+
+/* Global position of the next event in EEPROM and number of saved events */
+static uint8 g_next = 0;
+static uint8 g_count = 0;
+
+/* Global buffer of events waiting to be written (a ring) */
+static uint8 g_buffer[LOG_BUFFER_EVENTS][LOG_EVENT_SIZE];
+static volatile uint8 g_head = 0;
+static volatile uint8 g_used = 0;
+static uint8 g_seq = 0;				/* SEQ of the next buffered event */
+static uint16 g_lost = 0;
+
+/* Global state of the write in progress */
+static volatile bool g_busy = FALSE;
+static uint8 g_writing;
+
+
+static bool LOG_readEvent(const uint8 slot, uint8 * const event);
+static void LOG_writeDone(const uint8 result);
+
+
+void LOG_init(void) {
+	uint8 first, last, middle;
+	uint8 i;
+	uint8 seq0;
+	uint8 event[LOG_EVENT_SIZE];
+
+	/* events are written in slot order, so from slot 0 SEQ goes up by one until the newest event
+	 * binary search for the last slot continuing the SEQ of slot 0 */
+	first = 0;
+	last = LOG_EVENTS;
+	if (EEPROM_readByte(EVENT_ADDRESS(0), &seq0) == SUCCESS) {
+		while (last - first > 1) {
+			middle = (first + last) / 2;
+			if (EEPROM_readByte(EVENT_ADDRESS(middle), &event[0]) == SUCCESS && event[0] == (uint8)(seq0 + middle))
+				first = middle;
+			else
+				last = middle;
+		}
+	}
+
+	/* the newest event may be cut by a power loss, go back to the newest valid one */
+	for (i = 0; i < LOG_EVENTS; i++, first = RING(first - 1)) {
+		if (!LOG_readEvent(first, event))
+			continue;
+
+		g_next = RING(first + 1);
+		g_seq = event[0] + 1;
+
+		/* the ring is full if the last slot holds the event before slot 0 */
+		g_count = first + 1;
+		if (first == LOG_EVENTS - 1)
+			g_count = LOG_EVENTS;
+		else if (LOG_readEvent(LOG_EVENTS - 1, event) && event[0] == (uint8)(g_seq - first - 2))
+			g_count = LOG_EVENTS;
+		return;
+	}
+
+	/* the log is empty */
+	g_next = 0;
+	g_seq = 0;
+	g_count = 0;
+}
+
+void LOG_event(const uint32 time, const uint8 type, const uint8 user, const uint8 result) {
+	uint8 *event;
+
+	if (g_used == LOG_BUFFER_EVENTS) {
+		g_lost++;
+		return;
+	}
+
+	/* the ISR removes written events from the head meanwhile, the tail stays free */
+	cli();
+	event = g_buffer[(g_head + g_used) & (LOG_BUFFER_EVENTS - 1)];
+	sei();
+	event[0] = g_seq++;
+	event[1] = (uint8)time;
+	event[2] = (uint8)(time >> 8);
+	event[3] = (uint8)(time >> 16);
+	event[4] = type;
+	event[5] = user;
+	event[6] = result;
+	event[CRC_OFFSET] = PROTOCOL_crc8(LOG_CRC_INIT, event, CRC_OFFSET);
+
+	cli();
+	g_used++;
+	sei();
+}
+
+bool LOG_flush(void) {
+	uint8 n;
+	uint8 page_events;
+
+	if (g_busy || g_used == 0)
+		return FALSE;
+
+	/* all the buffered events that are contiguous in RAM and in the same EEPROM page */
+	n = g_used;
+	if (n > LOG_BUFFER_EVENTS - g_head)
+		n = LOG_BUFFER_EVENTS - g_head;
+	page_events = (EEPROM_PAGE_SIZE - (EVENT_ADDRESS(g_next) % EEPROM_PAGE_SIZE)) / LOG_EVENT_SIZE;
+	if (n > page_events)
+		n = page_events;
+
+	g_writing = n;
+	g_busy = TRUE;
+	if (EEPROM_writePageAsync(EVENT_ADDRESS(g_next), g_buffer[g_head], n * LOG_EVENT_SIZE, LOG_writeDone) == ERROR) {
+		g_busy = FALSE;
+		return FALSE;
+	}
+	return TRUE;
+}
+
+bool LOG_isBusy(void) {
+	return g_busy;
+}
+
+bool LOG_isPending(void) {
+	return g_used != 0;
+}
+
+uint8 LOG_getCount(void) {
+	return g_count;
+}
+
+uint16 LOG_getLostCount(void) {
+	return g_lost;
+}
+
+uint8 LOG_read(const uint8 index, uint8 * const buf, const uint8 count) {
+	uint8 slot;
+	uint8 n;
+
+	if (index >= g_count)
+		return 0;
+
+	slot = RING(g_next - g_count + index);
+	n = count;
+	if (n > g_count - index)
+		n = g_count - index;
+	if (n > LOG_EVENTS - slot)
+		n = LOG_EVENTS - slot;
+
+	if (EEPROM_readBlock(EVENT_ADDRESS(slot), buf, (uint16)n * LOG_EVENT_SIZE) == ERROR)
+		return 0;
+	return n;
+}
+
+/* Read an event, returns FALSE if its CRC is wrong */
+static bool LOG_readEvent(const uint8 slot, uint8 * const event) {
+	return EEPROM_readBlock(EVENT_ADDRESS(slot), event, LOG_EVENT_SIZE) == SUCCESS &&
+		PROTOCOL_crc8(LOG_CRC_INIT, event, CRC_OFFSET) == event[CRC_OFFSET];
+}
+
+/* Called from the ISR when the events are written, failed events stay buffered to be written again */
+static void LOG_writeDone(const uint8 result) {
+	if (result == SUCCESS) {
+		g_head = (g_head + g_writing) & (LOG_BUFFER_EVENTS - 1);
+		g_used -= g_writing;
+		g_next = RING(g_next + g_writing);
+		g_count = (g_count + g_writing > LOG_EVENTS) ? LOG_EVENTS : g_count + g_writing;
+	}
+	g_busy = FALSE;
+}
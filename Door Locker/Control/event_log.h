@@ -0,0 +1,77 @@
+/* Append-only log of access events in a ring in the external EEPROM */
+
+/* Event format (LOG_EVENT_SIZE bytes):
+ * | SEQ | TIME (3 bytes, little endian) | TYPE | USER | RESULT | CRC |
+ * SEQ  = sequence number (incremented by one for every event, finds the newest event at start up)
+ * TIME = seconds since power up (LOG_POWER_UP events separate the power cycles)
+ * USER = user slot, LOG_USER_MAIN for the main password OR LOG_USER_NONE
+ * CRC  = CRC-8 (same as the protocol, initial value LOG_CRC_INIT) of the rest of the event
+ *
+ * Events are kept in a RAM buffer and written in the background (one page write for all
+ * the buffered events in the same page) so logging doesn't delay the command being executed
+ */
+
+/* Constraints:
+ * LOG_flush must not be called while another interrupt driven EEPROM operation is in progress
+ * requires an initialized EEPROM driver and global interrupts enabled
+ */
+
+
+#ifndef EVENT_LOG_H_
+#define EVENT_LOG_H_
+
+
+#include "std_types.h"
+#include "micro_config.h"
+#include "common_macros.h"
+
+
+/* Log configurations */
+#define LOG_ADDRESS 0x0600			/* address of the first event (page aligned) */
+#define LOG_EVENTS 64				/* number of events in the ring (power of 2, max 128) */
+#define LOG_EVENT_SIZE 8			/* number of bytes of an event (divides EEPROM_PAGE_SIZE) */
+#define LOG_BUFFER_EVENTS 4			/* max number of events waiting to be written (power of 2) */
+#define LOG_CRC_INIT 0xFF			/* CRC initial value (rejects erased AND zeroed events) */
+
+/* Event types */
+#define LOG_POWER_UP 1				/* control is powered up */
+#define LOG_VERIFY 2				/* password checked (RESULT: VERIFY_PASS result) */
+#define LOG_NEW_PASS 3				/* main password changed (RESULT: SUCCESS OR ERROR) */
+#define LOG_OPEN_DOOR 4				/* door opened (RESULT: 1 opened, 0 already moving) */
+#define LOG_THEFT_ALERT 5			/* theft alert started */
+#define LOG_ADD_USER 6				/* user added (RESULT: SUCCESS OR ERROR) */
+#define LOG_SET_USER 7				/* user state changed (RESULT: new USERS_State) */
+
+/* Special USER values */
+#define LOG_USER_MAIN 0xFE			/* the main password */
+#define LOG_USER_NONE 0xFF			/* no user */
+
+
+/* Find the newest event in EEPROM, must be called once before logging */
+void LOG_init(void);
+
+/* Add an event to the RAM buffer (an event is lost if the buffer is full) */
+void LOG_event(const uint32 time, const uint8 type, const uint8 user, const uint8 result);
+
+/* Start writing the buffered events in the background if there are any and no write is in progress
+ * returns TRUE if a write is started */
+bool LOG_flush(void);
+
+/* Check if a write started by LOG_flush is still in progress */
+bool LOG_isBusy(void);
+
+/* Check if there are buffered events not written yet */
+bool LOG_isPending(void);
+
+/* Get the number of events saved in EEPROM */
+uint8 LOG_getCount(void);
+
+/* Get the number of events lost because the buffer was full */
+uint16 LOG_getLostCount(void);
+
+/* Read up to count saved events starting at index (0 is the oldest) in one sequential read
+ * returns the number of events read (it stops at the end of the ring, read the rest with another call) */
+uint8 LOG_read(const uint8 index, uint8 * const buf, const uint8 count);
+
+
+#endif /* EVENT_LOG_H_ */
@@ -1,75 +1,362 @@
-/* Driver for EEPROM (24Cxx) series */
-
-#include "i2c.h"
-#include "external_eeprom.h"
-
-
-void EEPROM_init(void) {
-	/* just initialize the I2C(TWI) module inside the MC */
-	TWI_init();
-}
-
-uint8 EEPROM_writeByte(const uint16 address, const uint8 data) {
-	/* Send the Start Bit */
-    TWI_start();
-    if (TWI_getStatus() != TW_START)
-        return ERROR;
-		
-    /* Device address = 1010 + upper 3 bits of memory location address
-     * write operation so R/W=0 */
-    TWI_write((uint8)(0xA0 | ((address & 0x0700) >> 7)));
-    if (TWI_getStatus() != TW_MT_SLA_W_ACK)
-        return ERROR; 
-		 
-    /* Send the remaining memory location address */
-    TWI_write((uint8)(address));
-    if (TWI_getStatus() != TW_MT_DATA_ACK)
-        return ERROR;
-		
-    /* write byte to EEPROM */
-    TWI_write(data);
-    if (TWI_getStatus() != TW_MT_DATA_ACK)
-        return ERROR;
-
-    /* Send the Stop Bit */
-    TWI_stop();
-    return SUCCESS;
-}
-
-uint8 EEPROM_readByte(const uint16 address, uint8 * const data) {
-	/* Send the Start Bit */
-    TWI_start();
-    if (TWI_getStatus() != TW_START)
-        return ERROR;
-		
-    /* Device address = 1010 + upper 3 bits of memory location address
-     * write operation so R/W=0 */
-    TWI_write((uint8)((0xA0) | ((address & 0x0700) >> 7)));
-    if (TWI_getStatus() != TW_MT_SLA_W_ACK)
-        return ERROR;
-		
-    /* Send the required memory location address */
-    TWI_write((uint8)(address));
-    if (TWI_getStatus() != TW_MT_DATA_ACK)
-        return ERROR;
-		
-    /* Send the Repeated Start Bit */
-    TWI_start();
-    if (TWI_getStatus() != TW_REP_START)
-        return ERROR;
-		
-    /* Device address = 1010 + upper 3 bits of memory location address
-     * read operation so R/W=1 */
-    TWI_write((uint8)((0xA1) | ((address & 0x0700) >> 7)));
-    if (TWI_getStatus() != TW_MT_SLA_R_ACK)
-        return ERROR;
-
-    /* Read Byte from EEPROM without sending an ACK */
-    *data = TWI_readWithNACK();
-    if (TWI_getStatus() != TW_MR_DATA_NACK)
-        return ERROR;
-
-    /* Send the Stop Bit */
-    TWI_stop();
-    return SUCCESS;
-}
+/* Driver for EEPROM (24Cxx) series */
+
+#include "i2c.h"
+#include "external_eeprom.h"
+
+
+/* Device address = 1010 + upper 3 bits of memory location address (7-bit TWI address) */
+#define DEVICE_ADDRESS(address) ((uint8)(0x50 | (((address) & 0x0700) >> 8)))
+
+
+/* Global variables of the interrupt driven operation in progress */
+static TWI_Transaction g_transaction;
+static uint8 g_page[1 + EEPROM_PAGE_SIZE];		/* memory location address + page data */
+static uint16 g_address;
+static const uint8 *g_data;
+static uint8 g_left;
+static uint16 g_polls;
+static void (*g_callback)(const uint8 result);
+
+
+/* Global diagnostic counters */
+static uint16 g_retries = 0;
+static uint16 g_failures = 0;
+
+
+static uint8 EEPROM_writeByteOnce(const uint16 address, const uint8 data);
+static uint8 EEPROM_readByteOnce(const uint16 address, uint8 * const data);
+static uint8 EEPROM_writePageOnce(const uint16 address, const uint8 * const buf, const uint16 len);
+static uint8 EEPROM_readBlockOnce(const uint16 address, uint8 * const buf, const uint16 len);
+static bool EEPROM_retry(const uint8 attempt);
+static uint8 EEPROM_selectDevice(const uint16 address);
+static bool EEPROM_writeNextPage(void);
+static void EEPROM_transactionDone(const uint8 status);
+
+
+void EEPROM_init(void) {
+	/* just initialize the I2C(TWI) module inside the MC */
+	TWI_init();
+}
+
+bool EEPROM_isBusy(void) {
+	bool busy;
+	uint8 status;
+
+	/* the bus belongs to the interrupt driven operation in progress */
+	if (TWI_isBusy())
+		return TRUE;
+
+	/* the EEPROM doesn't acknowledge its address during an internal write cycle */
+	TWI_start();
+	status = TWI_getStatus();
+	if (status != TW_START) {
+		/* a stuck bus needs to be recovered, otherwise just release it */
+		if (status == TW_TIMEOUT || status == TW_BUS_ERROR)
+			TWI_recoverBus();
+		else
+			TWI_stop();
+		return TRUE;
+	}
+	TWI_write(0xA0);
+	busy = (TWI_getStatus() != TW_MT_SLA_W_ACK);
+	TWI_stop();
+	return busy;
+}
+
+uint8 EEPROM_writeByte(const uint16 address, const uint8 data) {
+	uint8 attempt = 0;
+	while (EEPROM_writeByteOnce(address, data) == ERROR)
+		if (!EEPROM_retry(attempt++))
+			return ERROR;
+	return SUCCESS;
+}
+
+uint8 EEPROM_readByte(const uint16 address, uint8 * const data) {
+	uint8 attempt = 0;
+	while (EEPROM_readByteOnce(address, data) == ERROR)
+		if (!EEPROM_retry(attempt++))
+			return ERROR;
+	return SUCCESS;
+}
+
+uint8 EEPROM_writePage(const uint16 address, const uint8 * const buf, const uint16 len) {
+	uint8 attempt = 0;
+	while (EEPROM_writePageOnce(address, buf, len) == ERROR)
+		if (!EEPROM_retry(attempt++))
+			return ERROR;
+	return SUCCESS;
+}
+
+uint8 EEPROM_readBlock(const uint16 address, uint8 * const buf, const uint16 len) {
+	uint8 attempt = 0;
+	while (EEPROM_readBlockOnce(address, buf, len) == ERROR)
+		if (!EEPROM_retry(attempt++))
+			return ERROR;
+	return SUCCESS;
+}
+
+uint16 EEPROM_getRetryCount(void) {
+	return g_retries;
+}
+
+uint16 EEPROM_getFailureCount(void) {
+	return g_failures;
+}
+
+static uint8 EEPROM_writeByteOnce(const uint16 address, const uint8 data) {
+	/* Send the Start Bit and the device address (wait for a previous write to finish) */
+	if (EEPROM_selectDevice(address) == ERROR)
+		return ERROR;
+
+    /* Send the remaining memory location address */
+    TWI_write((uint8)(address));
+    if (TWI_getStatus() != TW_MT_DATA_ACK)
+        return ERROR;
+		
+    /* write byte to EEPROM */
+    TWI_write(data);
+    if (TWI_getStatus() != TW_MT_DATA_ACK)
+        return ERROR;
+
+    /* Send the Stop Bit */
+    TWI_stop();
+    return SUCCESS;
+}
+
+static uint8 EEPROM_readByteOnce(const uint16 address, uint8 * const data) {
+	/* Send the Start Bit and the device address (wait for a previous write to finish) */
+	if (EEPROM_selectDevice(address) == ERROR)
+		return ERROR;
+
+    /* Send the required memory location address */
+    TWI_write((uint8)(address));
+    if (TWI_getStatus() != TW_MT_DATA_ACK)
+        return ERROR;
+		
+    /* Send the Repeated Start Bit */
+    TWI_start();
+    if (TWI_getStatus() != TW_REP_START)
+        return ERROR;
+		
+    /* Device address = 1010 + upper 3 bits of memory location address
+     * read operation so R/W=1 */
+    TWI_write((uint8)((0xA1) | ((address & 0x0700) >> 7)));
+    if (TWI_getStatus() != TW_MT_SLA_R_ACK)
+        return ERROR;
+
+    /* Read Byte from EEPROM without sending an ACK */
+    *data = TWI_readWithNACK();
+    if (TWI_getStatus() != TW_MR_DATA_NACK)
+        return ERROR;
+
+    /* Send the Stop Bit */
+    TWI_stop();
+    return SUCCESS;
+}
+
+static uint8 EEPROM_writePageOnce(const uint16 address, const uint8 * const buf, const uint16 len) {
+	uint16 i = 0;
+
+	while (i < len) {
+		uint16 page_address = address + i;
+
+		/* Send the Start Bit and the device address (wait for the previous page to be written) */
+		if (EEPROM_selectDevice(page_address) == ERROR)
+			return ERROR;
+
+		/* Send the remaining memory location address */
+		TWI_write((uint8)(page_address));
+		if (TWI_getStatus() != TW_MT_DATA_ACK)
+			return ERROR;
+
+		/* write bytes until the end of the block OR the end of the page
+		 * (the EEPROM address counter would roll over to the start of the same page) */
+		do {
+			TWI_write(buf[i]);
+			if (TWI_getStatus() != TW_MT_DATA_ACK)
+				return ERROR;
+			i++;
+		} while (i < len && ((address + i) % EEPROM_PAGE_SIZE) != 0);
+
+		/* Send the Stop Bit to start the internal write cycle of this page */
+		TWI_stop();
+	}
+	return SUCCESS;
+}
+
+static uint8 EEPROM_readBlockOnce(const uint16 address, uint8 * const buf, const uint16 len) {
+	uint16 i;
+
+	if (len == 0)
+		return SUCCESS;
+
+	/* Send the Start Bit and the device address (wait for a previous write to finish) */
+	if (EEPROM_selectDevice(address) == ERROR)
+		return ERROR;
+
+	/* Send the required memory location address */
+	TWI_write((uint8)(address));
+	if (TWI_getStatus() != TW_MT_DATA_ACK)
+		return ERROR;
+
+	/* Send the Repeated Start Bit */
+	TWI_start();
+	if (TWI_getStatus() != TW_REP_START)
+		return ERROR;
+
+	/* Device address = 1010 + upper 3 bits of memory location address
+	 * read operation so R/W=1 */
+	TWI_write((uint8)((0xA1) | ((address & 0x0700) >> 7)));
+	if (TWI_getStatus() != TW_MT_SLA_R_ACK)
+		return ERROR;
+
+	/* Read all bytes but the last with an ACK so the EEPROM keeps sending */
+	for (i = 0; i < len - 1; i++) {
+		buf[i] = TWI_readWithACK();
+		if (TWI_getStatus() != TW_MR_DATA_ACK)
+			return ERROR;
+	}
+
+	/* Read the last byte without sending an ACK */
+	buf[i] = TWI_readWithNACK();
+	if (TWI_getStatus() != TW_MR_DATA_NACK)
+		return ERROR;
+
+	/* Send the Stop Bit */
+	TWI_stop();
+	return SUCCESS;
+}
+
+/* Prepare for another attempt after a failed operation
+ * returns FALSE if all attempts are used up */
+static bool EEPROM_retry(const uint8 attempt) {
+	uint8 i;
+	uint8 status = TWI_getStatus();
+
+	if (attempt >= EEPROM_RETRIES - 1) {
+		g_failures++;
+		TWI_stop();
+		return FALSE;
+	}
+	g_retries++;
+
+	/* a stuck bus needs to be recovered, otherwise just release it */
+	if (status == TW_TIMEOUT || status == TW_BUS_ERROR)
+		TWI_recoverBus();
+	else
+		TWI_stop();
+
+	/* back off 1, 2, 4, ... ms before trying again */
+	for (i = 0; i < (1 << attempt); i++)
+		_delay_ms(1);
+	return TRUE;
+}
+
+static uint8 EEPROM_selectDevice(const uint16 address) {
+	uint16 polls;
+
+	/* wait for an interrupt driven operation to finish, abort it if it takes too long */
+	for (polls = 0; polls < EEPROM_MAX_POLLS && TWI_isBusy(); polls++)
+		_delay_us(25);
+	if (TWI_isBusy())
+		TWI_cancelTransaction();
+
+	/* ACK polling: the EEPROM doesn't acknowledge its address until its internal write cycle
+	 * is complete, so keep addressing it (bounded by the max write cycle time) */
+	for (polls = 0; polls < EEPROM_MAX_POLLS; polls++) {
+		/* Send the Start Bit */
+		TWI_start();
+		if (TWI_getStatus() != TW_START)
+			return ERROR;
+
+		/* Device address = 1010 + upper 3 bits of memory location address
+		 * write operation so R/W=0 */
+		TWI_write((uint8)(0xA0 | ((address & 0x0700) >> 7)));
+		if (TWI_getStatus() == TW_MT_SLA_W_ACK)
+			return SUCCESS;
+
+		/* no ACK: still busy, release the bus and try again */
+		TWI_stop();
+	}
+	return ERROR;
+}
+
+uint8 EEPROM_readBlockAsync(const uint16 address, uint8 * const buf, const uint8 len, void (*callback)(const uint8 result)) {
+	if (TWI_isBusy() || len == 0)
+		return ERROR;
+
+	/* write the memory location address then read len bytes after a repeated start */
+	g_page[0] = (uint8)address;
+	g_transaction.address = DEVICE_ADDRESS(address);
+	g_transaction.write_buf = g_page;
+	g_transaction.write_len = 1;
+	g_transaction.read_buf = buf;
+	g_transaction.read_len = len;
+	g_transaction.callback = EEPROM_transactionDone;
+	g_left = 0;
+	g_polls = 0;
+	g_callback = callback;
+	return TWI_startTransaction(&g_transaction) ? SUCCESS : ERROR;
+}
+
+uint8 EEPROM_writePageAsync(const uint16 address, const uint8 * const buf, const uint8 len, void (*callback)(const uint8 result)) {
+	if (TWI_isBusy() || len == 0)
+		return ERROR;
+
+	g_address = address;
+	g_data = buf;
+	g_left = len;
+	g_callback = callback;
+	return EEPROM_writeNextPage() ? SUCCESS : ERROR;
+}
+
+void EEPROM_cancel(void) {
+	TWI_cancelTransaction();
+}
+
+/* Start the transaction of the next page (returns FALSE if it can't be started) */
+static bool EEPROM_writeNextPage(void) {
+	uint8 i;
+	uint8 size = EEPROM_PAGE_SIZE - (g_address % EEPROM_PAGE_SIZE);
+
+	/* write until the end of the block OR the end of the page */
+	if (size > g_left)
+		size = g_left;
+
+	g_page[0] = (uint8)g_address;
+	for (i = 0; i < size; i++)
+		g_page[i + 1] = g_data[i];
+
+	g_transaction.address = DEVICE_ADDRESS(g_address);
+	g_transaction.write_buf = g_page;
+	g_transaction.write_len = size + 1;
+	g_transaction.read_buf = NULL_PTR;
+	g_transaction.read_len = 0;
+	g_transaction.callback = EEPROM_transactionDone;
+
+	g_address += size;
+	g_data += size;
+	g_left -= size;
+	g_polls = 0;
+	return TWI_startTransaction(&g_transaction);
+}
+
+/* Called from the TWI ISR at the end of each transaction (a restart only queues its start bit) */
+static void EEPROM_transactionDone(const uint8 status) {
+	uint8 result = (status == TW_DONE) ? SUCCESS : ERROR;
+
+	/* ACK polling: the EEPROM is still busy with a previous write cycle, try again */
+	if (status == TW_MT_SLA_W_NACK && ++g_polls < EEPROM_MAX_POLLS) {
+		if (TWI_startTransaction(&g_transaction))
+			return;
+	}
+	else if (status == TW_DONE && g_left != 0) {
+		if (EEPROM_writeNextPage())
+			return;
+		result = ERROR;
+	}
+
+	/* done, out of polls OR the restart failed */
+	if (g_callback != NULL_PTR)
+		g_callback(result);
+}
@@ -1,21 +1,56 @@
-/* Driver for EEPROM (24Cxx) series */
-
-#ifndef EXTERNAL_EEPROM_H_
-#define EXTERNAL_EEPROM_H_
-
-
-#include "std_types.h"
-#include "micro_config.h"
-#include "common_macros.h"
-
-
-#define ERROR 0
-#define SUCCESS 1
-
-
-void EEPROM_init(void);
-uint8 EEPROM_writeByte(const uint16 address, const uint8 data);
-uint8 EEPROM_readByte(const uint16 address, uint8 * const data);
-
- 
-#endif /* EXTERNAL_EEPROM_H_ */
+/* Driver for EEPROM (24Cxx) series */
+
+#ifndef EXTERNAL_EEPROM_H_
+#define EXTERNAL_EEPROM_H_
+
+
+#include "std_types.h"
+#include "micro_config.h"
+#include "common_macros.h"
+
+
+#define ERROR 0
+#define SUCCESS 1
+
+/* EEPROM configurations (24C16) */
+#define EEPROM_PAGE_SIZE 16			/* max number of bytes written in one write cycle */
+#define EEPROM_WRITE_CYCLE_MS 10	/* max time of the internal write cycle */
+
+/* Number of attempts of a blocking operation before reporting an error (with a growing delay between them) */
+#define EEPROM_RETRIES 4			/* 1, 2 and 4 ms between them */
+
+/* Max number of address polls while waiting for a write cycle (one poll takes ~25us at 400 kbps) */
+#define EEPROM_MAX_POLLS ((EEPROM_WRITE_CYCLE_MS * 1000UL) / 25)
+
+
+void EEPROM_init(void);
+
+/* Check if the EEPROM is still busy in an internal write cycle OR an interrupt driven operation (without waiting) */
+bool EEPROM_isBusy(void);
+
+/* Write / Read functions wait for a previous write cycle to complete before accessing the EEPROM */
+uint8 EEPROM_writeByte(const uint16 address, const uint8 data);
+uint8 EEPROM_readByte(const uint16 address, uint8 * const data);
+
+/* Write a block of bytes, one write cycle per page (split at page boundaries)
+ * returns as soon as the last page is sent (use EEPROM_isBusy to check for completion) */
+uint8 EEPROM_writePage(const uint16 address, const uint8 * const buf, const uint16 len);
+
+/* Read a block of bytes in one sequential read */
+uint8 EEPROM_readBlock(const uint16 address, uint8 * const buf, const uint16 len);
+
+/* Get the diagnostic counters of retried operations and of operations that failed after all retries */
+uint16 EEPROM_getRetryCount(void);
+uint16 EEPROM_getFailureCount(void);
+
+/* Abort the interrupt driven operation in progress (its callback gets ERROR) and recover the bus */
+void EEPROM_cancel(void);
+
+/* Interrupt driven versions of EEPROM_readBlock / EEPROM_writePage
+ * return ERROR if another transaction is in progress, otherwise the callback is called
+ * from the ISR with SUCCESS OR ERROR when done (buf must stay in memory until then) */
+uint8 EEPROM_readBlockAsync(const uint16 address, uint8 * const buf, const uint8 len, void (*callback)(const uint8 result));
+uint8 EEPROM_writePageAsync(const uint16 address, const uint8 * const buf, const uint8 len, void (*callback)(const uint8 result));
+
+ 
+#endif /* EXTERNAL_EEPROM_H_ */
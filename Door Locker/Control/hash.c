@@ -0,0 +1,85 @@
+/* HalfSipHash-2-4 keyed hash (32-bit variant of SipHash designed for small MCUs) */
+
+#include "hash.h"
+
+
+/* Number of compression / finalization rounds */
+#define C_ROUNDS 2
+#define D_ROUNDS 4
+
+#define ROTL(x,b) (uint32)(((x) << (b)) | ((x) >> (32 - (b))))
+
+
+/* Global hash state */
+static uint32 g_v0, g_v1, g_v2, g_v3;
+
+
+/* Read a 32-bit little endian word */
+static uint32 HASH_load32(const uint8 * const p) {
+	return ((uint32)p[0]) | ((uint32)p[1] << 8) | ((uint32)p[2] << 16) | ((uint32)p[3] << 24);
+}
+
+/* Write a 32-bit little endian word */
+static void HASH_store32(uint8 * const p, const uint32 v) {
+	p[0] = (uint8)v;
+	p[1] = (uint8)(v >> 8);
+	p[2] = (uint8)(v >> 16);
+	p[3] = (uint8)(v >> 24);
+}
+
+static void HASH_rounds(uint8 n) {
+	while (n--) {
+		g_v0 += g_v1;
+		g_v1 = ROTL(g_v1, 5);
+		g_v1 ^= g_v0;
+		g_v0 = ROTL(g_v0, 16);
+		g_v2 += g_v3;
+		g_v3 = ROTL(g_v3, 8);
+		g_v3 ^= g_v2;
+		g_v0 += g_v3;
+		g_v3 = ROTL(g_v3, 7);
+		g_v3 ^= g_v0;
+		g_v2 += g_v1;
+		g_v1 = ROTL(g_v1, 13);
+		g_v1 ^= g_v2;
+		g_v2 = ROTL(g_v2, 16);
+	}
+}
+
+void HASH_compute(const uint8 * const key, const uint8 *data, const uint8 len, uint8 * const digest) {
+	uint32 k0 = HASH_load32(key);
+	uint32 k1 = HASH_load32(key + 4);
+	uint32 m;
+	uint8 left = len;
+	uint8 i;
+
+	/* initialization (64-bit digest) */
+	g_v0 = k0;
+	g_v1 = k1 ^ 0xEE;
+	g_v2 = k0 ^ 0x6C796765UL;
+	g_v3 = k1 ^ 0x74656462UL;
+
+	/* compression of each full 4 bytes word */
+	for (; left >= 4; left -= 4, data += 4) {
+		m = HASH_load32(data);
+		g_v3 ^= m;
+		HASH_rounds(C_ROUNDS);
+		g_v0 ^= m;
+	}
+
+	/* last word: remaining bytes + message length in the top byte */
+	m = (uint32)len << 24;
+	for (i = 0; i < left; i++)
+		m |= (uint32)data[i] << (8 * i);
+	g_v3 ^= m;
+	HASH_rounds(C_ROUNDS);
+	g_v0 ^= m;
+
+	/* finalization */
+	g_v2 ^= 0xEE;
+	HASH_rounds(D_ROUNDS);
+	HASH_store32(digest, g_v1 ^ g_v3);
+	g_v1 ^= 0xDD;
+	HASH_rounds(D_ROUNDS);
+	HASH_store32(digest + 4, g_v1 ^ g_v3);
+}
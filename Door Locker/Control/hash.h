@@ -0,0 +1,26 @@
+/* HalfSipHash-2-4 keyed hash (32-bit variant of SipHash designed for small MCUs) */
+
+/* Constraints:
+ * 64-bit key (used as the salt) and 64-bit digest only
+ * no lookup tables, works on 32-bit words
+ */
+
+
+#ifndef HASH_H_
+#define HASH_H_
+
+
+#include "std_types.h"
+#include "micro_config.h"
+#include "common_macros.h"
+
+
+#define HASH_KEY_SIZE 8			/* number of key (salt) bytes */
+#define HASH_SIZE 8				/* number of digest bytes */
+
+
+/* Calculate the digest of len bytes of data using a key (salt) */
+void HASH_compute(const uint8 * const key, const uint8 *data, const uint8 len, uint8 * const digest);
+
+
+#endif /* HASH_H_ */
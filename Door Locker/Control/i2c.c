@@ -1,100 +1,312 @@
-/* Driver for Atmega16 I2C (TWI) module */
-
-#include "i2c.h"
-
-
-void TWI_init(void) {
-	/* Initialize TWBR Register:
-	 * TWBR7:0 = 2				SCL division factor (400 kbps)
-	 */
-	TWBR = 2;
-
-	/* Initialize TWSR Register:
-	 * TWS7:3  = 00000			TWI status
-	 * reserved
-	 * TWPS1:0 = 00				SCL prescaler (400 kbps)
-	 */
-	TWSR = 0x00;
-	
-	/* Initialize TWAR Register:
-	 * TWA6:0 = TWI_ADDRESS		set device address in case it is a slave
-	 * TWGCE  = 0				disable generic call recognition
-	 */
-	TWAR = (TWI_ADDRESS << 1);
-	
-	/* Initialize TWCR Register:
-	 * TWINT = 0				TWI interrupt flag
-	 * TWEA  = 0				TWI enable acknowledge bit
-	 * TWSTA = 0				TWI send start bit
-	 * TWSTO = 0				TWI send stop bit
-	 * TWWC  = 0				TWI write collision flag
-	 * TWEN  = 1				enable TWI module
-	 * reserved
-	 * TWIE  = 0				disable TWI interrupts
-	 */
-	TWCR = (1 << TWEN);
-}
-
-void TWI_start(void) {
-	/* Clear the TWINT flag before sending the start bit TWINT=1
-	 * Send the start bit TWSTA=1
-	 * Enable TWI Module TWEN=1 
-	 */
-	TWCR = (1 << TWINT) | (1 << TWSTA) | (1 << TWEN);
-
-	/* Wait for TWINT flag set in TWCR Register (start bit is sent successfully) */
-	while(BIT_IS_CLEAR(TWCR,TWINT));
-}
-
-void TWI_stop(void) {
-	/* Clear the TWINT flag before sending the stop bit TWINT=1
-	 * send the stop bit TWSTO=1
-	 * Enable TWI Module TWEN=1 
-	 */
-	TWCR = (1 << TWINT) | (1 << TWSTO) | (1 << TWEN);
-}
-
-void TWI_write(uint8 data) {
-	/* Put data in TWI data register */
-	TWDR = data;
-
-	/* Clear the TWINT flag before sending the data TWINT=1
-	 * Enable TWI Module TWEN=1 
-	 */ 
-	TWCR = (1 << TWINT) | (1 << TWEN);
-
-	/* Wait for TWINT flag set in TWCR Register (data is sent successfully) */
-	while(BIT_IS_CLEAR(TWCR,TWINT));
-}
-
-uint8 TWI_readWithACK(void) {
-	/* Clear the TWINT flag before reading the data TWINT=1
-	 * Enable sending ACK after reading or receiving data TWEA=1
-	 * Enable TWI Module TWEN=1 
-	 */ 
-	TWCR = (1 << TWINT) | (1 << TWEN) | (1 << TWEA);
-
-	/* Wait for TWINT flag set in TWCR Register (data is received successfully) */
-	while(BIT_IS_CLEAR(TWCR,TWINT));
-
-	/* Read Data */
-	return TWDR;
-}
-
-uint8 TWI_readWithNACK(void) {
-	/* 
-	 * Clear the TWINT flag before reading the data TWINT=1
-	 * Enable TWI Module TWEN=1 
-	 */
-	TWCR = (1 << TWINT) | (1 << TWEN);
-	/* Wait for TWINT flag set in TWCR Register (data is received successfully) */
-	while(BIT_IS_CLEAR(TWCR,TWINT));
-
-	/* Read Data */
-	return TWDR;
-}
-
-uint8 TWI_getStatus(void) {
-	/* masking to eliminate first 3 bits and get the last 5 bits (status bits) */
-	return (TWSR & 0xF8);
-}
+/* Driver for Atmega16 I2C (TWI) module */
+
+#include "i2c.h"
+#include "trace.h"
+
+
+/* TWCR values used by the transaction engine (TWI enabled with interrupts) */
+#define TWCR_NEXT		((1 << TWINT) | (1 << TWEN) | (1 << TWIE))
+#define TWCR_START		(TWCR_NEXT | (1 << TWSTA))
+#define TWCR_ACK		(TWCR_NEXT | (1 << TWEA))
+#define TWCR_STOP		((1 << TWINT) | (1 << TWEN) | (1 << TWSTO))
+#define TWCR_STOP_START	(TWCR_START | (1 << TWSTO))		/* stop condition followed by a start condition */
+
+
+/* Global variables of the transaction in progress */
+static const TWI_Transaction * volatile g_transaction = NULL_PTR;
+static volatile uint8 g_index = 0;
+
+/* Global variable set while the callback of a finished transaction runs in the ISR */
+static volatile bool g_finishing = FALSE;
+
+/* Global variable set when the last bus operation didn't complete in time */
+static bool g_timed_out = FALSE;
+
+/* Global diagnostic counters */
+static uint16 g_timeouts = 0;
+static uint16 g_recoveries = 0;
+
+
+/* Wait for TWINT flag set in TWCR Register, at most TWI_TIMEOUT_US */
+static void TWI_wait(void) {
+	uint16 time;
+	for (time = 0; time < TWI_TIMEOUT_US; time++) {
+		if (BIT_IS_SET(TWCR,TWINT)) {
+			g_timed_out = FALSE;
+			return;
+		}
+		_delay_us(1);
+	}
+	g_timed_out = TRUE;
+	g_timeouts++;
+}
+
+
+/* End the current transaction then report its status
+ * (a transaction started by the callback gets its start condition right after the stop, without waiting) */
+static void TWI_finish(const uint8 status) {
+	const TWI_Transaction *transaction = g_transaction;
+	TRACE_POINT(TRACE_TWI_END, status);
+	g_transaction = NULL_PTR;
+	if (transaction->callback != NULL_PTR) {
+		g_finishing = TRUE;
+		transaction->callback(status);
+		g_finishing = FALSE;
+	}
+	TWCR = (g_transaction != NULL_PTR) ? TWCR_STOP_START : TWCR_STOP;
+}
+
+/* Interrupt Service Routine of the TWI transaction engine (one step per TWI event) */
+ISR(TWI_vect) {
+	const TWI_Transaction *transaction = g_transaction;
+	uint8 status = TWI_getStatus();
+
+	if (transaction == NULL_PTR) {
+		TWCR = (1 << TWEN);
+		return;
+	}
+
+	switch (status) {
+		case TW_START:
+			g_index = 0;
+			/* nothing to write: go to the read phase directly */
+			TWDR = (transaction->address << 1) | (transaction->write_len == 0);
+			TWCR = TWCR_NEXT;
+			break;
+
+		case TW_REP_START:
+			g_index = 0;
+			TWDR = (transaction->address << 1) | 1;
+			TWCR = TWCR_NEXT;
+			break;
+
+		case TW_MT_SLA_W_ACK:
+		case TW_MT_DATA_ACK:
+			if (g_index < transaction->write_len)
+				TWDR = transaction->write_buf[g_index++];
+			else if (transaction->read_len != 0) {
+				TWCR = TWCR_START;
+				break;
+			}
+			else {
+				TWI_finish(TW_DONE);
+				break;
+			}
+			TWCR = TWCR_NEXT;
+			break;
+
+		case TW_MT_SLA_R_ACK:
+			/* ACK every byte but the last one */
+			TWCR = (transaction->read_len > 1) ? TWCR_ACK : TWCR_NEXT;
+			break;
+
+		case TW_MR_DATA_ACK:
+			transaction->read_buf[g_index++] = TWDR;
+			TWCR = (g_index < transaction->read_len - 1) ? TWCR_ACK : TWCR_NEXT;
+			break;
+
+		case TW_MR_DATA_NACK:
+			transaction->read_buf[g_index] = TWDR;
+			TWI_finish(TW_DONE);
+			break;
+
+		default:
+			/* NACK from slave, arbitration lost OR bus error */
+			TWI_finish(status);
+			break;
+	}
+}
+
+
+void TWI_init(void) {
+	/* Initialize TWBR Register:
+	 * TWBR7:0 = 2				SCL division factor (400 kbps)
+	 */
+	TWBR = 2;
+
+	/* Initialize TWSR Register:
+	 * TWS7:3  = 00000			TWI status
+	 * reserved
+	 * TWPS1:0 = 00				SCL prescaler (400 kbps)
+	 */
+	TWSR = 0x00;
+	
+	/* Initialize TWAR Register:
+	 * TWA6:0 = TWI_ADDRESS		set device address in case it is a slave
+	 * TWGCE  = 0				disable generic call recognition
+	 */
+	TWAR = (TWI_ADDRESS << 1);
+	
+	/* Initialize TWCR Register:
+	 * TWINT = 0				TWI interrupt flag
+	 * TWEA  = 0				TWI enable acknowledge bit
+	 * TWSTA = 0				TWI send start bit
+	 * TWSTO = 0				TWI send stop bit
+	 * TWWC  = 0				TWI write collision flag
+	 * TWEN  = 1				enable TWI module
+	 * reserved
+	 * TWIE  = 0				disable TWI interrupts
+	 */
+	TWCR = (1 << TWEN);
+}
+
+void TWI_start(void) {
+	/* Clear the TWINT flag before sending the start bit TWINT=1
+	 * Send the start bit TWSTA=1
+	 * Enable TWI Module TWEN=1 
+	 */
+	TRACE_POINT(TRACE_TWI_START, 0);
+	TWCR = (1 << TWINT) | (1 << TWSTA) | (1 << TWEN);
+
+	/* Wait for TWINT flag set in TWCR Register (start bit is sent successfully) */
+	TWI_wait();
+}
+
+void TWI_stop(void) {
+	/* Clear the TWINT flag before sending the stop bit TWINT=1
+	 * send the stop bit TWSTO=1
+	 * Enable TWI Module TWEN=1 
+	 */
+	TWCR = (1 << TWINT) | (1 << TWSTO) | (1 << TWEN);
+	TRACE_POINT(TRACE_TWI_END, 0);
+}
+
+void TWI_write(uint8 data) {
+	/* Put data in TWI data register */
+	TWDR = data;
+
+	/* Clear the TWINT flag before sending the data TWINT=1
+	 * Enable TWI Module TWEN=1 
+	 */ 
+	TWCR = (1 << TWINT) | (1 << TWEN);
+
+	/* Wait for TWINT flag set in TWCR Register (data is sent successfully) */
+	TWI_wait();
+}
+
+uint8 TWI_readWithACK(void) {
+	/* Clear the TWINT flag before reading the data TWINT=1
+	 * Enable sending ACK after reading or receiving data TWEA=1
+	 * Enable TWI Module TWEN=1 
+	 */ 
+	TWCR = (1 << TWINT) | (1 << TWEN) | (1 << TWEA);
+
+	/* Wait for TWINT flag set in TWCR Register (data is received successfully) */
+	TWI_wait();
+
+	/* Read Data */
+	return TWDR;
+}
+
+uint8 TWI_readWithNACK(void) {
+	/* 
+	 * Clear the TWINT flag before reading the data TWINT=1
+	 * Enable TWI Module TWEN=1 
+	 */
+	TWCR = (1 << TWINT) | (1 << TWEN);
+	/* Wait for TWINT flag set in TWCR Register (data is received successfully) */
+	TWI_wait();
+
+	/* Read Data */
+	return TWDR;
+}
+
+uint8 TWI_getStatus(void) {
+	/* the status register is meaningless if the last operation never completed */
+	if (g_timed_out)
+		return TW_TIMEOUT;
+
+	/* masking to eliminate first 3 bits and get the last 5 bits (status bits) */
+	return (TWSR & 0xF8);
+}
+
+bool TWI_startTransaction(const TWI_Transaction * const transaction) {
+	uint16 time;
+	if (g_transaction != NULL_PTR)
+		return FALSE;
+
+	g_transaction = transaction;
+	g_timed_out = FALSE;
+
+	/* started by the callback of the previous one: TWI_finish sends the stop and start bits */
+	if (g_finishing) {
+		TRACE_POINT(TRACE_TWI_START, transaction->address);
+		return TRUE;
+	}
+
+	/* a stop bit of the previous transaction may still be in progress */
+	for (time = 0; time < TWI_TIMEOUT_US && BIT_IS_SET(TWCR,TWSTO); time++)
+		_delay_us(1);
+
+	/* the rest of the transaction is done by the ISR */
+	TRACE_POINT(TRACE_TWI_START, transaction->address);
+	TWCR = TWCR_START;
+	return TRUE;
+}
+
+bool TWI_isBusy(void) {
+	return (g_transaction != NULL_PTR);
+}
+
+void TWI_cancelTransaction(void) {
+	const TWI_Transaction *transaction;
+	uint8 sreg = SREG;
+
+	/* the ISR may finish the transaction meanwhile: take it and clear it at once so its callback runs once */
+	cli();
+	transaction = g_transaction;
+	g_transaction = NULL_PTR;
+	SREG = sreg;
+	if (transaction == NULL_PTR)
+		return;
+
+	g_timeouts++;
+	TRACE_POINT(TRACE_TWI_END, TW_TIMEOUT);
+	TWI_recoverBus();
+	if (transaction->callback != NULL_PTR)
+		transaction->callback(TW_TIMEOUT);
+}
+
+void TWI_recoverBus(void) {
+	uint8 i;
+	g_recoveries++;
+
+	/* disable the TWI module to drive SCL (PC0) and SDA (PC1) as open drain pins:
+	 * output low to pull the line down, input to release it to the pull up resistor */
+	TWCR = 0;
+	CLEAR_BIT(PORTC,PC0);
+	CLEAR_BIT(PORTC,PC1);
+	CLEAR_BIT(DDRC,PC0);
+	CLEAR_BIT(DDRC,PC1);
+
+	/* a slave holding SDA low is in the middle of sending a byte,
+	 * clock it out with up to 9 SCL pulses until it releases SDA */
+	for (i = 0; i < 9 && BIT_IS_CLEAR(PINC,PC1); i++) {
+		SET_BIT(DDRC,PC0);			/* SCL low */
+		_delay_us(5);
+		CLEAR_BIT(DDRC,PC0);		/* SCL high */
+		_delay_us(5);
+	}
+
+	/* generate a stop condition: SDA rises while SCL is high */
+	SET_BIT(DDRC,PC0);				/* SCL low */
+	_delay_us(5);
+	SET_BIT(DDRC,PC1);				/* SDA low */
+	_delay_us(5);
+	CLEAR_BIT(DDRC,PC0);			/* SCL high */
+	_delay_us(5);
+	CLEAR_BIT(DDRC,PC1);			/* SDA high */
+	_delay_us(5);
+
+	/* give the pins back to the TWI module */
+	g_timed_out = FALSE;
+	TWI_init();
+}
+
+uint16 TWI_getTimeoutCount(void) {
+	return g_timeouts;
+}
+
+uint16 TWI_getRecoveryCount(void) {
+	return g_recoveries;
+}
@@ -1,54 +1,94 @@
-/* Driver for Atmega16 I2C (TWI) module */
-
-/* Constraints:
- * Supports polling only (no iterrupts)
- * communication speed = 400 kbps always
- * generic call recognition is disabled
- */
-
-
-#ifndef I2C_H_
-#define I2C_H_
-
-
-#include "std_types.h"
-#include "micro_config.h"
-#include "common_macros.h"
-
-
-#define TWI_ADDRESS 1
-
-
-/* I2C Status Bits in the TWSR Register */
-#define TW_START		0x08	/* start has been sent */
-#define TW_REP_START	0x10	/* repeated start */
-#define TW_MT_SLA_W_ACK	0x18	/* Master transmit (slave address + Write request) + ACK received from slave */
-#define TW_MT_SLA_R_ACK	0x40	/* Master transmit (slave address + Read request) + ACK received from slave */
-#define TW_MT_DATA_ACK	0x28	/* Master transmit data + ACK received from slave */
-#define TW_MR_DATA_ACK	0x50	/* Master received data + master sent ACK to slave */
-#define TW_MR_DATA_NACK	0x58	/* Master received data + master didn't send ACK to slave */
-
-
-/* Initialize the TWI module */
-void TWI_init(void);
-
-/* Send a start bit */
-void TWI_start(void);
-
-/* Send a stop bit */
-void TWI_stop(void);
-
-/* Send data */
-void TWI_write(uint8 data);
-
-/* Read then send an ACK */
-uint8 TWI_readWithACK(void);
-
-/* Read then send a NACK */
-uint8 TWI_readWithNACK(void);
-
-/* Get the TWI status */
-uint8 TWI_getStatus(void);
-
-
-#endif /* I2C_H_ */
+/* Driver for Atmega16 I2C (TWI) module */
+
+/* Constraints:
+ * Supports polling (byte level functions) and interrupts (whole transactions)
+ * polling functions must not be used while an interrupt driven transaction is in progress
+ * communication speed = 400 kbps always
+ * generic call recognition is disabled
+ */
+
+
+#ifndef I2C_H_
+#define I2C_H_
+
+
+#include "std_types.h"
+#include "micro_config.h"
+#include "common_macros.h"
+
+
+#define TWI_ADDRESS 1
+
+/* Max time to wait for one bus operation (one byte takes ~25us at 400 kbps) */
+#define TWI_TIMEOUT_US 1000
+
+
+/* I2C Status Bits in the TWSR Register */
+#define TW_START		0x08	/* start has been sent */
+#define TW_REP_START	0x10	/* repeated start */
+#define TW_MT_SLA_W_ACK	0x18	/* Master transmit (slave address + Write request) + ACK received from slave */
+#define TW_MT_SLA_W_NACK 0x20	/* Master transmit (slave address + Write request) + NACK received from slave */
+#define TW_MT_SLA_R_ACK	0x40	/* Master transmit (slave address + Read request) + ACK received from slave */
+#define TW_MT_DATA_ACK	0x28	/* Master transmit data + ACK received from slave */
+#define TW_MR_DATA_ACK	0x50	/* Master received data + master sent ACK to slave */
+#define TW_MR_DATA_NACK	0x58	/* Master received data + master didn't send ACK to slave */
+
+#define TW_BUS_ERROR	0x00	/* Illegal start or stop condition */
+
+/* Statuses that are not TWSR values */
+#define TW_DONE			0xFF	/* transaction callback: all bytes are transferred */
+#define TW_TIMEOUT		0x01	/* the last operation didn't complete in time (bus is stuck) */
+
+
+typedef struct {
+	uint8 address;						/* 7-bit slave address */
+	const uint8 *write_buf;				/* bytes sent first */
+	uint8 write_len;
+	uint8 *read_buf;					/* bytes received after a repeated start (if read_len != 0) */
+	uint8 read_len;
+	void (*callback)(const uint8 status);	/* called from the ISR with TW_DONE OR the failing TWI status */
+} TWI_Transaction;
+
+
+/* Initialize the TWI module */
+void TWI_init(void);
+
+/* Send a start bit */
+void TWI_start(void);
+
+/* Send a stop bit */
+void TWI_stop(void);
+
+/* Send data */
+void TWI_write(uint8 data);
+
+/* Read then send an ACK */
+uint8 TWI_readWithACK(void);
+
+/* Read then send a NACK */
+uint8 TWI_readWithNACK(void);
+
+/* Get the TWI status */
+uint8 TWI_getStatus(void);
+
+/* Start an interrupt driven transaction (START, SLA+W, data, repeated START, SLA+R, data, STOP)
+ * the transaction must stay in memory until its callback is called, the callback can start the next one
+ * (its start bit follows the stop bit, the ISR never waits for the bus)
+ * returns FALSE if another transaction is still in progress */
+bool TWI_startTransaction(const TWI_Transaction * const transaction);
+
+/* Check if an interrupt driven transaction is in progress */
+bool TWI_isBusy(void);
+
+/* Abort the interrupt driven transaction in progress (its callback gets TW_TIMEOUT) and recover the bus */
+void TWI_cancelTransaction(void);
+
+/* Free a stuck bus: clock out up to 9 SCL pulses, send a stop bit then initialize the TWI module again */
+void TWI_recoverBus(void);
+
+/* Get the diagnostic counters of bus operations that timed out and of bus recoveries */
+uint16 TWI_getTimeoutCount(void);
+uint16 TWI_getRecoveryCount(void);
+
+
+#endif /* I2C_H_ */
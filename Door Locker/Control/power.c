@@ -0,0 +1,91 @@
+/* Driver for Atmega16 sleep modes and CPU duty cycle measurement */
+
+#include <avr/sleep.h>
+#include "power.h"
+#include "timers.h"
+
+
+/* Global time base: number of TIMER2 overflows */
+static volatile uint32 g_overflows = 0;
+
+/* Global measurement of the current period (in TIMER2 counts) */
+static uint32 g_period_start = 0;
+static uint32 g_asleep = 0;
+
+
+static uint32 POWER_now(void);
+static void POWER_overflow(void);
+
+
+void POWER_init(void) {
+	TIMERS_ConfigType timer2_config = {TIMER2, NORMAL, F_T2S_1024, DISCONNECT_OC, 0, 0};
+
+	SET_BIT(ACSR,ACD);				/* analog comparator off */
+	TIMERS_setCallBack(TIMER2, NORMAL, POWER_overflow);
+	TIMERS_init(&timer2_config);
+	cli();
+	g_period_start = POWER_now();
+	g_asleep = 0;
+	sei();
+}
+
+void POWER_idle(void) {
+	uint32 start = POWER_now();
+
+	/* sei takes effect after the next instruction, so no interrupt can come before sleeping */
+	set_sleep_mode(SLEEP_MODE_IDLE);
+	sleep_enable();
+	sei();
+	sleep_cpu();
+	sleep_disable();
+
+	cli();
+	g_asleep += POWER_now() - start;
+	sei();
+}
+
+void POWER_delayMs(const uint16 ms) {
+	uint32 start;
+	uint32 counts = ((uint32)ms * POWER_COUNTS_PER_SECOND) / 1000;
+
+	cli();
+	start = POWER_now();
+	/* TIMER2 overflow wakes the CPU at least every 32.768 ms */
+	while (POWER_now() - start < counts) {
+		POWER_idle();
+		cli();
+	}
+	sei();
+}
+
+uint16 POWER_getDutyCycle(void) {
+	uint32 now, total, asleep;
+
+	cli();
+	now = POWER_now();
+	total = now - g_period_start;
+	asleep = g_asleep;
+	g_period_start = now;
+	g_asleep = 0;
+	sei();
+
+	if (total == 0)
+		return 0;
+	return (uint16)(((total - asleep) * 1000) / total);
+}
+
+/* Get the TIMER2 counts since POWER_init (must be called with global interrupts disabled) */
+static uint32 POWER_now(void) {
+	uint8 count = TCNT2;
+	uint32 overflows = g_overflows;
+
+	/* an overflow not handled yet (interrupts are disabled) */
+	if (BIT_IS_SET(TIFR,TOV2) && count < 128)
+		overflows++;
+	return (overflows << 8) | count;
+}
+
+/* Called from the ISR on TIMER2 overflow */
+static void POWER_overflow(void) {
+	g_overflows++;
+}
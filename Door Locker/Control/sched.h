@@ -0,0 +1,47 @@
+/* Driver for a cooperative run-to-completion scheduler */
+
+/* ISRs and tasks post events, SCHED_run calls the handler of each posted event in FIFO order
+ * (each handler runs to completion, it never waits) and sleeps when no event is posted
+ * An event is queued at most once: posting an event already waiting does nothing, so the
+ * queue can't overflow and the handler must process everything available when it runs
+ */
+
+/* Constraints:
+ * the handlers run in the main loop with global interrupts enabled
+ * SCHED_post can be called from an ISR OR a handler
+ * uses POWER_idle to sleep (POWER_init must be called first)
+ * This file must be identical in both HMI and Control projects
+ */
+
+
+#ifndef SCHED_H_
+#define SCHED_H_
+
+
+#include "std_types.h"
+#include "micro_config.h"
+#include "common_macros.h"
+
+
+/* Scheduler configurations */
+#define SCHED_EVENTS 8				/* number of events (ids 0 -> SCHED_EVENTS-1, max 8) */
+
+
+/* Drop all posted events and handlers */
+void SCHED_init(void);
+
+/* Set the function called when the event is posted */
+void SCHED_setHandler(const uint8 event, void (*f_ptr)(void));
+
+/* Set the function called with global interrupts disabled before sleeping when no event is posted,
+ * it must only check the state and post the events of the work left (polled conditions) */
+void SCHED_setIdleCheck(void (*f_ptr)(void));
+
+/* Queue an event if it isn't waiting already */
+void SCHED_post(const uint8 event);
+
+/* Dispatch the posted events forever (main ends with it) */
+void SCHED_run(void) __attribute__((noreturn));
+
+
+#endif /* SCHED_H_ */
@@ -0,0 +1,115 @@
+/* Log-structured record store in the external EEPROM (wear leveling) */
+
+#include "external_eeprom.h"
+#include "protocol.h"
+#include "store.h"
+
+
+#if (STORE_RECORDS & (STORE_RECORDS - 1)) != 0
+#error "STORE_RECORDS must be a power of 2"
+#endif
+
+#if (STORE_RECORD_SIZE % EEPROM_PAGE_SIZE) != 0 || (STORE_ADDRESS % EEPROM_PAGE_SIZE) != 0
+#error "store slots must be page aligned"
+#endif
+
+#define SLOT_ADDRESS(slot) (STORE_ADDRESS + (uint16)(slot) * STORE_RECORD_SIZE)
+#define NEXT_SLOT(slot) (((slot) + 1) & (STORE_RECORDS - 1))
+#define PREVIOUS_SLOT(slot) (((slot) - 1) & (STORE_RECORDS - 1))
+
+
+/* Global position of the latest valid record (the next record is appended after it) */
+static uint8 g_slot = STORE_RECORDS - 1;
+static uint16 g_seq = 0xFFFF;
+
+/* Global variables of the append in progress */
+static uint8 g_record[STORE_RECORD_SIZE];
+static void (*g_callback)(const uint8 result);
+
+
+static uint8 STORE_readSeq(const uint8 slot, uint16 * const seq);
+static uint8 STORE_readRecord(const uint8 slot, uint16 * const seq);
+static void STORE_appendDone(const uint8 result);
+
+
+uint8 STORE_load(uint8 * const data, const uint8 len) {
+	uint8 first, last, middle;
+	uint8 i, j;
+	uint16 seq0, seq;
+
+	/* records are appended in slot order, so from slot 0 the sequence numbers go up by one
+	 * until the latest record, then the older records of the previous round follow
+	 * binary search for the last slot continuing the sequence of slot 0 */
+	first = 0;
+	last = STORE_RECORDS;
+	if (STORE_readSeq(0, &seq0) == SUCCESS) {
+		while (last - first > 1) {
+			middle = (first + last) / 2;
+			if (STORE_readSeq(middle, &seq) == SUCCESS && seq == (uint16)(seq0 + middle))
+				first = middle;
+			else
+				last = middle;
+		}
+	}
+
+	/* the latest record may be cut by a power loss, go back to the newest valid one */
+	for (i = 0; i < STORE_RECORDS; i++, first = PREVIOUS_SLOT(first)) {
+		if (STORE_readRecord(first, &seq) == ERROR)
+			continue;
+
+		g_slot = first;
+		g_seq = seq;
+		for (j = 0; j < len && j < STORE_DATA_SIZE; j++)
+			data[j] = g_record[2 + j];
+		return SUCCESS;
+	}
+
+	/* the store is empty, the first record goes to slot 0 */
+	g_slot = STORE_RECORDS - 1;
+	g_seq = 0xFFFF;
+	return ERROR;
+}
+
+uint8 STORE_appendAsync(const uint8 * const data, const uint8 len, void (*callback)(const uint8 result)) {
+	uint8 i;
+	uint16 seq = g_seq + 1;
+
+	/* the slot after the latest record holds an older version (OR a record cut by a power loss)
+	 * so it is reused, the latest record is never overwritten until the new one is complete */
+	g_record[0] = (uint8)seq;
+	g_record[1] = (uint8)(seq >> 8);
+	for (i = 0; i < STORE_DATA_SIZE; i++)
+		g_record[2 + i] = (i < len) ? data[i] : 0xFF;
+	g_record[STORE_RECORD_SIZE - 1] = PROTOCOL_crc8(STORE_CRC_INIT, g_record, STORE_RECORD_SIZE - 1);
+
+	g_callback = callback;
+	return EEPROM_writePageAsync(SLOT_ADDRESS(NEXT_SLOT(g_slot)), g_record, STORE_RECORD_SIZE, STORE_appendDone);
+}
+
+/* Read the sequence number of a slot only (2 bytes) */
+static uint8 STORE_readSeq(const uint8 slot, uint16 * const seq) {
+	uint8 buf[2];
+	if (EEPROM_readBlock(SLOT_ADDRESS(slot), buf, 2) == ERROR)
+		return ERROR;
+	*seq = buf[0] | ((uint16)buf[1] << 8);
+	return SUCCESS;
+}
+
+/* Read a whole slot in g_record, returns ERROR if it doesn't hold a valid record */
+static uint8 STORE_readRecord(const uint8 slot, uint16 * const seq) {
+	if (EEPROM_readBlock(SLOT_ADDRESS(slot), g_record, STORE_RECORD_SIZE) == ERROR ||
+		PROTOCOL_crc8(STORE_CRC_INIT, g_record, STORE_RECORD_SIZE - 1) != g_record[STORE_RECORD_SIZE - 1])
+		return ERROR;
+	*seq = g_record[0] | ((uint16)g_record[1] << 8);
+	return SUCCESS;
+}
+
+/* Called from the ISR when the new record is written */
+static void STORE_appendDone(const uint8 result) {
+	if (result == SUCCESS) {
+		g_slot = NEXT_SLOT(g_slot);
+		g_seq++;
+	}
+	if (g_callback != NULL_PTR)
+		g_callback(result);
+}
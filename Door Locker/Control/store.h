@@ -0,0 +1,50 @@
+/* Log-structured record store in the external EEPROM (wear leveling) */
+
+/* Record format (one record every STORE_RECORD_SIZE bytes, page aligned):
+ * | SEQ (2 bytes, little endian) | DATA (STORE_DATA_SIZE bytes) | CRC |
+ * SEQ = sequence number, incremented by one for every appended record
+ * CRC = CRC-8 (same as the protocol, initial value STORE_CRC_INIT) of SEQ and DATA
+ *
+ * Every change appends a new version of the data to the next slot of a ring instead of
+ * rewriting the same address, so the wear is spread over all the slots
+ * The latest version is the valid record with the highest SEQ, a record cut by a power loss
+ * fails its CRC and the version before it is used instead
+ */
+
+/* Constraints:
+ * one data item per store (the latest record is the only live one)
+ * requires an initialized EEPROM driver and global interrupts enabled for STORE_appendAsync
+ */
+
+
+#ifndef STORE_H_
+#define STORE_H_
+
+
+#include "std_types.h"
+#include "micro_config.h"
+#include "common_macros.h"
+
+
+#define ERROR 0
+#define SUCCESS 1
+
+/* Store configurations */
+#define STORE_ADDRESS 0x0100		/* address of the first slot (page aligned) */
+#define STORE_RECORD_SIZE 32		/* number of bytes of a slot (multiple of EEPROM_PAGE_SIZE) */
+#define STORE_RECORDS 16			/* number of slots in the ring (power of 2) */
+#define STORE_DATA_SIZE (STORE_RECORD_SIZE - 3)		/* max number of data bytes in a record */
+#define STORE_CRC_INIT 0xFF			/* CRC initial value (rejects erased AND zeroed slots) */
+
+
+/* Find the latest valid record and copy its data (len bytes), returns ERROR if there is none
+ * must be called once before appending */
+uint8 STORE_load(uint8 * const data, const uint8 len);
+
+/* Append a new version of the data (len bytes) in the background
+ * returns ERROR if the EEPROM is busy, otherwise the callback is called from the ISR
+ * with SUCCESS OR ERROR when done (the data is copied, it doesn't have to stay in memory) */
+uint8 STORE_appendAsync(const uint8 * const data, const uint8 len, void (*callback)(const uint8 result));
+
+
+#endif /* STORE_H_ */
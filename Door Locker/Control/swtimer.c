@@ -0,0 +1,142 @@
+/* Driver for software timers (one-shot OR periodic) on one periodic hardware tick */
+
+#include "swtimer.h"
+
+
+#if (SWTIMER_WHEEL_SIZE & (SWTIMER_WHEEL_SIZE - 1)) != 0
+#error "SWTIMER_WHEEL_SIZE must be a power of 2"
+#endif
+#if (SWTIMER_COUNT > 8)
+#error "SWTIMER_COUNT must be at most 8"
+#endif
+
+#define NONE 0xFF					/* end of a slot list OR timer not in the wheel */
+
+
+/* Global state of each timer: slot, full rounds of the wheel left, period, callback
+ * and neighbours in the list of its slot */
+static uint8 g_slot[SWTIMER_COUNT];
+static uint16 g_rounds[SWTIMER_COUNT];
+static uint16 g_period[SWTIMER_COUNT];
+static void (*g_callback[SWTIMER_COUNT])(void);
+static uint8 g_next[SWTIMER_COUNT];
+static uint8 g_prev[SWTIMER_COUNT];
+
+/* Global wheel: first timer of each slot and current position */
+static uint8 g_wheel[SWTIMER_WHEEL_SIZE];
+static uint8 g_position = 0;
+
+/* Global bit mask of the expired timers waiting for SWTIMER_dispatch */
+static volatile uint8 g_expired = 0;
+
+
+static void SWTIMER_insert(const uint8 id, const uint16 ticks);
+static void SWTIMER_remove(const uint8 id);
+
+
+void SWTIMER_init(void) {
+	uint8 i;
+
+	cli();
+	for (i = 0; i < SWTIMER_WHEEL_SIZE; i++)
+		g_wheel[i] = NONE;
+	for (i = 0; i < SWTIMER_COUNT; i++)
+		g_slot[i] = NONE;
+	g_expired = 0;
+	sei();
+}
+
+void SWTIMER_start(const uint8 id, const uint16 ticks, const uint16 period, void (*f_ptr)(void)) {
+	cli();
+	if (g_slot[id] != NONE)
+		SWTIMER_remove(id);
+	g_expired &= ~(1<<id);
+	g_period[id] = period;
+	g_callback[id] = f_ptr;
+	SWTIMER_insert(id, (ticks == 0) ? 1 : ticks);
+	sei();
+}
+
+void SWTIMER_cancel(const uint8 id) {
+	cli();
+	if (g_slot[id] != NONE)
+		SWTIMER_remove(id);
+	g_expired &= ~(1<<id);
+	sei();
+}
+
+bool SWTIMER_isRunning(const uint8 id) {
+	/* a slot is only written with interrupts disabled, reading one byte is atomic */
+	return (g_slot[id] != NONE) ? TRUE : FALSE;
+}
+
+bool SWTIMER_tick(void) {
+	uint8 id, next;
+	bool expired = FALSE;
+
+	g_position = (g_position + 1) & (SWTIMER_WHEEL_SIZE - 1);
+
+	/* the next timer is saved first: an expired periodic timer can move to the same slot */
+	for (id = g_wheel[g_position]; id != NONE; id = next) {
+		next = g_next[id];
+		if (g_rounds[id] != 0) {
+			g_rounds[id]--;
+			continue;
+		}
+		SWTIMER_remove(id);
+		if (g_callback[id] != NULL_PTR) {
+			g_expired |= (1<<id);
+			expired = TRUE;
+		}
+		if (g_period[id] != 0)
+			SWTIMER_insert(id, g_period[id]);
+	}
+	return expired;
+}
+
+bool SWTIMER_isPending(void) {
+	return (g_expired != 0) ? TRUE : FALSE;
+}
+
+void SWTIMER_dispatch(void) {
+	uint8 id;
+	void (*f_ptr)(void);
+
+	for (id = 0; id < SWTIMER_COUNT; id++) {
+		/* take the expiry before calling back, the callback may restart its timer */
+		cli();
+		if (!(g_expired & (1<<id))) {
+			sei();
+			continue;
+		}
+		g_expired &= ~(1<<id);
+		f_ptr = g_callback[id];
+		sei();
+		(*f_ptr)();
+	}
+}
+
+/* Link a timer at the head of the slot it expires in (interrupts disabled) */
+static void SWTIMER_insert(const uint8 id, const uint16 ticks) {
+	uint8 slot = (g_position + ticks) & (SWTIMER_WHEEL_SIZE - 1);
+
+	/* the slot is visited after (ticks - 1) % SWTIMER_WHEEL_SIZE + 1 ticks, then every full round */
+	g_rounds[id] = (ticks - 1) / SWTIMER_WHEEL_SIZE;
+	g_slot[id] = slot;
+	g_prev[id] = NONE;
+	g_next[id] = g_wheel[slot];
+	if (g_wheel[slot] != NONE)
+		g_prev[g_wheel[slot]] = id;
+	g_wheel[slot] = id;
+}
+
+/* Unlink a timer from its slot (interrupts disabled) */
+static void SWTIMER_remove(const uint8 id) {
+	if (g_prev[id] != NONE)
+		g_next[g_prev[id]] = g_next[id];
+	else
+		g_wheel[g_slot[id]] = g_next[id];
+	if (g_next[id] != NONE)
+		g_prev[g_next[id]] = g_prev[id];
+	g_slot[id] = NONE;
+}
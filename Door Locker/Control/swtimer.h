@@ -0,0 +1,56 @@
+/* Driver for software timers (one-shot OR periodic) on one periodic hardware tick */
+
+/* The timers are kept in a hashed timer wheel: SWTIMER_WHEEL_SIZE slots, each one a doubly
+ * linked list of the timers expiring at that position (after some full rounds of the wheel),
+ * so starting and cancelling a timer is O(1) and a tick only walks the timers of one slot
+ */
+
+/* Constraints:
+ * SWTIMER_tick must be called from the ISR of one periodic hardware timer
+ * the callbacks run from SWTIMER_dispatch in the main loop, not in the ISR
+ * (an expired timer whose callback didn't run yet is dispatched once even if it expired again)
+ * SWTIMER_start and SWTIMER_cancel must not be called from an ISR
+ * requires global interrupts enabled
+ * This file must be identical in both HMI and Control projects
+ */
+
+
+#ifndef SWTIMER_H_
+#define SWTIMER_H_
+
+
+#include "std_types.h"
+#include "micro_config.h"
+#include "common_macros.h"
+
+
+/* Software timer configurations */
+#define SWTIMER_COUNT 8				/* number of timers (ids 0 -> SWTIMER_COUNT-1, max 8) */
+#define SWTIMER_WHEEL_SIZE 16		/* number of wheel slots (power of 2) */
+
+
+/* Stop all the timers */
+void SWTIMER_init(void);
+
+/* Start (OR restart) the timer id to expire after ticks ticks (min 1), then every period ticks
+ * (0 for a one-shot timer), f_ptr is called from SWTIMER_dispatch on each expiry (can be NULL_PTR) */
+void SWTIMER_start(const uint8 id, const uint16 ticks, const uint16 period, void (*f_ptr)(void));
+
+/* Stop the timer id, its callback isn't called even if it already expired */
+void SWTIMER_cancel(const uint8 id);
+
+/* Check if the timer id is started and not expired yet (periodic timers run until cancelled) */
+bool SWTIMER_isRunning(const uint8 id);
+
+/* Advance the wheel by one tick, called from the ISR of the hardware timer
+ * returns TRUE if a timer with a callback expired (SWTIMER_dispatch has work to do) */
+bool SWTIMER_tick(void);
+
+/* Check if there are expired timers whose callbacks didn't run yet */
+bool SWTIMER_isPending(void);
+
+/* Call the callbacks of the expired timers */
+void SWTIMER_dispatch(void);
+
+
+#endif /* SWTIMER_H_ */
@@ -0,0 +1,145 @@
+/* Driver for the trace buffer: timestamped events of the drivers recorded in a RAM ring */
+
+/* The trace points (TRACE_POINT in the main program, TRACE_POINT_ISR in the ISRs, TRACE_ISR around the
+ * callbacks of timers.c) record an event id, an argument byte and the TIMER1 count in a ring of TRACE_SIZE
+ * records (the oldest ones are overwritten). The TIMER1 wrap ISR counts the wraps, the next event is
+ * preceded by a TRACE_WRAPS record of their number, so an idle firmware records nothing.
+ * A DUMP_TRACE request stops the recording while the ring is sent in TRACE_DATA frames.
+ */
+
+/* Constraints:
+ * built only with -DTRACE: without it the trace points and TRACE_init compile to nothing
+ * TIMER1 is the time base: TRACE_init starts it free running at F_CPU / 8 if the firmware doesn't
+ * run it (HMI: 1 us resolution, its overflow interrupt counts the wraps every 65.5 ms), otherwise its
+ * mode is kept (Control: 10 ms system tick, CTC at F_CPU / 64: 8 us resolution, so the entry and exit
+ * of a short ISR show the same time), HASH_BENCHMARK reprograms TIMER1
+ * the decoder (Host/tracedump.c) unwraps the count, a gap of more than 255 wraps is shown as 255 wraps
+ * TRACE_EVENTS selects the recorded events, TRACE_ISR_VECTORS the ISRs of timers.c whose entry and exit
+ * are recorded (by default not the periodic ones: HMI and Control system ticks, POWER time base and
+ * TIMER1 wraps, they would fill the ring within a few ms)
+ * a trace point takes about 20 CPU cycles with the interrupts disabled (the masks are constant folded)
+ * TRACE_sendDump only answers the request, the records follow in one TRACE_DATA frame per TRACE_continueDump
+ * call when the UART TX buffer can take it (about 0.5 s for a full ring at 9600 baud): the firmware calls it
+ * from a scheduler handler posted while TRACE_isDumpReady, then the recording resumes
+ * This file must be identical in both HMI and Control projects
+ */
+
+
+#ifndef TRACE_H_
+#define TRACE_H_
+
+
+#include "std_types.h"
+#include "micro_config.h"
+#include "common_macros.h"
+#include "protocol.h"
+
+
+/* Trace configurations */
+#define TRACE_SIZE 64				/* number of records (power of 2, 4 bytes each) */
+#define TRACE_EVENTS 0x0FFE			/* recorded events (bit = event id): all */
+#define TRACE_ISR_VECTORS (~((1UL << TIMER0_COMP_vect_num) | (1UL << TIMER1_COMPA_vect_num) | \
+	(1UL << TIMER1_OVF_vect_num) | (1UL << TIMER2_OVF_vect_num)))		/* bit = vector number */
+
+/* Event ids (argument of the event) */
+#define TRACE_ISR_ENTRY 1			/* TIMERS ISR entry (vector number) */
+#define TRACE_ISR_EXIT 2			/* TIMERS ISR exit (vector number) */
+#define TRACE_UART_TX 3				/* byte written to UDR (data) */
+#define TRACE_UART_RX 4				/* byte read from UDR (data) */
+#define TRACE_TWI_START 5			/* TWI transaction start (slave address, 0 for a polled start condition) */
+#define TRACE_TWI_END 6				/* TWI transaction end (TWI status, 0 for a polled stop condition) */
+#define TRACE_LCD_COMMAND 7			/* instruction written to the LCD (instruction) */
+#define TRACE_LCD_DATA 8			/* character written to the LCD (character) */
+#define TRACE_KEY_PRESS 9			/* keypad event queued (key) */
+#define TRACE_KEY_RELEASE 10
+#define TRACE_KEY_LONG_PRESS 11
+#define TRACE_WRAPS 12				/* TIMER1 wraps since the previous record (number, max 255), always recorded */
+
+typedef struct {
+	uint8 id;
+	uint8 arg;
+	uint16 time;					/* TIMER1 count */
+} TRACE_Record;
+
+
+#ifdef TRACE
+
+/* Global ring of records, written by the trace points */
+extern TRACE_Record g_trace_ring[TRACE_SIZE];
+extern volatile uint8 g_trace_head;
+extern volatile uint16 g_trace_total;
+extern volatile bool g_trace_on;
+
+/* Global TIMER1 wraps since the last record and the vector of the wrap ISR */
+extern volatile uint8 g_trace_wraps;
+extern uint8 g_trace_wrap_vector;
+
+/* Record the pending wraps (called by the trace points, the global interrupts are disabled) */
+void TRACE_recordWraps(const uint16 time);
+
+/* Write a record (the global interrupts are disabled) */
+#define TRACE_WRITE(event, value, count) do { \
+		TRACE_Record *trace_record = &g_trace_ring[g_trace_head]; \
+		trace_record->time = (count); \
+		trace_record->id = (event); \
+		trace_record->arg = (value); \
+		g_trace_head = (g_trace_head + 1) & (TRACE_SIZE - 1); \
+		g_trace_total++; \
+	} while (0)
+
+/* Record an event from an ISR (the global interrupts are disabled) */
+#define TRACE_POINT_ISR(event, value) do { \
+		if (((TRACE_EVENTS >> (event)) & 1) && g_trace_on) { \
+			uint16 trace_time = TCNT1; \
+			if (g_trace_wraps != 0) \
+				TRACE_recordWraps(trace_time); \
+			TRACE_WRITE(event, value, trace_time); \
+		} \
+	} while (0)
+
+/* Record an event from the main program */
+#define TRACE_POINT(event, value) do { \
+		uint8 trace_sreg = SREG; \
+		cli(); \
+		TRACE_POINT_ISR(event, value); \
+		SREG = trace_sreg; \
+	} while (0)
+
+/* Record the entry OR exit of a TIMERS ISR selected by TRACE_ISR_VECTORS */
+#define TRACE_ISR(event, vector) do { \
+		if ((TRACE_ISR_VECTORS >> (vector)) & 1) \
+			TRACE_POINT_ISR(event, vector); \
+	} while (0)
+
+/* Count a wrap of TIMER1 (called at the entry of its ISRs) */
+#define TRACE_WRAP(vector) do { \
+		if ((vector) == g_trace_wrap_vector && g_trace_wraps != 0xFF) \
+			g_trace_wraps++; \
+	} while (0)
+
+
+/* Start the time base (if TIMER1 is stopped), its wraps count and the recording */
+void TRACE_init(void);
+
+/* Answer a DUMP_TRACE request: ACK with the number of records, the records since TRACE_init,
+ * the TIMER1 clock select and top, then start sending the records from the oldest */
+void TRACE_sendDump(const PROTOCOL_Frame * const request);
+
+/* Check if the next TRACE_DATA frame of the dump in progress can be sent without waiting */
+bool TRACE_isDumpReady(void);
+
+/* Send the next TRACE_DATA frame of the dump in progress if it fits in the UART TX buffer */
+void TRACE_continueDump(void);
+
+#else
+
+#define TRACE_POINT_ISR(event, value) do { } while (0)
+#define TRACE_POINT(event, value) do { } while (0)
+#define TRACE_ISR(event, vector) do { } while (0)
+#define TRACE_WRAP(vector) do { } while (0)
+#define TRACE_init() do { } while (0)
+
+#endif /* TRACE */
+
+
+#endif /* TRACE_H_ */
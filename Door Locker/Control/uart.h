@@ -1,69 +1,99 @@
-/* Driver for Atmega16 UART module */
-
-/* Constraints:
- * Supports polling only (no iterrupts)
- * Multi-processor communication mode is always disabled
- * Both RX and TX are always enabled
- * 9-bit mode is always disabled (only 5,6,7,8)
- */
-
-
-#ifndef UART_H_
-#define UART_H_
-
-
-#include "std_types.h"
-#include "micro_config.h"
-#include "common_macros.h"
-
-
-/* UART Driver Baud Rate */
-#define USART_BAUDRATE 9600
-
-/* Asynchronous mode */
-#define ASYNC						/* (undefine / comment) this when using synchrounous mode */
-
-#ifdef ASYNC
-#define UART_DOUBLE_SPEED			/* (undefine / comment) this for normal speed */
-#else
-#define TX_FALLING_RX_RISING		/* (undefine / comment) this for opposite behaviour */
-#endif
-
-#define UART_TERMINATION_CHAR '#'	/* a character that marks the end of a string */
-
-typedef enum {
-	ONE_BIT, TWO_BITS
-} UART_StopBit;
-
-typedef enum {
-	DISABLE = 0, EVEN = 2, ODD = 3
-} UART_ParityMode;
-
-typedef enum {
-	BIT_5, BIT_6, BIT_7, BIT_8
-} UART_CharacterSize;
-
-typedef struct {
-	UART_StopBit stop;
-	UART_ParityMode parity;
-	UART_CharacterSize size;
-} UART_ConfigType;
-
-
-/* Initialize the UART module */
-void UART_init(const UART_ConfigType * const config_ptr);
-
-/* Send a byte using UART TX */
-void UART_sendByte(const uint8 data);
-
-/* Receive a byte using UART RX */
-uint8 UART_receiveByte(void);
-
-/* Send multiple bytes using UART TX */
-void UART_sendString(const uint8 *str);
-
-/* Receive multiple bytes using UART RX */
-void UART_receiveString(uint8 *str);
-
-
-#endif /* UART_H_ */
+/* Driver for Atmega16 UART module */
+
+/* Constraints:
+ * Supports polling or interrupts (selected at run time by UART_ConfigType)
+ * Multi-processor communication mode is always disabled
+ * Both RX and TX are always enabled
+ * 9-bit mode is always disabled (only 5,6,7,8)
+ */
+
+
+#ifndef UART_H_
+#define UART_H_
+
+
+#include "std_types.h"
+#include "micro_config.h"
+#include "common_macros.h"
+
+
+/* UART Driver Baud Rate */
+#define USART_BAUDRATE 9600
+
+/* Asynchronous mode */
+#define ASYNC						/* (undefine / comment) this when using synchrounous mode */
+
+#ifdef ASYNC
+#define UART_DOUBLE_SPEED			/* (undefine / comment) this for normal speed */
+#else
+#define TX_FALLING_RX_RISING		/* (undefine / comment) this for opposite behaviour */
+#endif
+
+#define UART_TERMINATION_CHAR '#'	/* a character that marks the end of a string */
+
+/* Sizes of the RX / TX ring buffers used in interrupt mode (must be a power of 2, max 128) */
+#define UART_RX_BUFFER_SIZE 16
+#define UART_TX_BUFFER_SIZE 16
+
+typedef enum {
+	ONE_BIT, TWO_BITS
+} UART_StopBit;
+
+typedef enum {
+	DISABLE = 0, EVEN = 2, ODD = 3
+} UART_ParityMode;
+
+typedef enum {
+	BIT_5, BIT_6, BIT_7, BIT_8
+} UART_CharacterSize;
+
+typedef enum {
+	POLLING, INTERRUPT
+} UART_Mode;
+
+typedef struct {
+	UART_StopBit stop;
+	UART_ParityMode parity;
+	UART_CharacterSize size;
+	UART_Mode mode;
+} UART_ConfigType;
+
+
+/* Initialize the UART module */
+void UART_init(const UART_ConfigType * const config_ptr);
+
+/* Send a byte using UART TX */
+void UART_sendByte(const uint8 data);
+
+/* Receive a byte using UART RX */
+uint8 UART_receiveByte(void);
+
+/* Send multiple bytes using UART TX */
+void UART_sendString(const uint8 *str);
+
+/* Receive multiple bytes using UART RX */
+void UART_receiveString(uint8 *str);
+
+/* Receive a byte if one is available without blocking (returns FALSE if nothing was received) */
+bool UART_tryReceive(uint8 * const data);
+
+/* Get the number of received bytes waiting in the RX ring buffer */
+uint8 UART_getRxCount(void);
+
+/* Queue multiple bytes for UART TX without blocking (returns the number of bytes accepted) */
+uint8 UART_write(const uint8 * const buf, const uint8 len);
+
+/* Get the number of bytes UART_write can accept right now (free space of the TX ring buffer) */
+uint8 UART_getTxFree(void);
+
+/* Get the number of received bytes dropped because the RX ring buffer was full */
+uint16 UART_getRxOverflowCount(void);
+
+/* Get the number of received bytes lost by the hardware (data overrun) */
+uint16 UART_getRxOverrunCount(void);
+
+/* Set the function called from the RX ISR after each received byte (interrupt mode only) */
+void UART_setRxCallBack(void (*f_ptr)(void));
+
+
+#endif /* UART_H_ */
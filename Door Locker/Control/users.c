@@ -0,0 +1,260 @@
+/* Table of user codes in the external EEPROM with an index in RAM */
+
+#include "external_eeprom.h"
+#include "hash.h"
+#include "protocol.h"
+#include "users.h"
+
+
+#if USERS_SLOTS > 32
+#error "USERS_SLOTS must be at most 32 (slot bitmaps are 32-bit)"
+#endif
+
+#if (USERS_ADDRESS % EEPROM_PAGE_SIZE) != 0
+#error "USERS_ADDRESS must be page aligned"
+#endif
+
+#define SLOT_ADDRESS(slot) (USERS_ADDRESS + EEPROM_PAGE_SIZE * (uint16)((slot) + 1))
+#define SLOT_BIT(slot) ((uint32)1 << (slot))
+#define TAG(hash) ((hash)[0] | ((uint16)(hash)[1] << 8))
+
+/* Offsets inside a page */
+#define STATE_OFFSET 0
+#define HASH_OFFSET 1
+#define CRC_OFFSET (EEPROM_PAGE_SIZE - 1)
+
+
+/* Global table salt */
+static uint8 g_salt[HASH_KEY_SIZE];
+static bool g_formatted = FALSE;
+
+/* Global index sorted by tag and bitmaps of the slot states */
+static uint16 g_tags[USERS_SLOTS];
+static uint8 g_slots[USERS_SLOTS];
+static uint8 g_count = 0;
+static uint32 g_used = 0;
+static uint32 g_enabled = 0;
+
+/* Global variables of the write in progress */
+static uint8 g_page[EEPROM_PAGE_SIZE];
+static uint8 g_pending_slot;
+static void (*g_callback)(const uint8 result);
+
+
+static bool USERS_readPage(const uint16 address, uint8 * const page);
+static void USERS_sealPage(uint8 * const page);
+static uint8 USERS_search(const uint16 tag);
+static void USERS_indexInsert(const uint16 tag, const uint8 slot);
+static void USERS_indexRemove(const uint8 slot);
+static void USERS_writeDone(const uint8 result);
+
+
+void USERS_init(void) {
+	uint8 i;
+	uint8 page[EEPROM_PAGE_SIZE];
+
+	g_formatted = FALSE;
+	g_count = 0;
+	g_used = 0;
+	g_enabled = 0;
+
+	/* without a header the slots can't be checked (no salt), so the table is empty */
+	if (!USERS_readPage(USERS_ADDRESS, page) || page[0] != USERS_MAGIC)
+		return;
+	for (i = 0; i < HASH_KEY_SIZE; i++)
+		g_salt[i] = page[1 + i];
+	g_formatted = TRUE;
+
+	for (i = 0; i < USERS_SLOTS; i++) {
+		if (!USERS_readPage(SLOT_ADDRESS(i), page) || page[STATE_OFFSET] == USER_EMPTY)
+			continue;
+		USERS_indexInsert(TAG(&page[HASH_OFFSET]), i);
+		g_used |= SLOT_BIT(i);
+		if (page[STATE_OFFSET] == USER_ENABLED)
+			g_enabled |= SLOT_BIT(i);
+	}
+}
+
+bool USERS_isFormatted(void) {
+	return g_formatted;
+}
+
+uint8 USERS_format(const uint8 * const salt) {
+	uint8 i;
+	if (g_used != 0)
+		return ERROR;
+
+	g_page[0] = USERS_MAGIC;
+	for (i = 0; i < HASH_KEY_SIZE; i++)
+		g_page[1 + i] = salt[i];
+	for (i = 1 + HASH_KEY_SIZE; i < CRC_OFFSET; i++)
+		g_page[i] = 0xFF;
+	USERS_sealPage(g_page);
+	if (EEPROM_writePage(USERS_ADDRESS, g_page, EEPROM_PAGE_SIZE) == ERROR)
+		return ERROR;
+
+	for (i = 0; i < HASH_KEY_SIZE; i++)
+		g_salt[i] = salt[i];
+	g_formatted = TRUE;
+	return SUCCESS;
+}
+
+uint8 USERS_find(const uint8 * const code, const uint8 len) {
+	uint8 i, j;
+	uint8 diff;
+	uint8 hash[HASH_SIZE];
+	uint8 page[EEPROM_PAGE_SIZE];
+	uint16 tag;
+
+	if (!g_formatted || g_count == 0)
+		return USERS_NONE;
+
+	/* only the slots with the same tag are read from EEPROM (usually one OR none) */
+	HASH_compute(g_salt, code, len, hash);
+	tag = TAG(hash);
+	for (i = USERS_search(tag); i < g_count && g_tags[i] == tag; i++) {
+		if (!USERS_readPage(SLOT_ADDRESS(g_slots[i]), page))
+			continue;
+		diff = 0;
+		for (j = 0; j < HASH_SIZE; j++)
+			diff |= page[HASH_OFFSET + j] ^ hash[j];
+		if (diff == 0)
+			return g_slots[i];
+	}
+	return USERS_NONE;
+}
+
+USERS_State USERS_getState(const uint8 slot) {
+	if (slot >= USERS_SLOTS || !(g_used & SLOT_BIT(slot)))
+		return USER_EMPTY;
+	return (g_enabled & SLOT_BIT(slot)) ? USER_ENABLED : USER_DISABLED;
+}
+
+void USERS_list(uint8 * const bitmaps) {
+	uint8 i;
+	for (i = 0; i < 4; i++) {
+		bitmaps[i] = (uint8)(g_used >> (8 * i));
+		bitmaps[4 + i] = (uint8)(g_enabled >> (8 * i));
+	}
+}
+
+uint8 USERS_addAsync(const uint8 * const code, const uint8 len, void (*callback)(const uint8 result)) {
+	uint8 i;
+	uint8 slot;
+
+	if (!g_formatted)
+		return USERS_NONE;
+	for (slot = 0; slot < USERS_SLOTS && (g_used & SLOT_BIT(slot)); slot++);
+	if (slot == USERS_SLOTS)
+		return USERS_NONE;
+
+	g_page[STATE_OFFSET] = USER_ENABLED;
+	HASH_compute(g_salt, code, len, &g_page[HASH_OFFSET]);
+	for (i = HASH_OFFSET + HASH_SIZE; i < CRC_OFFSET; i++)
+		g_page[i] = 0xFF;
+	USERS_sealPage(g_page);
+
+	g_pending_slot = slot;
+	g_callback = callback;
+	if (EEPROM_writePageAsync(SLOT_ADDRESS(slot), g_page, EEPROM_PAGE_SIZE, USERS_writeDone) == ERROR)
+		return USERS_NONE;
+	return slot;
+}
+
+uint8 USERS_setStateAsync(const uint8 slot, const USERS_State state, void (*callback)(const uint8 result)) {
+	uint8 i;
+
+	if (USERS_getState(slot) == USER_EMPTY)
+		return ERROR;
+
+	/* a revoked slot is erased (wrong CRC), the code hash doesn't stay in EEPROM */
+	if (state == USER_EMPTY) {
+		for (i = 0; i < EEPROM_PAGE_SIZE; i++)
+			g_page[i] = 0xFF;
+	}
+	else {
+		if (!USERS_readPage(SLOT_ADDRESS(slot), g_page))
+			return ERROR;
+		g_page[STATE_OFFSET] = state;
+		USERS_sealPage(g_page);
+	}
+
+	g_pending_slot = slot;
+	g_callback = callback;
+	return EEPROM_writePageAsync(SLOT_ADDRESS(slot), g_page, EEPROM_PAGE_SIZE, USERS_writeDone);
+}
+
+/* Read a page, returns FALSE if its CRC is wrong */
+static bool USERS_readPage(const uint16 address, uint8 * const page) {
+	return EEPROM_readBlock(address, page, EEPROM_PAGE_SIZE) == SUCCESS &&
+		PROTOCOL_crc8(USERS_CRC_INIT, page, CRC_OFFSET) == page[CRC_OFFSET];
+}
+
+static void USERS_sealPage(uint8 * const page) {
+	page[CRC_OFFSET] = PROTOCOL_crc8(USERS_CRC_INIT, page, CRC_OFFSET);
+}
+
+/* Get the position of the first index entry with a tag not less than tag */
+static uint8 USERS_search(const uint16 tag) {
+	uint8 first = 0;
+	uint8 last = g_count;
+	uint8 middle;
+
+	while (first < last) {
+		middle = (first + last) / 2;
+		if (g_tags[middle] < tag)
+			first = middle + 1;
+		else
+			last = middle;
+	}
+	return first;
+}
+
+static void USERS_indexInsert(const uint16 tag, const uint8 slot) {
+	uint8 i;
+	uint8 position = USERS_search(tag);
+
+	for (i = g_count; i > position; i--) {
+		g_tags[i] = g_tags[i - 1];
+		g_slots[i] = g_slots[i - 1];
+	}
+	g_tags[position] = tag;
+	g_slots[position] = slot;
+	g_count++;
+}
+
+static void USERS_indexRemove(const uint8 slot) {
+	uint8 i;
+
+	for (i = 0; i < g_count && g_slots[i] != slot; i++);
+	if (i == g_count)
+		return;
+	for (g_count--; i < g_count; i++) {
+		g_tags[i] = g_tags[i + 1];
+		g_slots[i] = g_slots[i + 1];
+	}
+}
+
+/* Called from the ISR when the slot is written, the RAM copy follows EEPROM only on success */
+static void USERS_writeDone(const uint8 result) {
+	uint8 slot = g_pending_slot;
+
+	if (result == SUCCESS) {
+		if (g_page[STATE_OFFSET] == USER_EMPTY) {
+			USERS_indexRemove(slot);
+			g_used &= ~SLOT_BIT(slot);
+			g_enabled &= ~SLOT_BIT(slot);
+		}
+		else {
+			if (!(g_used & SLOT_BIT(slot)))
+				USERS_indexInsert(TAG(&g_page[HASH_OFFSET]), slot);
+			g_used |= SLOT_BIT(slot);
+			if (g_page[STATE_OFFSET] == USER_ENABLED)
+				g_enabled |= SLOT_BIT(slot);
+			else
+				g_enabled &= ~SLOT_BIT(slot);
+		}
+	}
+	if (g_callback != NULL_PTR)
+		g_callback(result);
+}
@@ -0,0 +1,75 @@
+/* Table of user codes in the external EEPROM with an index in RAM */
+
+/* Table format:
+ * header page at USERS_ADDRESS:	| USERS_MAGIC | SALT (HASH_KEY_SIZE bytes) | unused | CRC |
+ * one page per user slot after it:	| STATE | HASH (HASH_SIZE bytes) | unused | CRC |
+ * HASH = salted hash of the user code (one salt for the whole table, so a code is hashed once per lookup)
+ * CRC  = CRC-8 (same as the protocol, initial value USERS_CRC_INIT) of the rest of the page
+ * a slot is empty if its CRC is wrong (an erased page is empty)
+ *
+ * The RAM index holds the first 2 bytes of the hash (tag) of every used slot sorted by tag,
+ * a lookup is a binary search of the index then one EEPROM read per slot with the same tag
+ */
+
+/* Constraints:
+ * codes must be unique (a code matches one slot only)
+ * requires an initialized EEPROM driver and global interrupts enabled for the async functions
+ */
+
+
+#ifndef USERS_H_
+#define USERS_H_
+
+
+#include "std_types.h"
+#include "micro_config.h"
+#include "common_macros.h"
+
+
+#define ERROR 0
+#define SUCCESS 1
+
+/* Table configurations */
+#define USERS_ADDRESS 0x0300		/* address of the header page (page aligned) */
+#define USERS_SLOTS 32				/* max number of users (max 32) */
+#define USERS_MAGIC 0x55			/* marker of a formatted table */
+#define USERS_CRC_INIT 0xFF			/* CRC initial value (rejects erased AND zeroed pages) */
+#define USERS_NONE 0xFF				/* no slot */
+
+
+/* States of a slot */
+typedef enum {
+	USER_DISABLED, USER_ENABLED, USER_EMPTY = 0xFF
+} USERS_State;
+
+
+/* Load the table from EEPROM and build the index */
+void USERS_init(void);
+
+/* Check if the table has a header (salt), an empty table must be formatted before adding a user */
+bool USERS_isFormatted(void);
+
+/* Write the header of an empty table with a new salt (blocking) */
+uint8 USERS_format(const uint8 * const salt);
+
+/* Find the slot of a code (in any state), returns USERS_NONE if it doesn't exist */
+uint8 USERS_find(const uint8 * const code, const uint8 len);
+
+/* Get the state of a slot */
+USERS_State USERS_getState(const uint8 slot);
+
+/* Get the used slots bitmap (4 bytes) followed by the enabled slots bitmap (4 bytes), little endian */
+void USERS_list(uint8 * const bitmaps);
+
+/* Save a new code in a free slot in the background (enabled)
+ * returns the slot OR USERS_NONE if the table is full OR the EEPROM is busy,
+ * otherwise the callback is called from the ISR with SUCCESS OR ERROR when done */
+uint8 USERS_addAsync(const uint8 * const code, const uint8 len, void (*callback)(const uint8 result));
+
+/* Change the state of a used slot in the background (USER_EMPTY revokes the user)
+ * returns ERROR if the slot isn't used OR the EEPROM is busy,
+ * otherwise the callback is called from the ISR with SUCCESS OR ERROR when done */
+uint8 USERS_setStateAsync(const uint8 slot, const USERS_State state, void (*callback)(const uint8 result));
+
+
+#endif /* USERS_H_ */
@@ -7,21 +7,36 @@ C_SRCS += \
 ../HMI.c \
 ../keypad.c \
 ../lcd.c \
+../power.c \
+../protocol.c \
+../sched.c \
+../swtimer.c \
 ../timers.c \
+../trace.c \
 ../uart.c 
 
 OBJS += \
 ./HMI.o \
 ./keypad.o \
 ./lcd.o \
+./power.o \
+./protocol.o \
+./sched.o \
+./swtimer.o \
 ./timers.o \
+./trace.o \
 ./uart.o 
 
 C_DEPS += \
 ./HMI.d \
 ./keypad.d \
 ./lcd.d \
+./power.d \
+./protocol.d \
+./sched.d \
+./swtimer.d \
 ./timers.d \
+./trace.d \
 ./uart.d 
 
 
@@ -8,206 +8,536 @@
 
 #include "keypad.h"
 #include "lcd.h"
+#include "power.h"
+#include "protocol.h"
+#include "sched.h"
+#include "swtimer.h"
 #include "timers.h"
+#include "trace.h"
 #include "uart.h"
 
 
-/* UART commands */
-#define GET_PASS 0x69			/* get saved password */
-#define NEW_PASS 0x29			/* set new password */
-#define OPEN_DOOR 0x0D			/* open door */
-#define THEFT_ALERT 0x7A		/* theft alert */
-#define CONTROL_READY 0xC0		/* control is ready to transmit or receive */
-
 /* constants */
-#define WRONG 0					/* wrong password */
-#define CORRECT 1				/* correct password */
 #define PASS_SIZE 5				/* number of password digits */
-#define WRONG_ATTEMPTS 3		/* max number of wrong attempts */
+#define USER_DIGITS 2			/* number of digits of a user number */
+#define USERS_SLOTS 32			/* number of user slots in control */
+#define USERS_PER_SCREEN 8		/* number of users shown at once by the users list */
+#define TICK_MS 1				/* period of the system tick */
+#define MESSAGE_TIME 2000		/* ms a message is shown */
+#define DOOR_TIME 10000			/* ms of the door opening / closing screen */
+#define ALERT_TIME 60000		/* ms of the theft alert screen */
+
+/* software timers */
+typedef enum {
+	SCREEN_TIMER, LINK_TIMER
+} Timer;
+
+/* scheduler events (posted by the ISRs OR the idle check) */
+typedef enum {
+	EV_KEY,						/* keypad events queued (UI task) */
+	EV_UART,					/* bytes received (link task) */
+	EV_TIMER,					/* software timers expired (UI and link tasks) */
+	EV_TRACE					/* the next frame of the trace dump can be sent (-DTRACE only) */
+} Event;
+
+/* UI states: the screen shown and what the keys do */
+typedef enum {
+	UI_NEW_PASS, UI_CONFIRM_PASS,		/* entering a new password then confirming it */
+	UI_MAIN,							/* main menu: '*' open door, '#' settings */
+	UI_CHECK_PASS,						/* entering the password for the main menu choice */
+	UI_USER_MENU,						/* users menu after the main password */
+	UI_ADD_CODE, UI_ADD_CONFIRM,		/* entering a new user code then confirming it */
+	UI_USER_NUMBER,						/* entering the user number to revoke / enable / disable */
+	UI_LIST,							/* a screen of the users list, any key for the next one */
+	UI_REPORT,							/* power report, any key to return */
+	UI_WAITING,							/* waiting for control to answer a command */
+	UI_MESSAGE,							/* a message shown for MESSAGE_TIME */
+	UI_DOOR_OPENING, UI_DOOR_CLOSING,	/* door screens */
+	UI_ALERT							/* theft alert screen */
+} UI_State;
+
+
+/* global state of the UI and the state shown after the current message */
+UI_State g_state = UI_NEW_PASS;
+UI_State g_next_state = UI_MAIN;
+
+/* global digits entered in the current screen (and the first entry when confirming) */
+uint8 g_digits[PASS_SIZE];
+uint8 g_confirm[PASS_SIZE];
+uint8 g_count = 0;
 
+/* global choice of the main menu ('*' OR '#') waiting for the password check */
+uint8 g_choice;
 
-/* global variable indicating the status */
-/* 1: idle, 0: opening door, closing door, OR theft alert */
-uint8 g_idle = 1;
+/* global user command being entered: command, enable flag and user number */
+uint8 g_user_cmd;
+uint8 g_user_enable;
+uint8 g_user_number;
 
-/* global variable containing the number of timer ticks */
-uint8 g_ticks = 0;
+/* global users list being shown: used and enabled slots bitmaps and next slot to show */
+uint32 g_used;
+uint32 g_enabled;
+uint8 g_list_slot;
 
-/* global configuration struct of TIMER1 */
-TIMERS_ConfigType timer1a_config = {TIMER1A, CTC_OCR1A, F_CPU_1024, DISCONNECT_OC, 0, 60000};
+/* global duty cycle of HMI measured when the power report is requested */
+uint16 g_duty;
 
+/* global request waiting for its ACK from control (link task) */
+PROTOCOL_Frame g_request;
+bool g_request_busy = FALSE;
+uint8 g_request_naks = 0;
+uint8 g_request_timeouts = 0;
 
-void new_password(void);			/* set a new password */
-bool check_password(void);			/* check for current password */
-void open_door(void);				/* open door in 10 sec then close it in 10 sec */
-void theft_alert(void);				/* alert for a theft attempt for 1 min */
-void timer_open_door(void);			/* timer callback function when opening / closing door */
-void timer_theft_alert(void);		/* timer callback function when alerting for theft */
+/* global number of system ticks since the last keypad scan */
+uint8 g_scan_ticks = 0;
+
+/* global configuration struct of TIMER0 (system tick) */
+TIMERS_ConfigType timer0_config = {TIMER0, CTC, F_CPU_64, DISCONNECT_OC, 0,
+	(uint16)((F_CPU / 64UL) * TICK_MS / 1000UL - 1)};
+
+
+/* UI task */
+void show_screen(const UI_State state);		/* go to an input state and draw its screen */
+void show_message(const UI_State next);		/* keep the drawn message for MESSAGE_TIME then go to next */
+void ui_keys(void);					/* handle the queued keypad events */
+void ui_key(const uint8 key);		/* handle a pressed key in the current state */
+void ui_digits(void);				/* handle the digits entered in the current state */
+void ui_response(const PROTOCOL_Frame * const response);	/* handle the answer to the last command */
+void ui_verified(const uint8 result);	/* handle the VERIFY_PASS result of the main menu choice */
+void ui_timeout(void);				/* software timer callback function when a screen ends */
+void show_list(void);				/* show the next screen of the users list */
+void show_result(const uint8 result);	/* show the result of a user command */
+void display_per_mille(const uint16 value);		/* display a per mille value as a percentage */
+
+/* link task */
+void send_command(const uint8 cmd, const uint8 *payload, const uint8 len);	/* send a command to control */
+void link_receive(void);			/* match the received frames with the command waiting for its answer */
+void link_timeout(void);			/* software timer callback function when control doesn't answer */
+void uart_received(void);			/* UART callback function when a byte is received */
+#ifdef TRACE
+void idle_check(void);				/* post the next frame of the trace dump before sleeping */
+#endif
+
+/* system tick: draws the LCD, advances the software timers and scans the keypad */
+void timer_tick(void);
 
 
 int main() {
-	uint8 choice;					/* user input */
-	UART_ConfigType uart_config = {ONE_BIT, DISABLE, BIT_8};
+	UART_ConfigType uart_config = {ONE_BIT, DISABLE, BIT_8, INTERRUPT};
 
 	SREG |= (1<<7);
+	POWER_init();
 	LCD_init();
+	Keypad_init();
+	SCHED_init();
+	SCHED_setHandler(EV_KEY, ui_keys);
+	SCHED_setHandler(EV_UART, link_receive);
+	SCHED_setHandler(EV_TIMER, SWTIMER_dispatch);
+#ifdef TRACE
+	SCHED_setHandler(EV_TRACE, TRACE_continueDump);
+	SCHED_setIdleCheck(idle_check);
+#endif
+	SWTIMER_init();
+	TIMERS_setCallBack(TIMER0, CTC, timer_tick);
+	TIMERS_init(&timer0_config);		/* start drawing the LCD and scanning the keypad */
 	UART_init(&uart_config);
-	new_password();					/* set up a new password at the beginning */
+	UART_setRxCallBack(uart_received);
+	TRACE_init();
 
-	while(1) {
-		if (g_idle) {
-			LCD_clearScreen();
-			LCD_displayString("\'*\': Open Door");
-			LCD_displayStringAt(1, 0, "\'#\': Change Pass");
-			choice = Keypad_getPressedKey();
-			_delay_ms(500);
-			
-			if (choice == '*') {
-				bool correct = check_password();
-				if (correct)
-					open_door();
-				else
-					theft_alert();
-			}
+	show_screen(UI_NEW_PASS);			/* set up a new password at the beginning */
 
-			else if (choice == '#') {
-				bool correct = check_password();
-				if (correct)
-					new_password();
-				else
-					theft_alert();
-			}
-		}
+	/* sleep until an interrupt (keypad scan, UART OR software timer) posts an event */
+	SCHED_run();
+}
+
+void timer_tick(void) {
+	LCD_pump();
+	if (SWTIMER_tick())
+		SCHED_post(EV_TIMER);
+	g_scan_ticks++;
+	if (g_scan_ticks == KEYPAD_SCAN_MS / TICK_MS) {
+		g_scan_ticks = 0;
+		if (Keypad_scan())
+			SCHED_post(EV_KEY);
+	}
+}
+
+void show_screen(const UI_State state) {
+	g_state = state;
+	g_count = 0;
+	LCD_clearScreen();
+
+	switch (state) {
+		case UI_NEW_PASS:		LCD_displayString_P(PSTR("Enter New Pass:"));		break;
+		case UI_CONFIRM_PASS:	LCD_displayString_P(PSTR("Confirm Pass:"));			break;
+		case UI_CHECK_PASS:		LCD_displayString_P(PSTR("Enter your pass:"));		break;
+		case UI_ADD_CODE:		LCD_displayString_P(PSTR("New user code:"));		break;
+		case UI_ADD_CONFIRM:	LCD_displayString_P(PSTR("Confirm code:"));			break;
+		case UI_USER_NUMBER:	LCD_displayString_P(PSTR("User number:"));			break;
+		case UI_MAIN:
+			LCD_displayString_P(PSTR("\'*\': Open Door"));
+			LCD_displayStringAt_P(1, 0, PSTR("\'#\': Settings"));
+			break;
+		case UI_USER_MENU:
+			LCD_displayString_P(PSTR("1Pass 2Add 3Del"));
+			LCD_displayStringAt_P(1, 0, PSTR("4On 5Off 6Ls 7Pw"));
+			break;
+		default:
+			break;
 	}
+	LCD_moveCursorTo(1,0);			/* the entered digits are shown on the second line */
 }
 
-void new_password(void) {
-	while(1) {
-		uint8 i;
-		uint8 pass[5];
-		bool correct = CORRECT;
+void show_message(const UI_State next) {
+	g_state = UI_MESSAGE;
+	g_next_state = next;
+	SWTIMER_start(SCREEN_TIMER, MESSAGE_TIME / TICK_MS, 0, ui_timeout);
+}
 
-		LCD_clearScreen();
-		LCD_displayString("Enter New Pass:");
-		LCD_moveCursorTo(1,0);
-		for (i = 0; i < PASS_SIZE; i++) {
-			pass[i] = Keypad_getPressedKey();
+void ui_keys(void) {
+	Keypad_Event event;
+
+	/* the keys pressed while waiting OR showing a message are ignored by those states */
+	while (Keypad_pollEvent(&event)) {
+		if (event.type == KEY_PRESS)
+			ui_key(event.key);
+	}
+}
+
+void ui_key(const uint8 key) {
+	switch (g_state) {
+		case UI_MAIN:
+			if (key == '*' || key == '#') {
+				g_choice = key;
+				show_screen(UI_CHECK_PASS);
+			}
+			break;
+
+		case UI_NEW_PASS:
+		case UI_CHECK_PASS:
+		case UI_ADD_CODE:
+			g_digits[g_count++] = key;
 			LCD_displayCharacter('*');
-			_delay_ms(500);
-		}
+			if (g_count == PASS_SIZE)
+				ui_digits();
+			break;
 
-		LCD_clearScreen();
-		LCD_displayString("Confirm Pass:");
-		LCD_moveCursorTo(1,0);
-		for (i = 0; i < PASS_SIZE; i++) {
-			uint8 digit = Keypad_getPressedKey();
+		case UI_CONFIRM_PASS:
+		case UI_ADD_CONFIRM:
+			g_confirm[g_count++] = key;
 			LCD_displayCharacter('*');
-			if (pass[i] != digit)
-				correct = WRONG;
-			_delay_ms(500);
-		}
+			if (g_count == PASS_SIZE)
+				ui_digits();
+			break;
+
+		case UI_USER_NUMBER:
+			/* 2 digits user number (as shown in the list) */
+			g_user_number = (g_count == 0) ? key : g_user_number * 10 + key;
+			g_count++;
+			LCD_displayInteger(key);
+			if (g_count == USER_DIGITS)
+				ui_digits();
+			break;
+
+		case UI_USER_MENU:
+			switch (key) {
+				case 1:		show_screen(UI_NEW_PASS);		break;
+				case 2:		show_screen(UI_ADD_CODE);		break;
+				case 3:
+				case 4:
+				case 5:
+					g_user_cmd = (key == 3) ? REVOKE_USER : ENABLE_USER;
+					g_user_enable = (key == 4);
+					show_screen(UI_USER_NUMBER);
+					break;
+				case 6:		send_command(LIST_USERS, NULL_PTR, 0);		break;
+				case 7:
+					g_duty = POWER_getDutyCycle();
+					send_command(POWER_REPORT, NULL_PTR, 0);
+					break;
+				default:	show_screen(UI_MAIN);			break;
+			}
+			break;
+
+		case UI_LIST:
+			/* any key for the next screen OR the main menu after the last one */
+			if (g_list_slot < USERS_SLOTS && (g_used >> g_list_slot) != 0)
+				show_list();
+			else
+				show_screen(UI_MAIN);
+			break;
 
-		if (correct) {
-			UART_sendByte(NEW_PASS);
-			while (UART_receiveByte() != CONTROL_READY);
-			for (i = 0; i < PASS_SIZE; ++i)
-				UART_sendByte(pass[i]);
+		case UI_REPORT:
+			show_screen(UI_MAIN);
+			break;
+
+		default:
+			break;
+	}
+}
+
+void ui_digits(void) {
+	uint8 i;
+	uint8 payload[2];
+
+	switch (g_state) {
+		case UI_NEW_PASS:
+			show_screen(UI_CONFIRM_PASS);
+			break;
+
+		case UI_CONFIRM_PASS:
+			for (i = 0; i < PASS_SIZE && g_digits[i] == g_confirm[i]; i++);
+			if (i == PASS_SIZE) {
+				send_command(NEW_PASS, g_digits, PASS_SIZE);
+				break;
+			}
 			LCD_clearScreen();
-			LCD_displayStringAt(0, 2, "New password");
-			LCD_displayStringAt(1, 4, "is saved");
-			_delay_ms(2000);
-			return;
-		}
+			LCD_displayStringAt_P(0, 3, PSTR("Passwords"));
+			LCD_displayStringAt_P(1, 2, PSTR("don\'t match"));
+			show_message(UI_NEW_PASS);
+			break;
 
-		else {
+		case UI_CHECK_PASS:
+			send_command(VERIFY_PASS, g_digits, PASS_SIZE);
+			break;
+
+		case UI_ADD_CODE:
+			show_screen(UI_ADD_CONFIRM);
+			break;
+
+		case UI_ADD_CONFIRM:
+			for (i = 0; i < PASS_SIZE && g_digits[i] == g_confirm[i]; i++);
+			if (i == PASS_SIZE) {
+				send_command(ADD_USER, g_digits, PASS_SIZE);
+				break;
+			}
 			LCD_clearScreen();
-			LCD_displayStringAt(0, 3, "Passwords");
-			LCD_displayStringAt(1, 2, "don\'t match");
-			_delay_ms(2000);
-		}
+			LCD_displayStringAt_P(0, 5, PSTR("Codes"));
+			LCD_displayStringAt_P(1, 2, PSTR("don\'t match"));
+			show_message(UI_MAIN);
+			break;
+
+		case UI_USER_NUMBER:
+			payload[0] = g_user_number;
+			payload[1] = g_user_enable;
+			send_command(g_user_cmd, payload, (g_user_cmd == ENABLE_USER) ? 2 : 1);
+			break;
+
+		default:
+			break;
 	}
 }
 
-bool check_password(void) {
-	uint8 i;
-	uint8 attempt;
-	uint8 pass[5];
-	UART_sendByte(GET_PASS);
-	while (UART_receiveByte() != CONTROL_READY);
-	for (i = 0; i < PASS_SIZE; i++)
-		pass[i] = UART_receiveByte();
-
-	for (attempt = 0; attempt < WRONG_ATTEMPTS; attempt++) {
-		bool correct = CORRECT;
+void ui_response(const PROTOCOL_Frame * const response) {
+	switch (g_request.cmd) {
+		case NEW_PASS:
+			LCD_clearScreen();
+			LCD_displayStringAt_P(0, 2, PSTR("New password"));
+			LCD_displayStringAt_P(1, 4, PSTR("is saved"));
+			show_message(UI_MAIN);
+			break;
+
+		case VERIFY_PASS:
+			ui_verified((response->len >= 1) ? response->payload[0] : PASS_WRONG);
+			break;
+
+		case OPEN_DOOR:
+			g_state = UI_DOOR_OPENING;
+			SWTIMER_start(SCREEN_TIMER, DOOR_TIME / TICK_MS, 0, ui_timeout);
+			LCD_clearScreen();
+			LCD_displayStringAt_P(0, 4, PSTR("Door is"));
+			LCD_displayStringAt_P(1, 3, PSTR("opening..."));
+			break;
+
+		case ADD_USER:
+			show_result(response->payload[0]);
+			if (response->len == 2 && response->payload[0] == USER_DONE) {
+				LCD_displayStringAt_P(1, 4, PSTR("user "));
+				LCD_displayInteger(response->payload[1]);
+			}
+			show_message(UI_MAIN);
+			break;
+
+		case REVOKE_USER:
+		case ENABLE_USER:
+			show_result(response->payload[0]);
+			show_message(UI_MAIN);
+			break;
+
+		case LIST_USERS:
+			g_used = response->payload[0] | ((uint32)response->payload[1] << 8) |
+				((uint32)response->payload[2] << 16) | ((uint32)response->payload[3] << 24);
+			g_enabled = response->payload[4] | ((uint32)response->payload[5] << 8) |
+				((uint32)response->payload[6] << 16) | ((uint32)response->payload[7] << 24);
+			g_list_slot = 0;
+			show_list();
+			break;
+
+		case POWER_REPORT:
+			g_state = UI_REPORT;
+			LCD_clearScreen();
+			LCD_displayString_P(PSTR("HMI CPU: "));
+			display_per_mille(g_duty);
+			LCD_displayStringAt_P(1, 0, PSTR("CTL CPU: "));
+			display_per_mille(response->payload[0] | ((uint16)response->payload[1] << 8));
+			break;
+
+		default:
+			show_screen(UI_MAIN);
+			break;
+	}
+}
+
+void ui_verified(const uint8 result) {
+	/* control counts the wrong attempts and locks after too many */
+	if (result == PASS_WRONG) {
 		LCD_clearScreen();
-		LCD_displayString("Enter your pass:");
-		LCD_moveCursorTo(1,0);
-		for (i = 0; i < PASS_SIZE; i++) {
-			uint8 digit = Keypad_getPressedKey();
-			LCD_displayCharacter('*');
-			if (pass[i] != digit)
-				correct = WRONG;
-			_delay_ms(500);
-		}
+		LCD_displayStringAt_P(0, 3, PSTR("WRONG PASS"));
+		LCD_displayStringAt_P(1, 3, PSTR("TRY AGAIN!"));
+		show_message(UI_CHECK_PASS);
+	}
+	else if (result != PASS_CORRECT && result != PASS_USER) {
+		/* control has already started its alert when it locked the password */
+		g_state = UI_ALERT;
+		SWTIMER_start(SCREEN_TIMER, ALERT_TIME / TICK_MS, 0, ui_timeout);
+		LCD_clearScreen();
+		LCD_displayStringAt_P(0, 2, PSTR("7araaaamyyyy"));
+	}
+	else if (g_choice == '*')
+		send_command(OPEN_DOOR, NULL_PTR, 0);
+	else if (result == PASS_CORRECT)
+		show_screen(UI_USER_MENU);
+	else {
+		LCD_clearScreen();
+		LCD_displayStringAt_P(0, 2, PSTR("Not allowed"));
+		show_message(UI_MAIN);
+	}
+}
 
-		if (correct)
-			return CORRECT;
+void ui_timeout(void) {
+	switch (g_state) {
+		case UI_MESSAGE:
+			show_screen(g_next_state);
+			break;
 
-		else if (attempt < (WRONG_ATTEMPTS - 1)) {
+		case UI_DOOR_OPENING:
+			g_state = UI_DOOR_CLOSING;
+			SWTIMER_start(SCREEN_TIMER, DOOR_TIME / TICK_MS, 0, ui_timeout);
 			LCD_clearScreen();
-			LCD_displayStringAt(0, 3, "WRONG PASS");
-			LCD_displayStringAt(1, 3, "TRY AGAIN!");
-			_delay_ms(2000);
-		}
+			LCD_displayStringAt_P(0, 4, PSTR("Door is"));
+			LCD_displayStringAt_P(1, 3, PSTR("closing..."));
+			break;
+
+		default:
+			show_screen(UI_MAIN);
+			break;
 	}
-	return WRONG;
 }
 
-void open_door(void) {
-	UART_sendByte(OPEN_DOOR);
-	while (UART_receiveByte() != CONTROL_READY);
-	timer1a_config.initial_value = 41875;
-	TIMERS_setCallBack(TIMER1A, CTC_OCR1A, timer_open_door);
-	TIMERS_init(&timer1a_config);
+void show_list(void) {
+	uint8 shown = 0;
 
-	g_idle = 0;
+	/* 4 users per line: number followed by '+' (enabled) OR '-' (disabled) */
+	g_state = UI_LIST;
 	LCD_clearScreen();
-	LCD_displayStringAt(0, 4, "Door is");
-	LCD_displayStringAt(1, 3, "opening...");
+	for (; g_list_slot < USERS_SLOTS && shown < USERS_PER_SCREEN; g_list_slot++) {
+		if (!(g_used & ((uint32)1 << g_list_slot)))
+			continue;
+		LCD_moveCursorTo(shown / 4, (shown % 4) * 4);
+		LCD_displayCharacter('0' + g_list_slot / 10);
+		LCD_displayCharacter('0' + g_list_slot % 10);
+		LCD_displayCharacter((g_enabled & ((uint32)1 << g_list_slot)) ? '+' : '-');
+		shown++;
+	}
+	if (g_used == 0)
+		LCD_displayString_P(PSTR("No users"));
 }
 
-void theft_alert(void) {
-	UART_sendByte(THEFT_ALERT);
-	while (UART_receiveByte() != CONTROL_READY);
-	timer1a_config.initial_value = 11250;
-	TIMERS_setCallBack(TIMER1A, CTC_OCR1A, timer_theft_alert);
-	TIMERS_init(&timer1a_config);
-
-	g_idle = 0;
+void show_result(const uint8 result) {
 	LCD_clearScreen();
-	LCD_displayStringAt(0, 2, "7araaaamyyyy");
+	if (result == USER_DONE)
+		LCD_displayStringAt_P(0, 6, PSTR("Done"));
+	else
+		LCD_displayStringAt_P(0, 4, PSTR("Rejected"));
 }
 
-void timer_open_door(void) {
-	g_ticks++;
-	if (g_ticks == 2) {
-		TCNT1 = 41875;
-		LCD_clearScreen();
-		LCD_displayStringAt(0, 4, "Door is");
-		LCD_displayStringAt(1, 3, "closing...");
-	}
-	else if (g_ticks == 4) {
-		g_idle = 1;
-		g_ticks = 0;
-		TIMERS_deInit(TIMER1A);
+void display_per_mille(const uint16 value) {
+	LCD_displayInteger(value / 10);
+	LCD_displayCharacter('.');
+	LCD_displayInteger(value % 10);
+	LCD_displayCharacter('%');
+}
+
+void send_command(const uint8 cmd, const uint8 *payload, const uint8 len) {
+	/* the UI waits for the answer, ui_response is called when it is acknowledged */
+	g_state = UI_WAITING;
+	PROTOCOL_newRequest(&g_request, cmd, payload, len);
+	g_request_busy = TRUE;
+	g_request_naks = 0;
+	g_request_timeouts = 0;
+	PROTOCOL_sendFrame(&g_request);
+	SWTIMER_start(LINK_TIMER, PROTOCOL_TIMEOUT_MS / TICK_MS, 0, link_timeout);
+}
+
+void link_receive(void) {
+	PROTOCOL_Frame response;
+	PROTOCOL_Status status;
+
+	while ((status = PROTOCOL_receiveFrame(&response)) != NO_FRAME) {
+#ifdef TRACE
+		/* a tool connected in place of control asks for the trace buffer */
+		if (status == FRAME_OK && response.cmd == DUMP_TRACE) {
+			TRACE_sendDump(&response);
+			continue;
+		}
+#endif
+		if (status != FRAME_OK || !g_request_busy || response.seq != g_request.seq)
+			continue;
+
+		if (response.cmd == ACK) {
+			g_request_busy = FALSE;
+			SWTIMER_cancel(LINK_TIMER);
+			ui_response(&response);
+		}
+		else if (++g_request_naks >= PROTOCOL_RETRIES) {
+			/* rejected by control (e.g. a new password without the main password): give up */
+			g_request_busy = FALSE;
+			SWTIMER_cancel(LINK_TIMER);
+			show_result(USER_REJECTED);
+			show_message(UI_MAIN);
+		}
+		else {
+			/* NAK: send it again right away */
+			PROTOCOL_sendFrame(&g_request);
+			SWTIMER_start(LINK_TIMER, PROTOCOL_TIMEOUT_MS / TICK_MS, 0, link_timeout);
+		}
 	}
 }
 
-void timer_theft_alert(void) {
-	g_ticks++;
-	if (g_ticks == 8) {
-		g_idle = 1;
-		g_ticks = 0;
-		TIMERS_deInit(TIMER1A);
+void link_timeout(void) {
+	if (!g_request_busy)
+		return;
+
+	/* control doesn't answer: give up (a new password is entered again, it is needed at the first start) */
+	if (++g_request_timeouts >= PROTOCOL_RETRIES) {
+		g_request_busy = FALSE;
+		LCD_clearScreen();
+		LCD_displayStringAt_P(0, 3, PSTR("Link error"));
+		LCD_displayStringAt_P(1, 1, PSTR("try again later"));
+		show_message((g_request.cmd == NEW_PASS) ? UI_NEW_PASS : UI_MAIN);
+		return;
 	}
+	PROTOCOL_sendFrame(&g_request);
+	SWTIMER_start(LINK_TIMER, PROTOCOL_TIMEOUT_MS / TICK_MS, 0, link_timeout);
+}
+
+void uart_received(void) {
+	SCHED_post(EV_UART);
+}
+
+#ifdef TRACE
+void idle_check(void) {
+	if (TRACE_isDumpReady())
+		SCHED_post(EV_TRACE);
 }
+#endif
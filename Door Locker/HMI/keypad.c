@@ -1,73 +1,185 @@
-/* Driver for keypad (4x3 or 4x4) */
-
-#include "keypad.h"
-
-/* Map the switch number in the keypad to its corresponding key */
-#if (N_COL == 3)
-static uint8 Keypad_4x3_adjustKeyNumber(uint8 button_number);
-#elif (N_COL == 4)
-static uint8 Keypad_4x4_adjustKeyNumber(uint8 button_number);
-#endif
-
-uint8 Keypad_getPressedKey(void) {
-	uint8 col, row;
-	/* loop until a key is pressed */
-	while(1) {
-		/* loop for columns */
-		for (col = 0; col < N_COL; col++) {
-			/* each time only one of the column pins will be output and
-			 * the rest will be input pins including the row pins */
-			KEYPAD_PORT_DIR = 0b00010000 << col;
-			
-			/* clear the output column pin and
-			 * enable the internal pull up resistors for the rows pins*/
-			KEYPAD_PORT_OUT = ~(0b00010000 << col);
-
-			/* loop for rows */
-			for (row = 0; row < N_ROW; row++) {
-				/* if the switch is pressed in this row */
-				if(BIT_IS_CLEAR(KEYPAD_PORT_IN,row)) {
-					#if (N_COL == 3)
-						return Keypad_4x3_adjustKeyNumber(row * N_COL + col + 1);
-					#elif (N_COL == 4)
-						return Keypad_4x4_adjustKeyNumber(row * N_COL + col + 1);
-					#endif
-				}
-			}
-		}
-	}
-}
-
-#if (N_COL == 3)
-static uint8 Keypad_4x3_adjustKeyNumber(uint8 button_number) {
-	switch(button_number) {
-		case 10:		return '*';
-		case 11:		return 0;
-		case 12:		return '#';
-		default:		return button_number;
-	}
-}
-
-#elif (N_COL == 4)
-static uint8 Keypad_4x4_adjustKeyNumber(uint8 button_number) {
-	switch(button_number) {
-		case 1:			return 7;
-		case 2:			return 8;
-		case 3:			return 9;
-		case 4:			return '%';
-		case 5:			return 4;
-		case 6:			return 5;
-		case 7:			return 6;
-		case 8:			return '*';
-		case 9:			return 1;
-		case 10:		return 2;
-		case 11:		return 3;
-		case 12:		return '-';
-		case 13:		return 13;		/* ASCII of Enter */
-		case 14:		return 0;
-		case 15:		return '=';
-		case 16:		return '+';
-		default:		return button_number;
-	}
-}
-#endif
+/* Driver for keypad (4x3 or 4x4) */
+
+#include "keypad.h"
+#include "power.h"
+#include "trace.h"
+
+
+#if (KEYPAD_QUEUE_SIZE & (KEYPAD_QUEUE_SIZE - 1)) != 0
+#error "KEYPAD_QUEUE_SIZE must be a power of 2"
+#endif
+
+#define N_KEYS (N_ROW * N_COL)
+
+
+/* States of the debounce state machine of each key */
+typedef enum {
+	RELEASED, PRESSED, LONG_PRESSED
+} Keypad_KeyState;
+
+
+/* Global state of each key: state, number of successive scans disagreeing with the state
+ * and number of scans since it is pressed */
+static Keypad_KeyState g_state[N_KEYS];
+static uint8 g_debounce[N_KEYS];
+static uint8 g_held[N_KEYS];
+
+/* Global event queue (filled by the ISR, emptied by Keypad_pollEvent) */
+static Keypad_Event g_queue[KEYPAD_QUEUE_SIZE];
+static volatile uint8 g_queue_head = 0;
+static volatile uint8 g_queue_tail = 0;
+static volatile uint16 g_lost = 0;
+
+
+/* Map the switch number in the keypad to its corresponding key */
+#if (N_COL == 3)
+static uint8 Keypad_4x3_adjustKeyNumber(uint8 button_number);
+#elif (N_COL == 4)
+static uint8 Keypad_4x4_adjustKeyNumber(uint8 button_number);
+#endif
+
+static void Keypad_pushEvent(const Keypad_EventType type, const uint8 button);
+
+
+void Keypad_init(void) {
+	uint8 i;
+
+	for (i = 0; i < N_KEYS; i++) {
+		g_state[i] = RELEASED;
+		g_debounce[i] = 0;
+	}
+}
+
+bool Keypad_pollEvent(Keypad_Event * const event) {
+	if (g_queue_head == g_queue_tail)
+		return FALSE;
+	*event = g_queue[g_queue_tail];
+	g_queue_tail = (g_queue_tail + 1) & (KEYPAD_QUEUE_SIZE - 1);
+	return TRUE;
+}
+
+void Keypad_clearEvents(void) {
+	g_queue_tail = g_queue_head;
+}
+
+uint8 Keypad_getPressedKey(void) {
+	Keypad_Event event;
+	/* loop until a key is pressed, sleeping until the next scan while there is no event */
+	while (1) {
+		cli();
+		if (!Keypad_pollEvent(&event)) {
+			POWER_idle();
+			continue;
+		}
+		sei();
+		if (event.type == KEY_PRESS)
+			return event.key;
+	}
+}
+
+uint16 Keypad_getLostCount(void) {
+	uint16 lost;
+	cli();
+	lost = g_lost;
+	sei();
+	return lost;
+}
+
+/* Called from the ISR every KEYPAD_SCAN_MS: sample all keys and advance their state machines */
+bool Keypad_scan(void) {
+	uint8 col, row;
+	uint8 i;
+	bool pressed;
+	uint8 head = g_queue_head;
+
+	/* loop for columns */
+	for (col = 0; col < N_COL; col++) {
+		/* each time only one of the column pins will be output and
+		 * the rest will be input pins including the row pins */
+		KEYPAD_PORT_DIR = 0b00010000 << col;
+
+		/* clear the output column pin and
+		 * enable the internal pull up resistors for the rows pins*/
+		KEYPAD_PORT_OUT = ~(0b00010000 << col);
+
+		/* loop for rows */
+		for (row = 0; row < N_ROW; row++) {
+			i = row * N_COL + col;
+			pressed = BIT_IS_CLEAR(KEYPAD_PORT_IN,row);
+
+			/* the state changes only after the key is stable for KEYPAD_DEBOUNCE_SCANS scans */
+			if (pressed == (g_state[i] != RELEASED))
+				g_debounce[i] = 0;
+			else if (++g_debounce[i] == KEYPAD_DEBOUNCE_SCANS) {
+				g_debounce[i] = 0;
+				if (pressed) {
+					g_state[i] = PRESSED;
+					g_held[i] = 0;
+					Keypad_pushEvent(KEY_PRESS, i + 1);
+				}
+				else {
+					g_state[i] = RELEASED;
+					Keypad_pushEvent(KEY_RELEASE, i + 1);
+				}
+			}
+
+			if (g_state[i] == PRESSED && ++g_held[i] == KEYPAD_LONG_SCANS) {
+				g_state[i] = LONG_PRESSED;
+				Keypad_pushEvent(KEY_LONG_PRESS, i + 1);
+			}
+		}
+	}
+	return (g_queue_head != head) ? TRUE : FALSE;
+}
+
+static void Keypad_pushEvent(const Keypad_EventType type, const uint8 button) {
+	uint8 next = (g_queue_head + 1) & (KEYPAD_QUEUE_SIZE - 1);
+
+	/* the queue is full: drop the new event */
+	if (next == g_queue_tail) {
+		g_lost++;
+		return;
+	}
+	g_queue[g_queue_head].type = type;
+	#if (N_COL == 3)
+		g_queue[g_queue_head].key = Keypad_4x3_adjustKeyNumber(button);
+	#elif (N_COL == 4)
+		g_queue[g_queue_head].key = Keypad_4x4_adjustKeyNumber(button);
+	#endif
+	TRACE_POINT(TRACE_KEY_PRESS + type, g_queue[g_queue_head].key);
+	g_queue_head = next;
+}
+
+#if (N_COL == 3)
+static uint8 Keypad_4x3_adjustKeyNumber(uint8 button_number) {
+	switch(button_number) {
+		case 10:		return '*';
+		case 11:		return 0;
+		case 12:		return '#';
+		default:		return button_number;
+	}
+}
+
+#elif (N_COL == 4)
+static uint8 Keypad_4x4_adjustKeyNumber(uint8 button_number) {
+	switch(button_number) {
+		case 1:			return 7;
+		case 2:			return 8;
+		case 3:			return 9;
+		case 4:			return '%';
+		case 5:			return 4;
+		case 6:			return 5;
+		case 7:			return 6;
+		case 8:			return '*';
+		case 9:			return 1;
+		case 10:		return 2;
+		case 11:		return 3;
+		case 12:		return '-';
+		case 13:		return 13;		/* ASCII of Enter */
+		case 14:		return 0;
+		case 15:		return '=';
+		case 16:		return '+';
+		default:		return button_number;
+	}
+}
+#endif
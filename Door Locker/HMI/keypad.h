@@ -1,26 +1,63 @@
-/* Driver for keypad (4x3 or 4x4) */
-
-#ifndef KEYPAD_H_
-#define KEYPAD_H_
-
-
-#include "std_types.h"
-#include "micro_config.h"
-#include "common_macros.h"
-
-
-/* Keypad configurations for number of rows and columns */
-#define N_COL 3
-#define N_ROW 4
-
-/* Keypad Port Configurations */
-#define KEYPAD_PORT_DIR DDRB
-#define KEYPAD_PORT_IN  PINB
-#define KEYPAD_PORT_OUT PORTB
-
-
-/* Get the pressed keypad key */
-uint8 Keypad_getPressedKey(void);
-
-
-#endif /* KEYPAD_H_ */
+/* Driver for keypad (4x3 or 4x4) */
+
+/* Constraints:
+ * Keypad_scan must be called every KEYPAD_SCAN_MS (from a timer ISR)
+ * requires global interrupts enabled
+ */
+
+#ifndef KEYPAD_H_
+#define KEYPAD_H_
+
+
+#include "std_types.h"
+#include "micro_config.h"
+#include "common_macros.h"
+
+
+/* Keypad configurations for number of rows and columns */
+#define N_COL 3
+#define N_ROW 4
+
+/* Keypad Port Configurations */
+#define KEYPAD_PORT_DIR DDRB
+#define KEYPAD_PORT_IN  PINB
+#define KEYPAD_PORT_OUT PORTB
+
+/* Keypad scan configurations */
+#define KEYPAD_SCAN_MS 5			/* scan period */
+#define KEYPAD_DEBOUNCE_SCANS 4		/* number of scans a key must be stable to change its state */
+#define KEYPAD_LONG_SCANS 200		/* number of scans a key is held to be a long press (1 sec) */
+#define KEYPAD_QUEUE_SIZE 8			/* max number of events waiting to be read (power of 2) */
+
+
+typedef enum {
+	KEY_PRESS, KEY_RELEASE, KEY_LONG_PRESS
+} Keypad_EventType;
+
+typedef struct {
+	Keypad_EventType type;
+	uint8 key;
+} Keypad_Event;
+
+
+/* Reset the state of all keys before the scans start */
+void Keypad_init(void);
+
+/* Sample all keys and queue the events of the keys changing state
+ * returns TRUE if new events are queued */
+bool Keypad_scan(void);
+
+/* Get the oldest key event without waiting, returns FALSE if there is none */
+bool Keypad_pollEvent(Keypad_Event * const event);
+
+/* Drop all the events waiting to be read */
+void Keypad_clearEvents(void);
+
+/* Wait for the next key press and get the pressed key */
+uint8 Keypad_getPressedKey(void);
+
+/* Get the number of events lost because the queue was full */
+uint16 Keypad_getLostCount(void);
+
+
+#endif /* KEYPAD_H_ */
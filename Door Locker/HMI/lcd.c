@@ -1,117 +1,347 @@
-/* Driver for LCD (2x16 or 4x16) (4-bit or 8-bit) */
-
-#include "lcd.h"
-
-
-#if (DATA_BITS_MODE == 4)
-#define DATA_PINS (0x0F<<PINS_POSITION)		/* 8-bits with HIGH at data pins position */
-#endif
-
-
-static void LCD_sendData(const uint8 data, const bool type);
-
-
-void LCD_init(void) {
-	/* Configure the control pins (RS,RW,E) as output pins */
-	LCD_CTRL_DIR |= (1<<RS) | (1<<RW) | (1<<E);
-	
-	#if (DATA_BITS_MODE == 4)
-		/* initialize LCD in 4-bit mode */
-		LCD_sendCommand(FOUR_BITS_DATA_MODE);
-		/* use 2-line lcd + 4-bit Data Mode + 5*7 dot display Mode */
-		LCD_sendCommand(TWO_LINE_FOUR_BIT_MODE);
-	#elif (DATA_BITS_MODE == 8)
-		/* use 2-line lcd + 8-bit Data Mode + 5*7 dot display Mode */
-		LCD_sendCommand(TWO_LINE_EIGHT_BIT_MODE);
-	#endif
-	
-	LCD_sendCommand(DISPLAY_ON_CURSOR_OFF); 	/* turn on display */
-	LCD_clearScreen();							/* clear the LCD */
-}
-
-void LCD_clearScreen(void) {
-	LCD_sendCommand(CLEAR_SCREEN);				/* clear display */
-}
-
-void LCD_sendCommand(const uint8 command) {
-	LCD_sendData(command, 0);
-}
-
-void LCD_displayCharacter(const uint8 character) {
-	LCD_sendData(character, 1);
-}
-
-static void LCD_sendData(const uint8 data, const bool type) {
-	#if (DATA_BITS_MODE == 4)
-		/* Configure 4 adjacent pins of the data port as output pins */
-		LCD_DATA_DIR |= DATA_PINS;
-	#elif (DATA_BITS_MODE == 8)
-		/* Configure the data port as output port */
-		LCD_DATA_DIR = 0xFF;
-	#endif
-
-	/* data is command -> RS = 0 OR data is character -> RS = 1 */
-	type == 0 ? CLEAR_BIT(LCD_CTRL_OUT,RS) : SET_BIT(LCD_CTRL_OUT,RS);
-	CLEAR_BIT(LCD_CTRL_OUT,RW);		/* write data to LCD -> RW = 0 */
-	_delay_ms(1);					/* delay for processing Tas = 50ns */
-	SET_BIT(LCD_CTRL_OUT,E);		/* Enable LCD -> E = 1 */
-	_delay_ms(1);					/* delay for processing = Tpw - Tdws = 190ns */
-	
-	#if (DATA_BITS_MODE == 4)
-		/* out the highest 4 bits of the required data to the data bus D4 --> D7 */
-		LCD_DATA_OUT = (LCD_DATA_OUT & ~DATA_PINS) | ((data & 0xF0) >> (4-PINS_POSITION));
-		_delay_ms(1);					/* delay for processing Tdsw = 100ns */
-		CLEAR_BIT(LCD_CTRL_OUT,E);		/* disable LCD -> E = 0 */
-		_delay_ms(1);					/* delay for processing Th = 13ns */
-		
-		SET_BIT(LCD_CTRL_OUT,E);		/* Enable LCD -> E = 1 */
-		_delay_ms(1);					/* delay for processing = Tpw - Tdws = 190ns */
-
-		/* out the lowest 4 bits of the required data to the data bus D4 --> D7 */
-		LCD_DATA_OUT = (LCD_DATA_OUT & ~DATA_PINS) | ((data & 0x0F) << PINS_POSITION);
-		_delay_ms(1);					/* delay for processing Tdsw = 100ns */
-		CLEAR_BIT(LCD_CTRL_OUT,E);		/* disable LCD -> E = 0 */
-		_delay_ms(1);					/* delay for processing Th = 13ns */
-
-	#elif (DATA_BITS_MODE == 8)
-		/* out the required data to the data bus D0 --> D7 */
-		LCD_DATA_OUT = data;
-		_delay_ms(1);						/* delay for processing Tdsw = 100ns */
-		CLEAR_BIT(LCD_CTRL_OUT,E);			/* disable LCD -> E = 0 */
-		_delay_ms(1);						/* delay for processing Th = 13ns */
-	#endif
-}
-
-void LCD_displayString(const char *str) {
-	while ((*str) != '\0') {
-		LCD_displayCharacter(*str);
-		str++;
-	}
-}
-
-void LCD_moveCursorTo(const uint8 row, const uint8 col) {
-	uint8 address;
-	/* calculate the required address */
-	switch(row) {
-		case 0:		address = col;				break;
-		case 1:		address = col + 0x40;		break;
-		case 2:		address = col + 0x10;		break;
-		case 3:		address = col + 0x50;		break;
-	}					
-	/* to write to a specific address in the LCD
-	 * we need to apply the corresponding command
-	 * 0x80 + address OR 0x80 | address (no difference)
-	 * Max Address = 0x5F = 0b0101.1111 AND 0x80 = 0b1000.0000*/
-	LCD_sendCommand(address | SET_CURSOR_LOCATION);
-}
-
-void LCD_displayStringAt(const uint8 row, const uint8 col, const char *str) {
-	LCD_moveCursorTo(row,col);		/* go to to the required LCD position */
-	LCD_displayString(str);			/* display the string */
-}
-
-void LCD_displayInteger(const sint32 data) {
-   char buff[16];					/* string to hold the ASCII result */
-   itoa(data, buff, 10);			/* 10 for decimal (base 10) */
-   LCD_displayString(buff);			/* display the string */
-}
+/* Driver for LCD (2x16 or 4x16) (4-bit or 8-bit) */
+
+#include "lcd.h"
+#include "trace.h"
+
+
+#if (LCD_QUEUE_SIZE & (LCD_QUEUE_SIZE - 1)) != 0
+#error "LCD_QUEUE_SIZE must be a power of 2"
+#endif
+
+#if (DATA_BITS_MODE == 4)
+#define DATA_PINS (0x0F<<PINS_POSITION)		/* 8-bits with HIGH at data pins position */
+#endif
+
+
+/* Global frame buffer written by the display functions and the cursor of these writes */
+static uint8 g_frame[LCD_ROWS][LCD_COLS];
+static uint8 g_row = 0;
+static uint8 g_col = 0;
+static volatile bool g_dirty = FALSE;	/* TRUE if a cell may differ from the LCD */
+
+/* Global copy of the cells shown on the LCD, its address counter (0xFF if unknown)
+ * and the cell where LCD_pump continues searching for a changed one */
+static uint8 g_shown[LCD_ROWS][LCD_COLS];
+static uint8 g_address = 0xFF;
+static uint8 g_next_cell = 0;
+
+/* Global queue of the commands waiting to be sent by LCD_pump */
+static uint8 g_commands[LCD_QUEUE_SIZE];
+static volatile uint8 g_commands_head = 0;
+static volatile uint8 g_commands_tail = 0;
+
+
+/* Global timing mode: TRUE when the busy flag is polled (only after the data bus mode is set) */
+static bool g_busy_flag = FALSE;
+
+/* Global number of ticks LCD_pump waits for a slow instruction (timed mode)
+ * and number of successive ticks the LCD was busy (busy flag mode) */
+static uint8 g_wait_ticks = 0;
+static uint16 g_busy_ticks = 0;
+
+
+static void LCD_sendData(const uint8 data, const bool type);
+static void LCD_write(const uint8 data, const bool type);
+static void LCD_waitBusyFlag(void);
+static bool LCD_isBusy(void);
+static void LCD_clearShown(void);
+static uint8 LCD_getAddress(const uint8 row, const uint8 col);
+
+
+void LCD_init(void) {
+	g_busy_flag = FALSE;
+	_delay_ms(LCD_POWER_UP_MS);		/* the LCD ignores instructions until its reset is done */
+
+	/* Configure the control pins (RS,RW,E) as output pins */
+	LCD_CTRL_DIR |= (1<<RS) | (1<<RW) | (1<<E);
+	
+	/* the tick isn't running yet: send the instructions at once */
+	#if (DATA_BITS_MODE == 4)
+		/* initialize LCD in 4-bit mode */
+		LCD_sendData(FOUR_BITS_DATA_MODE, 0);
+		/* use 2-line lcd + 4-bit Data Mode + 5*7 dot display Mode */
+		LCD_sendData(TWO_LINE_FOUR_BIT_MODE, 0);
+	#elif (DATA_BITS_MODE == 8)
+		/* use 2-line lcd + 8-bit Data Mode + 5*7 dot display Mode */
+		LCD_sendData(TWO_LINE_EIGHT_BIT_MODE, 0);
+	#endif
+
+	/* the busy flag can be read correctly once the data bus mode is set */
+	#if (LCD_BUSY_FLAG == 1)
+		g_busy_flag = TRUE;
+	#endif
+	
+	LCD_sendData(DISPLAY_ON_CURSOR_OFF, 0); 	/* turn on display */
+	LCD_sendData(CLEAR_SCREEN, 0);				/* clear the LCD */
+	LCD_clearShown();
+	LCD_clearScreen();							/* clear the frame buffer */
+	g_commands_head = g_commands_tail = 0;
+}
+
+void LCD_clearScreen(void) {
+	uint8 row, col;
+	for (row = 0; row < LCD_ROWS; row++)
+		for (col = 0; col < LCD_COLS; col++)
+			g_frame[row][col] = ' ';
+	g_row = 0;
+	g_col = 0;
+	g_dirty = TRUE;
+}
+
+void LCD_sendCommand(const uint8 command) {
+	uint8 next = (g_commands_head + 1) & (LCD_QUEUE_SIZE - 1);
+	/* wait only if the queue is full (LCD_pump frees one entry each tick) */
+	while (next == g_commands_tail);
+	g_commands[g_commands_head] = command;
+	g_commands_head = next;
+}
+
+void LCD_displayCharacter(const uint8 character) {
+	/* characters beyond the end of the line are not visible */
+	if (g_row < LCD_ROWS && g_col < LCD_COLS) {
+		g_frame[g_row][g_col] = character;
+		g_dirty = TRUE;
+	}
+	g_col++;
+}
+
+/* Called from the ISR every LCD_TICK_US: send at most one byte to the LCD */
+void LCD_pump(void) {
+	uint8 i, cell, row, col;
+	uint8 address, command;
+
+	/* timed mode: the last instruction is still executing */
+	if (g_wait_ticks != 0) {
+		g_wait_ticks--;
+		return;
+	}
+	/* nothing to send (the LCD isn't read either) */
+	if (g_commands_head == g_commands_tail && !g_dirty)
+		return;
+
+	/* busy flag mode: try again next tick */
+	if (g_busy_flag && LCD_isBusy()) {
+		/* the LCD doesn't answer (RW not wired): use the timed mode from now on */
+		if (++g_busy_ticks == LCD_BUSY_MAX_POLLS)
+			g_busy_flag = FALSE;
+		return;
+	}
+	g_busy_ticks = 0;
+
+	/* the commands are sent first */
+	if (g_commands_head != g_commands_tail) {
+		command = g_commands[g_commands_tail];
+		g_commands_tail = (g_commands_tail + 1) & (LCD_QUEUE_SIZE - 1);
+		LCD_write(command, 0);
+
+		/* the LCD is cleared OR its address counter is moved without the frame buffer */
+		g_address = 0xFF;
+		if (command == CLEAR_SCREEN) {
+			LCD_clearShown();
+			g_dirty = TRUE;
+		}
+		/* clear screen / return home take more than one tick */
+		if (!g_busy_flag && command <= 0x03)
+			g_wait_ticks = LCD_HOME_US / LCD_TICK_US;
+		return;
+	}
+
+	/* then the changed cells, starting after the last one sent */
+	for (i = 0; i < LCD_ROWS * LCD_COLS; i++) {
+		cell = g_next_cell;
+		row = cell / LCD_COLS;
+		col = cell % LCD_COLS;
+		if (g_frame[row][col] != g_shown[row][col]) {
+			/* the address counter moves to the next cell after each character,
+			 * so a run of changed cells needs one cursor move only */
+			address = LCD_getAddress(row, col);
+			if (address != g_address) {
+				LCD_write(address | SET_CURSOR_LOCATION, 0);
+				g_address = address;
+				return;
+			}
+			g_shown[row][col] = g_frame[row][col];
+			LCD_write(g_shown[row][col], 1);
+			g_address = address + 1;
+			g_next_cell = (cell + 1) % (LCD_ROWS * LCD_COLS);
+			return;
+		}
+		g_next_cell = (cell + 1) % (LCD_ROWS * LCD_COLS);
+	}
+	/* a full pass found no changed cell */
+	g_dirty = FALSE;
+}
+
+/* Send an instruction and wait for it to complete (used before the tick is running) */
+static void LCD_sendData(const uint8 data, const bool type) {
+	/* wait for the previous instruction to complete */
+	if (g_busy_flag)
+		LCD_waitBusyFlag();
+
+	LCD_write(data, type);
+
+	/* timed mode: wait for this instruction to complete (clear screen / return home are slow) */
+	if (!g_busy_flag) {
+		if (type == 0 && data <= 0x03)
+			_delay_us(LCD_HOME_US);
+		else
+			_delay_us(LCD_EXEC_US);
+	}
+}
+
+/* Put one instruction on the bus without waiting for it to complete */
+static void LCD_write(const uint8 data, const bool type) {
+	#if (DATA_BITS_MODE == 4)
+		/* Configure 4 adjacent pins of the data port as output pins */
+		LCD_DATA_DIR |= DATA_PINS;
+	#elif (DATA_BITS_MODE == 8)
+		/* Configure the data port as output port */
+		LCD_DATA_DIR = 0xFF;
+	#endif
+
+	TRACE_POINT(type == 0 ? TRACE_LCD_COMMAND : TRACE_LCD_DATA, data);
+
+	/* data is command -> RS = 0 OR data is character -> RS = 1 */
+	type == 0 ? CLEAR_BIT(LCD_CTRL_OUT,RS) : SET_BIT(LCD_CTRL_OUT,RS);
+	CLEAR_BIT(LCD_CTRL_OUT,RW);		/* write data to LCD -> RW = 0 */
+	_delay_us(LCD_STROBE_US);		/* delay for processing Tas = 50ns */
+	SET_BIT(LCD_CTRL_OUT,E);		/* Enable LCD -> E = 1 */
+	_delay_us(LCD_STROBE_US);		/* delay for processing = Tpw - Tdws = 190ns */
+	
+	#if (DATA_BITS_MODE == 4)
+		/* out the highest 4 bits of the required data to the data bus D4 --> D7 */
+		LCD_DATA_OUT = (LCD_DATA_OUT & ~DATA_PINS) | ((data & 0xF0) >> (4-PINS_POSITION));
+		_delay_us(LCD_STROBE_US);		/* delay for processing Tdsw = 100ns */
+		CLEAR_BIT(LCD_CTRL_OUT,E);		/* disable LCD -> E = 0 */
+		_delay_us(LCD_STROBE_US);		/* delay for processing Th = 13ns */
+		
+		SET_BIT(LCD_CTRL_OUT,E);		/* Enable LCD -> E = 1 */
+		_delay_us(LCD_STROBE_US);		/* delay for processing = Tpw - Tdws = 190ns */
+
+		/* out the lowest 4 bits of the required data to the data bus D4 --> D7 */
+		LCD_DATA_OUT = (LCD_DATA_OUT & ~DATA_PINS) | ((data & 0x0F) << PINS_POSITION);
+		_delay_us(LCD_STROBE_US);		/* delay for processing Tdsw = 100ns */
+		CLEAR_BIT(LCD_CTRL_OUT,E);		/* disable LCD -> E = 0 */
+		_delay_us(LCD_STROBE_US);		/* delay for processing Th = 13ns */
+
+	#elif (DATA_BITS_MODE == 8)
+		/* out the required data to the data bus D0 --> D7 */
+		LCD_DATA_OUT = data;
+		_delay_us(LCD_STROBE_US);			/* delay for processing Tdsw = 100ns */
+		CLEAR_BIT(LCD_CTRL_OUT,E);			/* disable LCD -> E = 0 */
+		_delay_us(LCD_STROBE_US);			/* delay for processing Th = 13ns */
+	#endif
+}
+
+static void LCD_waitBusyFlag(void) {
+	uint16 polls = 0;
+
+	while (LCD_isBusy()) {
+		/* the LCD doesn't answer (RW not wired): use the timed mode from now on */
+		if (++polls == LCD_BUSY_MAX_POLLS) {
+			g_busy_flag = FALSE;
+			_delay_us(LCD_HOME_US);
+			break;
+		}
+	}
+}
+
+/* Read the busy flag once */
+static bool LCD_isBusy(void) {
+	bool busy;
+
+	#if (DATA_BITS_MODE == 4)
+		/* Configure 4 adjacent pins of the data port as input pins */
+		LCD_DATA_DIR &= ~DATA_PINS;
+	#elif (DATA_BITS_MODE == 8)
+		/* Configure the data port as input port */
+		LCD_DATA_DIR = 0x00;
+	#endif
+
+	/* read busy flag and address -> RS = 0, RW = 1 */
+	CLEAR_BIT(LCD_CTRL_OUT,RS);
+	SET_BIT(LCD_CTRL_OUT,RW);
+	_delay_us(LCD_STROBE_US);		/* delay for processing Tas = 50ns */
+	SET_BIT(LCD_CTRL_OUT,E);		/* Enable LCD -> E = 1 */
+	_delay_us(LCD_STROBE_US);		/* delay for data output Tddr = 360ns */
+
+	#if (DATA_BITS_MODE == 4)
+		/* busy flag is D7 in the highest 4 bits */
+		busy = BIT_IS_SET(LCD_DATA_IN,PINS_POSITION + 3) ? TRUE : FALSE;
+		CLEAR_BIT(LCD_CTRL_OUT,E);		/* disable LCD -> E = 0 */
+		_delay_us(LCD_STROBE_US);
+
+		/* clock out the lowest 4 bits (address counter, not needed) */
+		SET_BIT(LCD_CTRL_OUT,E);
+		_delay_us(LCD_STROBE_US);
+		CLEAR_BIT(LCD_CTRL_OUT,E);
+	#elif (DATA_BITS_MODE == 8)
+		busy = BIT_IS_SET(LCD_DATA_IN,7) ? TRUE : FALSE;
+		CLEAR_BIT(LCD_CTRL_OUT,E);		/* disable LCD -> E = 0 */
+	#endif
+
+	CLEAR_BIT(LCD_CTRL_OUT,RW);
+	return busy;
+}
+
+static void LCD_clearShown(void) {
+	uint8 row, col;
+	for (row = 0; row < LCD_ROWS; row++)
+		for (col = 0; col < LCD_COLS; col++)
+			g_shown[row][col] = ' ';
+}
+
+void LCD_displayString(const char *str) {
+	while ((*str) != '\0') {
+		LCD_displayCharacter(*str);
+		str++;
+	}
+}
+
+void LCD_displayString_P(const char *str) {
+	char character;
+	/* read the string from the flash one character at a time */
+	while ((character = pgm_read_byte(str)) != '\0') {
+		LCD_displayCharacter(character);
+		str++;
+	}
+}
+
+void LCD_moveCursorTo(const uint8 row, const uint8 col) {
+	/* the LCD cursor is moved by LCD_pump when needed */
+	g_row = row;
+	g_col = col;
+}
+
+static uint8 LCD_getAddress(const uint8 row, const uint8 col) {
+	uint8 address;
+	/* calculate the required address */
+	switch(row) {
+		case 0:		address = col;				break;
+		case 1:		address = col + 0x40;		break;
+		case 2:		address = col + 0x10;		break;
+		case 3:		address = col + 0x50;		break;
+		default:	address = col;				break;		/* invalid row: first row */
+	}					
+	/* to write to a specific address in the LCD
+	 * we need to apply the corresponding command
+	 * 0x80 + address OR 0x80 | address (no difference)
+	 * Max Address = 0x5F = 0b0101.1111 AND 0x80 = 0b1000.0000*/
+	return address;
+}
+
+void LCD_displayStringAt(const uint8 row, const uint8 col, const char *str) {
+	LCD_moveCursorTo(row,col);		/* go to to the required LCD position */
+	LCD_displayString(str);			/* display the string */
+}
+
+void LCD_displayStringAt_P(const uint8 row, const uint8 col, const char *str) {
+	LCD_moveCursorTo(row,col);		/* go to to the required LCD position */
+	LCD_displayString_P(str);		/* display the string from the flash */
+}
+
+void LCD_displayInteger(const sint32 data) {
+   char buff[16];					/* string to hold the ASCII result */
+   itoa(data, buff, 10);			/* 10 for decimal (base 10) */
+   LCD_displayString(buff);			/* display the string */
+}
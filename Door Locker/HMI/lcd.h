@@ -1,52 +1,82 @@
-/* Driver for LCD (2x16 or 4x16) (4-bit or 8-bit) */
-
-#ifndef LCD_H_
-#define LCD_H_
-
-
-#include <stdlib.h>
-#include "std_types.h"
-#include "micro_config.h"
-#include "common_macros.h"
-
-
-/* LCD data bits mode configuration */
-#define DATA_BITS_MODE 8
-
-/* LCD HW Pins */
-#if (DATA_BITS_MODE == 4)		/* Use higher 4 bits in the data port */
-#define PINS_POSITION 0			/* (0 -> 4) select 4 adjacent pins for LCD data port */
-#endif
-#define LCD_DATA_DIR DDRC
-#define LCD_DATA_IN	 PINC
-#define LCD_DATA_OUT PORTC
-
-#define RS PA2
-#define RW PA1
-#define E  PA0
-#define LCD_CTRL_DIR DDRA
-#define LCD_CTRL_OUT PORTA
-
-/* LCD Commands */
-#define CLEAR_SCREEN 0x01
-#define FOUR_BITS_DATA_MODE 0x02
-#define TWO_LINE_FOUR_BIT_MODE 0x28
-#define TWO_LINE_EIGHT_BIT_MODE 0x38
-#define DISPLAY_ON_CURSOR_BLINK 0x0F
-#define DISPLAY_ON_CURSOR_OFF 0x0C
-#define DISPLAY_ON_CURSOR_ON 0x0E
-#define SET_CURSOR_LOCATION 0x80 
-
-
-/* Functions Prototypes */
-void LCD_init(void);
-void LCD_clearScreen(void);
-void LCD_sendCommand(const uint8 command);
-void LCD_displayCharacter(const uint8 character);
-void LCD_displayString(const char *str);
-void LCD_displayInteger(const sint32 data);
-void LCD_moveCursorTo(const uint8 row, const uint8 col);
-void LCD_displayStringAt(const uint8 row, const uint8 col, const char *str);
-
-
-#endif /* LCD_H_ */
+/* Driver for LCD (2x16 or 4x16) (4-bit or 8-bit) */
+
+/* Constraints:
+ * the display functions write into a RAM frame buffer and return at once
+ * LCD_sendCommand queues the command and returns at once (waits only if the queue is full)
+ * the _P functions take strings in the flash (PSTR("...") OR PROGMEM arrays)
+ * LCD_pump must be called every LCD_TICK_US (from a timer ISR) after LCD_init, it sends
+ * one queued command OR one byte of the changed cells per call
+ */
+
+#ifndef LCD_H_
+#define LCD_H_
+
+
+#include <stdlib.h>
+#include <avr/pgmspace.h>
+#include "std_types.h"
+#include "micro_config.h"
+#include "common_macros.h"
+
+
+/* LCD data bits mode configuration */
+#define DATA_BITS_MODE 8
+
+/* LCD size configuration */
+#define LCD_ROWS 2
+#define LCD_COLS 16
+
+/* LCD timing configuration
+ * LCD_BUSY_FLAG 1: poll the busy flag before each instruction (RW pin must be wired)
+ * LCD_BUSY_FLAG 0: wait the max execution time after each instruction */
+#define LCD_BUSY_FLAG 1
+#define LCD_BUSY_MAX_POLLS 500		/* polls / ticks before falling back to the timed mode (LCD doesn't answer) */
+#define LCD_STROBE_US 0.5			/* min setup / pulse / hold time of the bus signals (max 450ns needed) */
+#define LCD_EXEC_US 50				/* max execution time of an instruction (37us needed) */
+#define LCD_HOME_US 1600			/* max execution time of clear screen / return home (1.52ms needed) */
+#define LCD_POWER_UP_MS 40			/* time of the LCD internal reset after power up */
+
+/* LCD output configuration */
+#define LCD_TICK_US 1000			/* period of the LCD_pump calls (more than LCD_EXEC_US) */
+#define LCD_QUEUE_SIZE 4			/* max number of commands waiting to be sent (power of 2) */
+
+/* LCD HW Pins */
+#if (DATA_BITS_MODE == 4)		/* Use higher 4 bits in the data port */
+#define PINS_POSITION 0			/* (0 -> 4) select 4 adjacent pins for LCD data port */
+#endif
+#define LCD_DATA_DIR DDRC
+#define LCD_DATA_IN	 PINC
+#define LCD_DATA_OUT PORTC
+
+#define RS PA2
+#define RW PA1
+#define E  PA0
+#define LCD_CTRL_DIR DDRA
+#define LCD_CTRL_OUT PORTA
+
+/* LCD Commands */
+#define CLEAR_SCREEN 0x01
+#define FOUR_BITS_DATA_MODE 0x02
+#define TWO_LINE_FOUR_BIT_MODE 0x28
+#define TWO_LINE_EIGHT_BIT_MODE 0x38
+#define DISPLAY_ON_CURSOR_BLINK 0x0F
+#define DISPLAY_ON_CURSOR_OFF 0x0C
+#define DISPLAY_ON_CURSOR_ON 0x0E
+#define SET_CURSOR_LOCATION 0x80 
+
+
+/* Functions Prototypes */
+void LCD_init(void);
+void LCD_clearScreen(void);
+void LCD_sendCommand(const uint8 command);
+void LCD_displayCharacter(const uint8 character);
+void LCD_displayString(const char *str);
+void LCD_displayInteger(const sint32 data);
+void LCD_moveCursorTo(const uint8 row, const uint8 col);
+void LCD_displayStringAt(const uint8 row, const uint8 col, const char *str);
+void LCD_displayString_P(const char *str);
+void LCD_displayStringAt_P(const uint8 row, const uint8 col, const char *str);
+void LCD_pump(void);
+
+
+#endif /* LCD_H_ */
@@ -0,0 +1,39 @@
+/* Driver for Atmega16 sleep modes and CPU duty cycle measurement */
+
+/* Constraints:
+ * uses TIMER2 (free running, overflow every 32.768 ms) as the time base of the measurement
+ * IDLE is the deepest usable sleep mode: the ATmega16 has no pin change interrupts to wake on
+ * a keypad row and no 32 kHz crystal for power save, so timers and USART must keep running
+ * This file must be identical in both HMI and Control projects
+ */
+
+
+#ifndef POWER_H_
+#define POWER_H_
+
+
+#include "std_types.h"
+#include "micro_config.h"
+#include "common_macros.h"
+
+
+/* Number of TIMER2 counts in a second */
+#define POWER_COUNTS_PER_SECOND (F_CPU / 1024UL)
+
+
+/* Turn off the unused analog comparator and start measuring the duty cycle */
+void POWER_init(void);
+
+/* Sleep in IDLE mode until the next interrupt (its ISR has run on return)
+ * must be called with global interrupts disabled after checking that no work is pending,
+ * so an interrupt coming after the check can't be missed, interrupts are enabled on return */
+void POWER_idle(void);
+
+/* Wait for ms milliseconds sleeping between the interrupts (replaces _delay_ms for long waits) */
+void POWER_delayMs(const uint16 ms);
+
+/* Get the awake time in per mille since the previous call (OR POWER_init) and start a new period */
+uint16 POWER_getDutyCycle(void);
+
+
+#endif /* POWER_H_ */
@@ -0,0 +1,161 @@
+/* Framed binary protocol between HMI and Control microcontrollers over UART */
+
+#include "uart.h"
+#include "protocol.h"
+
+
+/* Frame overhead: SOF + LEN + SEQ + CMD + CRC */
+#define FRAME_OVERHEAD 5
+
+/* Receiver states */
+typedef enum {
+	WAIT_SOF, WAIT_LEN, WAIT_SEQ, WAIT_CMD, WAIT_PAYLOAD, WAIT_CRC
+} PROTOCOL_RxState;
+
+
+/* Global variables of the frame parser */
+static PROTOCOL_RxState g_rx_state = WAIT_SOF;
+static uint8 g_rx_index = 0;
+static uint8 g_rx_crc = 0;
+static PROTOCOL_Frame g_rx_frame;
+
+/* Global sequence number of the next request */
+static uint8 g_seq = 0;
+
+/* Global copy of the last reply (to answer retransmitted requests) */
+static PROTOCOL_Frame g_last_reply;
+static uint8 g_last_request_cmd;
+static uint8 g_last_request_crc;		/* CRC of the payload: a reset HMI reuses the sequence numbers */
+static bool g_last_reply_valid = FALSE;
+
+
+uint8 PROTOCOL_crc8(uint8 crc, const uint8 *data, uint8 len) {
+	uint8 i;
+	while (len--) {
+		crc ^= *data++;
+		for (i = 0; i < 8; i++)
+			crc = (crc & 0x80) ? (uint8)((crc << 1) ^ 0x07) : (uint8)(crc << 1);
+	}
+	return crc;
+}
+
+/* CRC of the payload of a request (with its length as initial value) */
+static uint8 PROTOCOL_requestCrc(const PROTOCOL_Frame * const request) {
+	return PROTOCOL_crc8(request->len, request->payload, request->len);
+}
+
+void PROTOCOL_sendFrame(const PROTOCOL_Frame * const frame) {
+	uint8 buf[PROTOCOL_MAX_PAYLOAD + FRAME_OVERHEAD];
+	uint8 size = 0;
+	uint8 sent = 0;
+	uint8 i;
+
+	buf[size++] = PROTOCOL_SOF;
+	buf[size++] = frame->len;
+	buf[size++] = frame->seq;
+	buf[size++] = frame->cmd;
+	for (i = 0; i < frame->len; i++)
+		buf[size++] = frame->payload[i];
+	buf[size] = PROTOCOL_crc8(0, &buf[1], size - 1);
+	size++;
+
+	/* queue the whole frame, normally it fits in the TX buffer at once */
+	while (sent < size)
+		sent += UART_write(&buf[sent], size - sent);
+}
+
+bool PROTOCOL_canSend(const uint8 len) {
+	return UART_getTxFree() >= len + FRAME_OVERHEAD;
+}
+
+PROTOCOL_Status PROTOCOL_receiveFrame(PROTOCOL_Frame * const frame) {
+	uint8 data;
+	while (UART_tryReceive(&data)) {
+		switch (g_rx_state) {
+			case WAIT_SOF:
+				if (data == PROTOCOL_SOF) {
+					g_rx_crc = 0;
+					g_rx_state = WAIT_LEN;
+				}
+				break;
+
+			case WAIT_LEN:
+				if (data > PROTOCOL_MAX_PAYLOAD) {
+					/* can't be a length, try to resynchronize on it */
+					g_rx_state = (data == PROTOCOL_SOF) ? WAIT_LEN : WAIT_SOF;
+					break;
+				}
+				g_rx_frame.len = data;
+				g_rx_crc = PROTOCOL_crc8(g_rx_crc, &data, 1);
+				g_rx_state = WAIT_SEQ;
+				break;
+
+			case WAIT_SEQ:
+				g_rx_frame.seq = data;
+				g_rx_crc = PROTOCOL_crc8(g_rx_crc, &data, 1);
+				g_rx_state = WAIT_CMD;
+				break;
+
+			case WAIT_CMD:
+				g_rx_frame.cmd = data;
+				g_rx_crc = PROTOCOL_crc8(g_rx_crc, &data, 1);
+				g_rx_index = 0;
+				g_rx_state = (g_rx_frame.len == 0) ? WAIT_CRC : WAIT_PAYLOAD;
+				break;
+
+			case WAIT_PAYLOAD:
+				g_rx_frame.payload[g_rx_index++] = data;
+				g_rx_crc = PROTOCOL_crc8(g_rx_crc, &data, 1);
+				if (g_rx_index == g_rx_frame.len)
+					g_rx_state = WAIT_CRC;
+				break;
+
+			case WAIT_CRC:
+				g_rx_state = WAIT_SOF;
+				*frame = g_rx_frame;
+				return (data == g_rx_crc) ? FRAME_OK : FRAME_ERROR;
+		}
+	}
+	return NO_FRAME;
+}
+
+void PROTOCOL_newRequest(PROTOCOL_Frame * const request, const uint8 cmd, const uint8 *payload, const uint8 len) {
+	uint8 i;
+
+	request->seq = g_seq++;
+	request->cmd = cmd;
+	request->len = len;
+	for (i = 0; i < len; i++)
+		request->payload[i] = payload[i];
+}
+
+void PROTOCOL_reply(const PROTOCOL_Frame * const request, const uint8 cmd, const uint8 *payload, const uint8 len) {
+	uint8 i;
+
+	g_last_reply.seq = request->seq;
+	g_last_reply.cmd = cmd;
+	g_last_reply.len = len;
+	for (i = 0; i < len; i++)
+		g_last_reply.payload[i] = payload[i];
+
+	/* a NAK'ed request will be sent again so it must not be treated as a retransmission */
+	g_last_request_cmd = request->cmd;
+	g_last_request_crc = PROTOCOL_requestCrc(request);
+	g_last_reply_valid = (cmd == ACK);
+
+	PROTOCOL_sendFrame(&g_last_reply);
+}
+
+bool PROTOCOL_replyRetransmission(const PROTOCOL_Frame * const request) {
+	if (g_last_reply_valid && request->seq == g_last_reply.seq && request->cmd == g_last_request_cmd &&
+			PROTOCOL_requestCrc(request) == g_last_request_crc) {
+		PROTOCOL_sendFrame(&g_last_reply);
+		return TRUE;
+	}
+	return FALSE;
+}
+
+bool PROTOCOL_isSameRequest(const PROTOCOL_Frame * const request, const PROTOCOL_Frame * const other) {
+	return request->seq == other->seq && request->cmd == other->cmd &&
+		PROTOCOL_requestCrc(request) == PROTOCOL_requestCrc(other);
+}
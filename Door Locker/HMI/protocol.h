@@ -0,0 +1,106 @@
+/* Framed binary protocol between HMI and Control microcontrollers over UART */
+
+/* Frame format:
+ * | SOF | LEN | SEQ | CMD | PAYLOAD (LEN bytes) | CRC |
+ * SOF = start of frame marker (PROTOCOL_SOF)
+ * LEN = number of payload bytes (0 .. PROTOCOL_MAX_PAYLOAD)
+ * SEQ = sequence number chosen by the requester and echoed in the response
+ * CMD = request command OR response type (ACK / NAK)
+ * CRC = CRC-8 (polynomial 0x07) of LEN, SEQ, CMD and PAYLOAD
+ *
+ * Every request is answered by exactly one ACK (optionally carrying data) or NAK
+ * with the same SEQ, a retransmitted request (same SEQ, CMD and payload) gets the same answer again
+ * This file must be identical in both HMI and Control projects
+ */
+
+
+#ifndef PROTOCOL_H_
+#define PROTOCOL_H_
+
+
+#include "std_types.h"
+#include "micro_config.h"
+#include "common_macros.h"
+
+
+/* Protocol configurations */
+#define PROTOCOL_SOF 0x7E				/* start of frame marker */
+#define PROTOCOL_MAX_PAYLOAD 8			/* max number of payload bytes in a frame */
+#define PROTOCOL_RETRIES 3				/* number of times a request is sent before giving up */
+#define PROTOCOL_TIMEOUT_MS 200			/* time to wait for a response before retrying */
+
+/* Request commands (HMI -> Control) */
+#define VERIFY_PASS 0x56				/* check entered password (response data: VERIFY_PASS result) */
+#define NEW_PASS 0x29					/* set new password */
+#define OPEN_DOOR 0x0D					/* open door (once, NAK unless a password OR user code was just verified) */
+#define THEFT_ALERT 0x7A				/* theft alert */
+#define ADD_USER 0x41					/* add a user code (response data: USER result, slot) */
+#define REVOKE_USER 0x52				/* remove a user (payload: slot, response data: USER result) */
+#define ENABLE_USER 0x45				/* enable (1) OR disable (0) a user (payload: slot, 1/0, response data: USER result) */
+#define LIST_USERS 0x4C					/* get the used then the enabled slots bitmaps (4 bytes each, little endian) */
+#define DUMP_LOG 0x44					/* send the event log (response data: number of events, then LOG_DATA frames) */
+#define POWER_REPORT 0x50				/* get the CPU duty cycle of control (response data: per mille, 2 bytes little endian) */
+#define DUMP_TRACE 0x54					/* send the trace buffer (response data: number of records, records since start 2 bytes,
+										 * TIMER1 clock select, TIMER1 top 2 bytes, then TRACE_DATA frames), built with -DTRACE only */
+
+/* Response types (Control -> HMI) */
+#define ACK 0x06						/* request is accepted (payload holds the response data) */
+#define NAK 0x15						/* request is corrupted or rejected */
+#define LOG_DATA 0x4A					/* one event of a log dump, SEQ = event index (0 is the oldest), not answered */
+#define TRACE_DATA 0x74					/* records of a trace dump (2 of 4 bytes), SEQ = frame index (0 is the oldest), not answered */
+
+/* VERIFY_PASS results */
+#define PASS_WRONG 0					/* wrong password, try again */
+#define PASS_CORRECT 1					/* correct password */
+#define PASS_LOCKED 2					/* too many wrong attempts: theft alert, no code is checked until it ends */
+#define PASS_USER 3						/* correct user code (response data: PASS_USER, slot) */
+
+/* User commands results (user commands are accepted for a while after the main password is verified) */
+#define USER_REJECTED 0					/* not allowed, table full, duplicate code OR unused slot */
+#define USER_DONE 1						/* done */
+
+
+typedef enum {
+	NO_FRAME, FRAME_OK, FRAME_ERROR
+} PROTOCOL_Status;
+
+typedef struct {
+	uint8 seq;
+	uint8 cmd;
+	uint8 len;
+	uint8 payload[PROTOCOL_MAX_PAYLOAD];
+} PROTOCOL_Frame;
+
+
+/* Calculate the CRC-8 of a buffer (crc is the initial value OR the result of a previous block) */
+uint8 PROTOCOL_crc8(uint8 crc, const uint8 *data, uint8 len);
+
+/* Send a frame in one burst */
+void PROTOCOL_sendFrame(const PROTOCOL_Frame * const frame);
+
+/* Check if a frame of len payload bytes fits in the UART TX buffer, so PROTOCOL_sendFrame won't wait */
+bool PROTOCOL_canSend(const uint8 len);
+
+/* Parse the received bytes without blocking
+ * FRAME_OK:    a valid frame is stored in frame
+ * FRAME_ERROR: a corrupted frame is dropped (frame holds its SEQ and CMD as received)
+ * NO_FRAME:    no complete frame yet */
+PROTOCOL_Status PROTOCOL_receiveFrame(PROTOCOL_Frame * const frame);
+
+/* Build a request with the next sequence number without sending it
+ * (the caller sends it with PROTOCOL_sendFrame, matches the response SEQ and retries without blocking) */
+void PROTOCOL_newRequest(PROTOCOL_Frame * const request, const uint8 cmd, const uint8 *payload, const uint8 len);
+
+/* Answer a request with an ACK OR NAK */
+void PROTOCOL_reply(const PROTOCOL_Frame * const request, const uint8 cmd, const uint8 *payload, const uint8 len);
+
+/* Resend the last reply if request is a retransmission of the last answered request (same SEQ, CMD and
+ * payload: the HMI restarts its sequence numbers at 0 after a reset, so a new request can reuse them)
+ * returns TRUE if it was a retransmission (so the request must not be executed again) */
+bool PROTOCOL_replyRetransmission(const PROTOCOL_Frame * const request);
+
+/* Check if two requests match the way PROTOCOL_replyRetransmission does (same SEQ, CMD and payload CRC) */
+bool PROTOCOL_isSameRequest(const PROTOCOL_Frame * const request, const PROTOCOL_Frame * const other);
+
+
+#endif /* PROTOCOL_H_ */
@@ -0,0 +1,95 @@
+/* Driver for a cooperative run-to-completion scheduler */
+
+#include "sched.h"
+#include "power.h"
+
+
+#if (SCHED_EVENTS > 8)
+#error "SCHED_EVENTS must be at most 8"
+#endif
+
+/* Queue entries: an event is queued at most once, plus one free entry (head == tail means empty) */
+#define SCHED_QUEUE_SIZE (SCHED_EVENTS + 1)
+
+
+/* Global queue of the posted events and bit mask of the queued events */
+static volatile uint8 g_queue[SCHED_QUEUE_SIZE];
+static volatile uint8 g_queue_head = 0;
+static volatile uint8 g_queue_tail = 0;
+static volatile uint8 g_queued = 0;
+
+/* Global pointers to the handler of each event and the idle check */
+static void (*g_handler[SCHED_EVENTS])(void);
+static void (*g_idle_check)(void) = NULL_PTR;
+
+
+static bool SCHED_take(uint8 * const event);
+
+
+void SCHED_init(void) {
+	uint8 i;
+
+	cli();
+	g_queue_head = g_queue_tail = 0;
+	g_queued = 0;
+	for (i = 0; i < SCHED_EVENTS; i++)
+		g_handler[i] = NULL_PTR;
+	g_idle_check = NULL_PTR;
+	sei();
+}
+
+void SCHED_setHandler(const uint8 event, void (*f_ptr)(void)) {
+	g_handler[event] = f_ptr;
+}
+
+void SCHED_setIdleCheck(void (*f_ptr)(void)) {
+	g_idle_check = f_ptr;
+}
+
+void SCHED_post(const uint8 event) {
+	/* called from ISRs (interrupts disabled) and handlers (enabled): restore the caller's state */
+	uint8 sreg = SREG;
+
+	cli();
+	if (!(g_queued & (1<<event))) {
+		g_queued |= (1<<event);
+		g_queue[g_queue_head] = event;
+		g_queue_head = (g_queue_head == SCHED_QUEUE_SIZE - 1) ? 0 : g_queue_head + 1;
+	}
+	SREG = sreg;
+}
+
+void SCHED_run(void) {
+	uint8 event;
+
+	while (1) {
+		if (SCHED_take(&event)) {
+			if (g_handler[event] != NULL_PTR)
+				(*g_handler[event])();
+			continue;
+		}
+
+		/* sleep until the next interrupt unless an ISR OR the idle check posted an event meanwhile */
+		cli();
+		if (g_queue_head == g_queue_tail && g_idle_check != NULL_PTR)
+			(*g_idle_check)();
+		if (g_queue_head == g_queue_tail)
+			POWER_idle();
+		else
+			sei();
+	}
+}
+
+/* Take the oldest posted event, it can be posted again while its handler runs */
+static bool SCHED_take(uint8 * const event) {
+	cli();
+	if (g_queue_head == g_queue_tail) {
+		sei();
+		return FALSE;
+	}
+	*event = g_queue[g_queue_tail];
+	g_queue_tail = (g_queue_tail == SCHED_QUEUE_SIZE - 1) ? 0 : g_queue_tail + 1;
+	g_queued &= ~(1<<*event);
+	sei();
+	return TRUE;
+}
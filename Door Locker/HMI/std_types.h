@@ -1,39 +1,41 @@
-#ifndef STD_TYPES_H_
-#define STD_TYPES_H_
-
-
-/* NULL pointer */
-#define NULL_PTR	((void *)0)
-
-/* boolean values */
-#ifndef TRUE
-#define TRUE	(1u)
-#endif
-
-#ifndef FALSE
-#define FALSE	(0u)
-#endif
-
-#ifndef HIGH
-#define HIGH	(1u)
-#endif
-
-#ifndef LOW
-#define LOW		(0u)
-#endif
-
-
-/* data types */
-typedef unsigned char		bool;
-typedef unsigned char		uint8;			/*                     0 .. 255                   */
-typedef signed char			sint8;			/*                  -128 .. 127                   */
-typedef unsigned short		uint16;			/*                     0 .. 65535                 */
-typedef signed short		sint16;			/*                -32768 .. 32767                 */
-typedef unsigned long		uint32;			/*                     0 .. 4294967295            */
-typedef signed long			sint32;			/*           -2147483648 .. 2147483647            */
-typedef unsigned long long	uint64;			/*                     0 .. 18446744073709551615  */
-typedef signed long long	sint64;			/*  -9223372036854775808 .. 9223372036854775807   */
-typedef float				float32;
-typedef double				float64;
-
-#endif /* STD_TYPE_H_ */
+#ifndef STD_TYPES_H_
+#define STD_TYPES_H_
+
+#include <stdint.h>
+
+
+/* NULL pointer */
+#define NULL_PTR	((void *)0)
+
+/* boolean values */
+#ifndef TRUE
+#define TRUE	(1u)
+#endif
+
+#ifndef FALSE
+#define FALSE	(0u)
+#endif
+
+#ifndef HIGH
+#define HIGH	(1u)
+#endif
+
+#ifndef LOW
+#define LOW		(0u)
+#endif
+
+
+/* data types (fixed width on every compiler: long is 64-bit on the host build) */
+typedef unsigned char		bool;
+typedef uint8_t				uint8;			/*                     0 .. 255                   */
+typedef int8_t				sint8;			/*                  -128 .. 127                   */
+typedef uint16_t			uint16;			/*                     0 .. 65535                 */
+typedef int16_t				sint16;			/*                -32768 .. 32767                 */
+typedef uint32_t			uint32;			/*                     0 .. 4294967295            */
+typedef int32_t				sint32;			/*           -2147483648 .. 2147483647            */
+typedef uint64_t			uint64;			/*                     0 .. 18446744073709551615  */
+typedef int64_t				sint64;			/*  -9223372036854775808 .. 9223372036854775807   */
+typedef float				float32;
+typedef double				float64;
+
+#endif /* STD_TYPE_H_ */
@@ -0,0 +1,108 @@
+/* Driver for the trace buffer: timestamped events of the drivers recorded in a RAM ring */
+
+#include "trace.h"
+
+#ifdef TRACE
+
+#include "timers.h"
+
+
+/* Records in a TRACE_DATA frame */
+#define TRACE_FRAME_RECORDS (PROTOCOL_MAX_PAYLOAD / sizeof(TRACE_Record))
+
+
+/* Global ring of records (g_trace_head is the next one to write) */
+TRACE_Record g_trace_ring[TRACE_SIZE];
+volatile uint8 g_trace_head = 0;
+volatile uint16 g_trace_total = 0;
+volatile bool g_trace_on = FALSE;
+
+/* Global TIMER1 wraps since the last record and the vector of the wrap ISR */
+volatile uint8 g_trace_wraps = 0;
+uint8 g_trace_wrap_vector = 0;
+
+/* Global state of the dump in progress: next record to send, records left and SEQ of the next frame */
+static uint8 g_dump_index;
+static uint8 g_dump_left = 0;
+static uint8 g_dump_seq;
+
+
+void TRACE_init(void) {
+	TIMERS_ConfigType timer1_config = {TIMER1, NORMAL, F_CPU_8, DISCONNECT_OC, 0, 0};
+
+	if ((TCCR1B & 0x07) == NO_CLOCK)
+		TIMERS_init(&timer1_config);
+
+	/* TIMER1 wraps at the compare A match in CTC mode (OCR1A top), otherwise at its overflow */
+	if (BIT_IS_SET(TCCR1B,WGM12) && BIT_IS_CLEAR(TCCR1B,WGM13)) {
+		g_trace_wrap_vector = TIMER1_COMPA_vect_num;
+	}
+	else {
+		g_trace_wrap_vector = TIMER1_OVF_vect_num;
+		SET_BIT(TIMSK,TOIE1);
+	}
+	g_trace_wraps = 0;
+	g_trace_on = TRUE;
+}
+
+void TRACE_recordWraps(const uint16 time) {
+	TRACE_WRITE(TRACE_WRAPS, g_trace_wraps, time);
+	g_trace_wraps = 0;
+}
+
+void TRACE_sendDump(const PROTOCOL_Frame * const request) {
+	uint8 info[6];
+	uint16 total, top;
+
+	/* the dump itself isn't recorded (its UART bytes would overwrite the records being sent) */
+	cli();
+	g_trace_on = FALSE;
+	total = g_trace_total;
+	sei();
+	g_dump_left = (total < TRACE_SIZE) ? total : TRACE_SIZE;
+	g_dump_index = (g_trace_head - g_dump_left) & (TRACE_SIZE - 1);
+	g_dump_seq = 0;
+
+	/* the decoder unwraps the count with the period of TIMER1 (top = OCR1A in CTC mode) */
+	top = (BIT_IS_SET(TCCR1B,WGM12) && BIT_IS_CLEAR(TCCR1B,WGM13)) ? OCR1A : 0xFFFF;
+	info[0] = g_dump_left;
+	info[1] = total;
+	info[2] = total >> 8;
+	info[3] = TCCR1B & 0x07;
+	info[4] = top;
+	info[5] = top >> 8;
+	PROTOCOL_reply(request, ACK, info, sizeof(info));
+
+	if (g_dump_left == 0)
+		g_trace_on = TRUE;
+}
+
+bool TRACE_isDumpReady(void) {
+	uint8 records = (g_dump_left < TRACE_FRAME_RECORDS) ? g_dump_left : TRACE_FRAME_RECORDS;
+	return g_dump_left != 0 && PROTOCOL_canSend(records * sizeof(TRACE_Record));
+}
+
+void TRACE_continueDump(void) {
+	PROTOCOL_Frame frame;
+	uint8 i, j;
+
+	if (!TRACE_isDumpReady())
+		return;
+
+	/* SEQ = index of the frame (0 holds the oldest records) */
+	frame.cmd = TRACE_DATA;
+	frame.seq = g_dump_seq++;
+	frame.len = 0;
+	for (i = 0; i < TRACE_FRAME_RECORDS && g_dump_left != 0; i++, g_dump_left--) {
+		const uint8 *record = (const uint8 *)&g_trace_ring[g_dump_index];
+		for (j = 0; j < sizeof(TRACE_Record); j++)
+			frame.payload[frame.len++] = record[j];
+		g_dump_index = (g_dump_index + 1) & (TRACE_SIZE - 1);
+	}
+	PROTOCOL_sendFrame(&frame);
+
+	if (g_dump_left == 0)
+		g_trace_on = TRUE;
+}
+
+#endif /* TRACE */
@@ -1,124 +1,294 @@
-/* Driver for Atmega16 UART module */
-
-#include "uart.h"
-
-#ifndef ASYNC
-#define BAUD_PRESCALE ((F_CPU / (USART_BAUDRATE * 2UL)) - 1)	
-#else
-	#ifdef UART_DOUBLE_SPEED
-	#define BAUD_PRESCALE ((F_CPU / (USART_BAUDRATE * 8UL)) - 1)	
-	#else
-	#define BAUD_PRESCALE ((F_CPU / (USART_BAUDRATE * 16UL)) - 1)	
-	#endif
-#endif
-
-
-void UART_init(const UART_ConfigType * const config_ptr) {
-	/* Initialize UCSRA Register:
-	 * RXC  = 0			receive complete flag
-	 * TXC  = 0			transmit complete flag
-	 * UDRE = 0			data register empty flag
-	 * FE   = 0			frame error flag
-	 * DOR  = 0			data overrun error flag
-	 * PE   = 0			parity error flag
-	 * U2X  = x			double transmission speed
-	 * MPCM = 0			disable multi-processor communication mode
-	 */
-
-	/* select transmission speed */
-	#ifdef UART_DOUBLE_SPEED
-		UCSRA = (1<<U2X);
-	#else
-		UCSRA = 0;
-	#endif
-
-	/* Initialize UCSRB Register:
-	 * RXCIE = 0		disable receive complete interrupt
-	 * TXCIE = 0		disable transmit complete interrupt
-	 * UDRIE = 0		disable data register empty interrupt
-	 * RXEN  = 1		enable receiver
-	 * TXEN  = 1		enable transmitter
-	 * UCSZ2 = 0		disable 9-bit data mode
-	 * RXB8  = 0		disable 9-bit data mode
-	 * TXB8  = 0		disable 9-bit data mode
-	 */
-	
-	/* enable receiver and transmitter */
-	UCSRB = (1<<RXEN) | (1<<TXEN);
-	
-	/* Initialize UCSRC Register:
-	 * URSEL   = 1		URSEL must be one when writing to UCSRC
-	 * UMSEL   = x		USART mode
-	 * UPM1:0  = xx		parity bit
-	 * USBS    = x		stop bit
-	 * UCSZ1:0 = xx		number of data bits
-	 * UCPOL   = x		UCPOL must be zero when using asynchronous mode
-	 */
-
-	/* write to UCSRC */
-	UCSRC = (1<<URSEL);
-
-	/* select UART mode */
-	#ifndef ASYNC
-		SET_BIT(UCSRC,UMSEL);
-	#endif
-
-	/* set parity mode */
-	UCSRC = (UCSRC & 0xCF) | (config_ptr->parity << 4);
-
-	/* select stop bits number */
-	if (config_ptr->stop)
-		SET_BIT(UCSRC,USBS);
-
-	/* set size of data bits */
-	UCSRC = (UCSRC & 0xF9) | (config_ptr->size << 1);
-
-	/* select clock polarity */
-	#ifdef TX_FALLING_RX_RISING
-		SET_BIT(UCSRC,UCPOL);
-	#endif
-	
-	/* set the UBRR to select the Baud Rate */
-	UBRRH = BAUD_PRESCALE >> 8;
-	UBRRL = BAUD_PRESCALE;
-}
-
-void UART_sendByte(const uint8 data) {
-	/* UDRE flag is set when the Tx buffer (UDR) is empty and ready for
-	 * transmitting a new byte so wait until this flag is set to one */
-	while(BIT_IS_CLEAR(UCSRA,UDRE));
-	/* Put the required data in the UDR register and also clear the UDRE flag
-	 * as the UDR register is not empty now */
-	UDR = data;
-	
-	/* Another Slower Method
-	UDR = data;
-	while(BIT_IS_CLEAR(UCSRA,TXC));		// Wait until the transimission is complete
-	SET_BIT(UCSRA,TXC);					// Clear the TXC flag
-	*/
-}
-
-uint8 UART_receiveByte(void) {
-	/* RXC flag is set when the UART receives data */
-	while(BIT_IS_CLEAR(UCSRA,RXC));
-	/* Read the received data from the Rx buffer (UDR)
-	 * the RXC flag will be cleared after reading UDR */
-    return UDR;
-}
-
-void UART_sendString(const uint8 *str) {
-	while(*str != '\0') {
-		UART_sendByte(*str);
-		str++;
-	}
-}
-
-void UART_receiveString(uint8 *str) {
-	uint8 i = 0;
-	str[i] = UART_receiveByte();
-	while(str[i] != UART_TERMINATION_CHAR) {
-		i++;
-		str[i] = UART_receiveByte();
-	}
-	str[i] = '\0';
-}
+/* Driver for Atmega16 UART module */
+
+#include "uart.h"
+#include "trace.h"
+
+#ifndef ASYNC
+#define BAUD_PRESCALE ((F_CPU / (USART_BAUDRATE * 2UL)) - 1)	
+#else
+	#ifdef UART_DOUBLE_SPEED
+	#define BAUD_PRESCALE ((F_CPU / (USART_BAUDRATE * 8UL)) - 1)	
+	#else
+	#define BAUD_PRESCALE ((F_CPU / (USART_BAUDRATE * 16UL)) - 1)	
+	#endif
+#endif
+
+#define RX_MASK (UART_RX_BUFFER_SIZE - 1)
+#define TX_MASK (UART_TX_BUFFER_SIZE - 1)
+
+#if ((UART_RX_BUFFER_SIZE & RX_MASK) || (UART_TX_BUFFER_SIZE & TX_MASK))
+#error "UART ring buffer sizes must be powers of 2"
+#endif
+
+
+/* Global variable holding the operation mode selected in UART_init */
+static UART_Mode g_mode = POLLING;
+
+/* Ring buffers used in interrupt mode
+ * head is only written by the producer and tail only by the consumer
+ * (single producer / single consumer) so no locking is needed on either side */
+static volatile uint8 g_rx_buffer[UART_RX_BUFFER_SIZE];
+static volatile uint8 g_rx_head = 0;
+static volatile uint8 g_rx_tail = 0;
+static volatile uint8 g_tx_buffer[UART_TX_BUFFER_SIZE];
+static volatile uint8 g_tx_head = 0;
+static volatile uint8 g_tx_tail = 0;
+
+/* Global counters of lost received bytes */
+static volatile uint16 g_rx_overflows = 0;		/* RX ring buffer was full */
+static volatile uint16 g_rx_overruns = 0;		/* UDR was not read in time by the ISR */
+
+/* Global pointer to the function called from the ISR after each received byte */
+static void (*volatile g_rx_callback)(void) = NULL_PTR;
+
+
+/* Interrupt Service Routine of receive complete (producer of the RX ring buffer) */
+ISR(USART_RXC_vect) {
+	/* the error flags must be read before UDR */
+	uint8 status = UCSRA;
+	uint8 data = UDR;
+	uint8 next = (g_rx_head + 1) & RX_MASK;
+
+	TRACE_POINT_ISR(TRACE_UART_RX, data);
+	if (BIT_IS_SET(status,DOR))
+		g_rx_overruns++;
+
+	if (next == g_rx_tail)
+		g_rx_overflows++;
+	else {
+		g_rx_buffer[g_rx_head] = data;
+		g_rx_head = next;
+	}
+
+	if (g_rx_callback != NULL_PTR)
+		(*g_rx_callback)();
+}
+
+/* Interrupt Service Routine of data register empty (consumer of the TX ring buffer) */
+ISR(USART_UDRE_vect) {
+	if (g_tx_head == g_tx_tail) {
+		/* nothing left to send, disable the interrupt until new data is queued */
+		CLEAR_BIT(UCSRB,UDRIE);
+	}
+	else {
+		TRACE_POINT_ISR(TRACE_UART_TX, g_tx_buffer[g_tx_tail]);
+		UDR = g_tx_buffer[g_tx_tail];
+		g_tx_tail = (g_tx_tail + 1) & TX_MASK;
+	}
+}
+
+
+void UART_init(const UART_ConfigType * const config_ptr) {
+	uint8 ucsrc;
+
+	/* Initialize UCSRA Register:
+	 * RXC  = 0			receive complete flag
+	 * TXC  = 0			transmit complete flag
+	 * UDRE = 0			data register empty flag
+	 * FE   = 0			frame error flag
+	 * DOR  = 0			data overrun error flag
+	 * PE   = 0			parity error flag
+	 * U2X  = x			double transmission speed
+	 * MPCM = 0			disable multi-processor communication mode
+	 */
+
+	/* select transmission speed */
+	#ifdef UART_DOUBLE_SPEED
+		UCSRA = (1<<U2X);
+	#else
+		UCSRA = 0;
+	#endif
+
+	/* Initialize UCSRB Register:
+	 * RXCIE = x		enable receive complete interrupt in interrupt mode
+	 * TXCIE = 0		disable transmit complete interrupt
+	 * UDRIE = 0		data register empty interrupt (enabled only while TX buffer has data)
+	 * RXEN  = 1		enable receiver
+	 * TXEN  = 1		enable transmitter
+	 * UCSZ2 = 0		disable 9-bit data mode
+	 * RXB8  = 0		disable 9-bit data mode
+	 * TXB8  = 0		disable 9-bit data mode
+	 */
+	
+	/* enable receiver and transmitter */
+	UCSRB = (1<<RXEN) | (1<<TXEN);
+
+	/* select polling or interrupt mode */
+	g_mode = config_ptr->mode;
+	g_rx_head = g_rx_tail = 0;
+	g_tx_head = g_tx_tail = 0;
+	if (g_mode == INTERRUPT)
+		SET_BIT(UCSRB,RXCIE);
+	
+	/* Initialize UCSRC Register:
+	 * URSEL   = 1		URSEL must be one when writing to UCSRC
+	 * UMSEL   = x		USART mode
+	 * UPM1:0  = xx		parity bit
+	 * USBS    = x		stop bit
+	 * UCSZ1:0 = xx		number of data bits
+	 * UCPOL   = x		UCPOL must be zero when using asynchronous mode
+	 */
+
+	/* UCSRC shares its address with UBRRH and a single read returns UBRRH,
+	 * so the value is built here and written once (a read-modify-write would write UBRRH) */
+	ucsrc = (1<<URSEL);
+
+	/* select UART mode */
+	#ifndef ASYNC
+		SET_BIT(ucsrc,UMSEL);
+	#endif
+
+	/* set parity mode */
+	ucsrc |= (config_ptr->parity << 4);
+
+	/* select stop bits number */
+	if (config_ptr->stop)
+		SET_BIT(ucsrc,USBS);
+
+	/* set size of data bits */
+	ucsrc |= (config_ptr->size << 1);
+
+	/* select clock polarity */
+	#ifdef TX_FALLING_RX_RISING
+		SET_BIT(ucsrc,UCPOL);
+	#endif
+
+	/* write to UCSRC */
+	UCSRC = ucsrc;
+	
+	/* set the UBRR to select the Baud Rate */
+	UBRRH = BAUD_PRESCALE >> 8;
+	UBRRL = BAUD_PRESCALE;
+}
+
+void UART_sendByte(const uint8 data) {
+	if (g_mode == INTERRUPT) {
+		/* wait for a free slot in the TX buffer then let the UDRE interrupt send it */
+		while (UART_write(&data, 1) == 0);
+		return;
+	}
+
+	/* UDRE flag is set when the Tx buffer (UDR) is empty and ready for
+	 * transmitting a new byte so wait until this flag is set to one */
+	while(BIT_IS_CLEAR(UCSRA,UDRE));
+	/* Put the required data in the UDR register and also clear the UDRE flag
+	 * as the UDR register is not empty now */
+	TRACE_POINT(TRACE_UART_TX, data);
+	UDR = data;
+	
+	/* Another Slower Method
+	UDR = data;
+	while(BIT_IS_CLEAR(UCSRA,TXC));		// Wait until the transimission is complete
+	SET_BIT(UCSRA,TXC);					// Clear the TXC flag
+	*/
+}
+
+uint8 UART_receiveByte(void) {
+	uint8 data;
+
+	if (g_mode == INTERRUPT) {
+		while (!UART_tryReceive(&data));
+		return data;
+	}
+
+	/* RXC flag is set when the UART receives data */
+	while(BIT_IS_CLEAR(UCSRA,RXC));
+	/* Read the received data from the Rx buffer (UDR)
+	 * the RXC flag will be cleared after reading UDR */
+	data = UDR;
+	TRACE_POINT(TRACE_UART_RX, data);
+	return data;
+}
+
+void UART_sendString(const uint8 *str) {
+	while(*str != '\0') {
+		UART_sendByte(*str);
+		str++;
+	}
+}
+
+void UART_receiveString(uint8 *str) {
+	uint8 i = 0;
+	str[i] = UART_receiveByte();
+	while(str[i] != UART_TERMINATION_CHAR) {
+		i++;
+		str[i] = UART_receiveByte();
+	}
+	str[i] = '\0';
+}
+
+uint8 UART_getRxCount(void) {
+	if (g_mode == INTERRUPT)
+		return (g_rx_head - g_rx_tail) & RX_MASK;
+	return BIT_IS_SET(UCSRA,RXC) ? 1 : 0;
+}
+
+bool UART_tryReceive(uint8 * const data) {
+	if (g_mode == INTERRUPT) {
+		if (g_rx_tail == g_rx_head)
+			return FALSE;
+		*data = g_rx_buffer[g_rx_tail];
+		g_rx_tail = (g_rx_tail + 1) & RX_MASK;
+		return TRUE;
+	}
+
+	if (BIT_IS_CLEAR(UCSRA,RXC))
+		return FALSE;
+	*data = UDR;
+	TRACE_POINT(TRACE_UART_RX, *data);
+	return TRUE;
+}
+
+uint8 UART_getTxFree(void) {
+	if (g_mode == INTERRUPT)
+		return (g_tx_tail - g_tx_head - 1) & TX_MASK;
+	return BIT_IS_SET(UCSRA,UDRE) ? 1 : 0;
+}
+
+uint8 UART_write(const uint8 * const buf, const uint8 len) {
+	uint8 i;
+
+	if (g_mode == INTERRUPT) {
+		for (i = 0; i < len; i++) {
+			uint8 next = (g_tx_head + 1) & TX_MASK;
+			if (next == g_tx_tail)
+				break;					/* TX buffer is full */
+			g_tx_buffer[g_tx_head] = buf[i];
+			g_tx_head = next;
+		}
+		/* (re)start transmission, the ISR disables it again when the buffer is empty */
+		if (i != 0)
+			SET_BIT(UCSRB,UDRIE);
+		return i;
+	}
+
+	/* polling mode: only send what the hardware can take right now */
+	for (i = 0; i < len && BIT_IS_SET(UCSRA,UDRE); i++) {
+		TRACE_POINT(TRACE_UART_TX, buf[i]);
+		UDR = buf[i];
+	}
+	return i;
+}
+
+uint16 UART_getRxOverflowCount(void) {
+	uint16 count;
+	uint8 sreg = SREG;
+	/* 16-bit read must not be interrupted by the RX ISR */
+	cli();
+	count = g_rx_overflows;
+	SREG = sreg;
+	return count;
+}
+
+uint16 UART_getRxOverrunCount(void) {
+	uint16 count;
+	uint8 sreg = SREG;
+	cli();
+	count = g_rx_overruns;
+	SREG = sreg;
+	return count;
+}
+
+void UART_setRxCallBack(void (*f_ptr)(void)) {
+	g_rx_callback = f_ptr;
+}
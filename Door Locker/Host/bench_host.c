@@ -0,0 +1,140 @@
+/* Host build: runner of the driver benchmark (Bench/bench.c) on the mock with the board models */
+
+/* Usage: bench_host [-t time limit ms]
+ * answers the lines of the benchmark (keypad keys, UART bytes, results) and prints its results:
+ * "<name>_cycles: <cycles of one call>" and "<name>_us: <time of one call at F_CPU>" lines,
+ * then the counters of the run
+ * the cycles are the ones of the mock (HOST_ACCESS_CYCLES per register access, code without
+ * register accesses takes no time): compare them between commits, NOT with simavr OR the board
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "host.h"
+#include "hd44780.h"
+#include "keymatrix.h"
+#include "m24cxx.h"
+
+
+/* Board wiring (lcd.h, keypad.h) */
+#define LCD_DATA_PORT 'C'
+#define LCD_CTRL_PORT 'A'
+#define LCD_RS 2
+#define LCD_RW 1
+#define LCD_E 0
+#define KEYPAD_PORT 'B'
+
+/* Runner configurations (see bench.c) */
+#define BENCH_ACK '!'				/* answer to a key request */
+#define BENCH_RX_DATA 0x55			/* bytes sent for a "@rx" request */
+#define LINE_SIZE 64
+#define TIME_LIMIT_MS 10000			/* default time limit */
+
+
+/* Benchmark main (bench.c is compiled with -Dmain=firmware_main) */
+int firmware_main(void);
+
+static void bench_port(const uint8 port);
+static uint8 bench_pin(const uint8 port, const uint8 level);
+static void bench_tx(const uint8 data);
+static void bench_line(const char *line);
+static void bench_end(void);
+
+
+/* Global state of the runner */
+static char g_line[LINE_SIZE];
+static uint8 g_length = 0;
+static char g_key = '-';
+static bool g_done = FALSE;
+
+
+int main(int argc, char *argv[]) {
+	uint64 limit = HOST_MS(TIME_LIMIT_MS);
+	int option;
+
+	while ((option = getopt(argc, argv, "t:")) != -1) {
+		switch (option) {
+		case 't':
+			limit = HOST_MS(strtoul(optarg, NULL, 10));
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-t time limit ms]\n", argv[0]);
+			return 2;
+		}
+	}
+
+	HOST_init();
+	HD44780_init(LCD_DATA_PORT, LCD_CTRL_PORT, LCD_RS, LCD_RW, LCD_E);
+	KEYMATRIX_init(KEYPAD_PORT);
+	M24CXX_init();
+	HOST_setPortHook(bench_port);
+	HOST_setPinHook(bench_pin);
+	HOST_setUartTxHook(bench_tx);
+	HOST_setTimeLimit(limit, bench_end);
+
+	firmware_main();
+	HOST_finish();
+	return 0;
+}
+
+
+static void bench_port(const uint8 port) {
+	HD44780_portWritten(port);
+}
+
+static uint8 bench_pin(const uint8 port, const uint8 level) {
+	return KEYMATRIX_pinLevel(port, HD44780_pinLevel(port, level));
+}
+
+static void bench_tx(const uint8 data) {
+	if (data != '\n') {
+		if (g_length < LINE_SIZE - 1)
+			g_line[g_length++] = data;
+		return;
+	}
+	g_line[g_length] = '\0';
+	g_length = 0;
+	bench_line(g_line);
+}
+
+/* Answer a line of the benchmark: a request OR a result */
+static void bench_line(const char *line) {
+	char name[LINE_SIZE];
+	unsigned long runs, cycles;
+	unsigned long i;
+
+	if (strncmp(line, "@rx ", 4) == 0) {
+		for (i = strtoul(&line[4], NULL, 10); i > 0; i--)
+			HOST_uartReceive(BENCH_RX_DATA);
+		return;
+	}
+	if (strcmp(line, "@end") == 0) {
+		g_done = TRUE;
+		HOST_finish();
+	}
+
+	if (strncmp(line, "@key ", 5) == 0) {
+		if (g_key != '-')
+			KEYMATRIX_release(g_key);
+		g_key = line[5];
+		if (g_key != '-')
+			KEYMATRIX_press(g_key);
+	}
+	else if (sscanf(line, "%63s %lu %lu", name, &runs, &cycles) == 3 && runs != 0) {
+		printf("%s_cycles: %.1f\n", name, (double)cycles / runs);
+		printf("%s_us: %.3f\n", name, (double)cycles / runs * 1000000.0 / F_CPU);
+	}
+	else if (*line != '\0')
+		fprintf(stderr, "bench: unexpected line \"%s\"\n", line);
+	HOST_uartReceive(BENCH_ACK);
+}
+
+static void bench_end(void) {
+	HOST_report(stdout);
+	if (!g_done) {
+		fprintf(stderr, "bench: not done at the time limit\n");
+		fflush(NULL);
+		exit(1);
+	}
+}
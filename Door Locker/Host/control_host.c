@@ -0,0 +1,204 @@
+/* Host build: runner of the Control firmware (24Cxx EEPROM, motor, buzzer and UART line driven by a script) */
+
+/* Usage: control_host [-t time limit ms] [-e eeprom image] [-l in,out] [-w capture] [-q] [script]   (the script is read from stdin by default)
+ * the EEPROM image is loaded at the start if it exists and saved at the end
+ * -l links the UART line to the other runner through two file descriptors (see link.h, cosim.c)
+ * -w writes the bytes sent on the UART line to a file (binary, e.g. a trace dump for tracedump)
+ * Script commands (see script.h for the line format):
+ *   rx <hex bytes>					bytes received on the UART line
+ *   frame <cmd> <seq> [payload]	frame received on the UART line (hex, the CRC is added)
+ * Output: one line per motor / buzzer change and UART frame, prefixed with the simulated time in ms,
+ * then the counters of the run ("name: value" lines).
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "host.h"
+#include "m24cxx.h"
+#include "frames.h"
+#include "script.h"
+#include "link.h"
+
+
+/* Board wiring (control.c) */
+#define BUZZER_PORT 'A'
+#define BUZZER_PIN 0
+#define MOTOR_PORT 'B'
+#define MOTOR_MASK 0x03				/* PB0 = clockwise, PB1 = anticlockwise */
+
+/* Runner configurations */
+#define TIME_LIMIT_MS 60000			/* default time limit */
+
+
+/* Firmware main (control.c is compiled with -Dmain=firmware_main) */
+int firmware_main(void);
+
+static void control_port(const uint8 port);
+static void control_tx(const uint8 data);
+static void control_linkRx(const uint8 data);
+static void control_rx(const char *args);
+static void control_frame(const char *args);
+static void control_end(void);
+
+
+static const SCRIPT_Command g_commands[] = {
+	{"rx", control_rx},
+	{"frame", control_frame},
+	{NULL_PTR, NULL_PTR}
+};
+
+static const char * const g_motor_states[] = {"stop", "cw", "ccw", "shorted"};
+
+/* Global state of the runner */
+static bool g_quiet = FALSE;
+static const char *g_eeprom = NULL_PTR;
+static FILE *g_capture = NULL_PTR;
+static FRAMES_Decoder g_tx;
+static FRAMES_Decoder g_rx;
+static uint8 g_motor = 0;
+static uint8 g_buzzer = 0;
+static uint32 g_frames_tx = 0;
+static uint32 g_frames_rx = 0;
+static uint32 g_motor_changes = 0;
+static uint32 g_buzzer_changes = 0;
+
+
+int main(int argc, char *argv[]) {
+	FILE *script = stdin;
+	uint64 limit = HOST_MS(TIME_LIMIT_MS);
+	const char *peer = NULL_PTR;
+	int option;
+
+	while ((option = getopt(argc, argv, "t:e:l:w:q")) != -1) {
+		switch (option) {
+		case 't':
+			limit = HOST_MS(strtoul(optarg, NULL, 10));
+			break;
+		case 'e':
+			g_eeprom = optarg;
+			break;
+		case 'l':
+			peer = optarg;
+			break;
+		case 'w':
+			if ((g_capture = fopen(optarg, "wb")) == NULL) {
+				perror(optarg);
+				return 2;
+			}
+			break;
+		case 'q':
+			g_quiet = TRUE;
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-t time limit ms] [-e eeprom image] [-l in,out] [-w capture] [-q] [script]\n", argv[0]);
+			return 2;
+		}
+	}
+	if (optind < argc && (script = fopen(argv[optind], "r")) == NULL) {
+		perror(argv[optind]);
+		return 2;
+	}
+
+	HOST_init();
+	M24CXX_init();
+	if (g_eeprom != NULL_PTR && access(g_eeprom, F_OK) == 0 && !M24CXX_load(g_eeprom))
+		return 2;
+	HOST_setPortHook(control_port);
+	HOST_setUartTxHook(control_tx);
+	HOST_setTimeLimit(limit, control_end);
+
+	if (peer != NULL_PTR && !LINK_init(peer, control_linkRx)) {
+		fprintf(stderr, "-l: two file descriptors expected (in,out)\n");
+		return 2;
+	}
+	if (!SCRIPT_load(script, g_commands))
+		return 2;
+	SCRIPT_start();
+
+	firmware_main();
+	HOST_finish();
+	return 0;
+}
+
+
+/* Print the motor and buzzer changes (only the pins configured as outputs drive them) */
+static void control_port(const uint8 port) {
+	uint8 motor = HOST_getPort(MOTOR_PORT) & HOST_getDdr(MOTOR_PORT) & MOTOR_MASK;
+	uint8 buzzer = (HOST_getPort(BUZZER_PORT) & HOST_getDdr(BUZZER_PORT) & (1 << BUZZER_PIN)) != 0;
+
+	if (port == MOTOR_PORT && motor != g_motor) {
+		g_motor = motor;
+		g_motor_changes++;
+		if (!g_quiet)
+			printf("%10.3f motor  %s\n", HOST_TO_MS(HOST_now()), g_motor_states[motor]);
+	}
+	if (port == BUZZER_PORT && buzzer != g_buzzer) {
+		g_buzzer = buzzer;
+		g_buzzer_changes++;
+		if (!g_quiet)
+			printf("%10.3f buzzer %s\n", HOST_TO_MS(HOST_now()), buzzer ? "on" : "off");
+	}
+}
+
+static void control_tx(const uint8 data) {
+	if (g_capture != NULL_PTR)
+		fputc(data, g_capture);
+	if (FRAMES_decode(&g_tx, data)) {
+		g_frames_tx++;
+		if (!g_quiet) {
+			printf("%10.3f tx     ", HOST_TO_MS(HOST_now()));
+			FRAMES_print(stdout, &g_tx.frame);
+			printf("\n");
+		}
+	}
+}
+
+/* Count the frames received from the other runner (they are printed by it) */
+static void control_linkRx(const uint8 data) {
+	if (FRAMES_decode(&g_rx, data))
+		g_frames_rx++;
+}
+
+static void control_rx(const char *args) {
+	uint8 bytes[256];
+	uint8 count = SCRIPT_parseBytes(args, bytes, 255);
+	uint8 i;
+
+	if (!g_quiet)
+		printf("%10.3f rx     %s\n", HOST_TO_MS(HOST_now()), args);
+	for (i = 0; i < count; i++)
+		HOST_uartReceive(bytes[i]);
+}
+
+static void control_frame(const char *args) {
+	PROTOCOL_Frame frame;
+
+	if (!FRAMES_receive(args, &frame)) {
+		fprintf(stderr, "frame: cmd and seq expected\n");
+		return;
+	}
+	g_frames_rx++;
+	if (!g_quiet) {
+		printf("%10.3f rx     ", HOST_TO_MS(HOST_now()));
+		FRAMES_print(stdout, &frame);
+		printf("\n");
+	}
+}
+
+static void control_end(void) {
+	const M24CXX_Stats *eeprom = M24CXX_getStats();
+
+	if (g_eeprom != NULL_PTR)
+		M24CXX_save(g_eeprom);
+	HOST_report(stdout);
+	printf("frames_tx: %lu\n", (unsigned long)g_frames_tx);
+	printf("frames_rx: %lu\n", (unsigned long)g_frames_rx);
+	printf("motor_changes: %lu\n", (unsigned long)g_motor_changes);
+	printf("buzzer_changes: %lu\n", (unsigned long)g_buzzer_changes);
+	printf("eeprom_write_cycles: %lu\n", (unsigned long)eeprom->write_cycles);
+	printf("eeprom_bytes_written: %lu\n", (unsigned long)eeprom->bytes_written);
+	printf("eeprom_bytes_read: %lu\n", (unsigned long)eeprom->bytes_read);
+	printf("eeprom_busy_nacks: %lu\n", (unsigned long)eeprom->busy_nacks);
+	printf("eeprom_aborted_writes: %lu\n", (unsigned long)eeprom->aborted_writes);
+}
@@ -0,0 +1,324 @@
+/* Host build: co-simulation of the two boards (the HMI and Control runners linked by their UART line) */
+
+/* Usage: cosim [-t time limit ms] [-e eeprom image] [-q] <session script>
+ * runs hmi_host with the session script (keypad input, see hmi_host.c) and control_host, both from
+ * the directory of cosim, in lockstep with their UART lines linked (see link.h)
+ * Output: the lines of both runners merged in time order (the board follows the time), the session
+ * metrics, then the counters of both runners ("hmi_" OR "control_" prefixed "name: value" lines)
+ *   unlock_latency_ms		last key press -> motor on (door opening), mean and max of the session
+ *   alarm_latency_ms		last key press -> buzzer on (theft alert)
+ *   session_ms				first key press -> last change of the LCD, motor OR buzzer
+ * -q prints the session metrics and the counters only
+ */
+
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "std_types.h"
+
+
+/* Co-simulation configurations */
+#define LINES_MAX 100000			/* max output lines of a runner */
+#define LINE_SIZE 256
+#define PATH_SIZE 1024
+
+typedef struct {
+	const char *name;				/* board name in the merged lines */
+	const char *prefix;				/* prefix of its counters */
+	char **lines;
+	uint32 count;
+	char partial[LINE_SIZE];		/* line being read */
+	uint32 length;
+	int fd;							/* stdout of the runner, -1 once closed */
+	pid_t pid;
+} COSIM_Board;
+
+typedef struct {
+	uint32 count;
+	double sum_ms;
+	double max_ms;
+} COSIM_Latency;
+
+
+static bool cosim_start(COSIM_Board * const board, char * const argv[], const int link_in, const int link_out,
+	const int close_fds[], const uint8 close_count);
+static void cosim_read(COSIM_Board * const board);
+static void cosim_store(COSIM_Board * const board);
+static bool cosim_time(const char * const line, double * const ms);
+static void cosim_event(const COSIM_Board * const board, const char * const line, const double ms);
+static void cosim_latency(COSIM_Latency * const latency, const char * const name, const double ms);
+static void cosim_report(const char * const name, const COSIM_Latency * const latency);
+
+
+/* Global session metrics */
+static bool g_quiet = FALSE;
+static double g_first_key = -1;
+static double g_last_key = -1;
+static double g_last_change = -1;
+static bool g_motor_on = FALSE;
+static COSIM_Latency g_unlocks;
+static COSIM_Latency g_alarms;
+
+
+int main(int argc, char *argv[]) {
+	COSIM_Board hmi = {"hmi", "hmi_"}, control = {"ctl", "control_"};
+	COSIM_Board *boards[2] = {&hmi, &control};
+	char hmi_path[PATH_SIZE], control_path[PATH_SIZE], fds_hmi[32], fds_control[32];
+	char *hmi_argv[8], *control_argv[10];
+	const char *limit = NULL_PTR, *eeprom = NULL_PTR, *slash, *dir = ".";
+	int to_control[2], to_hmi[2], pipes[4];
+	struct pollfd polls[2];
+	uint32 h = 0, c = 0, i;
+	double hmi_ms, control_ms;
+	int option, status, failed = 0, dir_length = 1;
+	uint8 n, k;
+
+	while ((option = getopt(argc, argv, "t:e:q")) != -1) {
+		switch (option) {
+		case 't':
+			limit = optarg;
+			break;
+		case 'e':
+			eeprom = optarg;
+			break;
+		case 'q':
+			g_quiet = TRUE;
+			break;
+		default:
+			optind = argc + 1;
+			break;
+		}
+	}
+	if (optind != argc - 1) {
+		fprintf(stderr, "usage: %s [-t time limit ms] [-e eeprom image] [-q] <session script>\n", argv[0]);
+		return 2;
+	}
+
+	/* the runners are next to cosim */
+	if ((slash = strrchr(argv[0], '/')) != NULL_PTR) {
+		dir = argv[0];
+		dir_length = (int)(slash - argv[0]);
+	}
+	snprintf(hmi_path, sizeof(hmi_path), "%.*s/hmi_host", dir_length, dir);
+	snprintf(control_path, sizeof(control_path), "%.*s/control_host", dir_length, dir);
+
+	if (pipe(to_control) != 0 || pipe(to_hmi) != 0) {
+		perror("pipe");
+		return 2;
+	}
+	pipes[0] = to_control[0];
+	pipes[1] = to_control[1];
+	pipes[2] = to_hmi[0];
+	pipes[3] = to_hmi[1];
+	snprintf(fds_hmi, sizeof(fds_hmi), "%d,%d", to_hmi[0], to_control[1]);
+	snprintf(fds_control, sizeof(fds_control), "%d,%d", to_control[0], to_hmi[1]);
+
+	n = 0;
+	hmi_argv[n++] = hmi_path;
+	hmi_argv[n++] = "-l";
+	hmi_argv[n++] = fds_hmi;
+	if (limit != NULL_PTR) {
+		hmi_argv[n++] = "-t";
+		hmi_argv[n++] = (char *)limit;
+	}
+	hmi_argv[n++] = argv[optind];
+	hmi_argv[n] = NULL_PTR;
+
+	n = 0;
+	control_argv[n++] = control_path;
+	control_argv[n++] = "-l";
+	control_argv[n++] = fds_control;
+	if (limit != NULL_PTR) {
+		control_argv[n++] = "-t";
+		control_argv[n++] = (char *)limit;
+	}
+	if (eeprom != NULL_PTR) {
+		control_argv[n++] = "-e";
+		control_argv[n++] = (char *)eeprom;
+	}
+	control_argv[n++] = "/dev/null";
+	control_argv[n] = NULL_PTR;
+
+	/* each runner keeps its own link ends only: the other end of a pipe closes when its runner ends */
+	if (!cosim_start(&hmi, hmi_argv, to_hmi[0], to_control[1], pipes, 4) ||
+			!cosim_start(&control, control_argv, to_control[0], to_hmi[1], pipes, 4))
+		return 2;
+	for (k = 0; k < 4; k++)
+		close(pipes[k]);
+
+	/* collect the output of both runners */
+	while (hmi.fd >= 0 || control.fd >= 0) {
+		for (k = 0; k < 2; k++) {
+			polls[k].fd = boards[k]->fd;
+			polls[k].events = POLLIN;
+		}
+		if (poll(polls, 2, -1) < 0)
+			continue;
+		for (k = 0; k < 2; k++)
+			if (polls[k].revents != 0)
+				cosim_read(boards[k]);
+	}
+	for (k = 0; k < 2; k++) {
+		waitpid(boards[k]->pid, &status, 0);
+		if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+			fprintf(stderr, "cosim: %s runner failed\n", boards[k]->name);
+			failed = 1;
+		}
+	}
+
+	/* merge the timed lines (each runner prints them in time order) */
+	while (h < hmi.count || c < control.count) {
+		bool hmi_timed = h < hmi.count && cosim_time(hmi.lines[h], &hmi_ms);
+		bool control_timed = c < control.count && cosim_time(control.lines[c], &control_ms);
+
+		if (!hmi_timed && !control_timed)
+			break;
+		if (hmi_timed && (!control_timed || hmi_ms <= control_ms)) {
+			cosim_event(&hmi, hmi.lines[h++], hmi_ms);
+		}
+		else {
+			cosim_event(&control, control.lines[c++], control_ms);
+		}
+	}
+
+	cosim_report("unlock", &g_unlocks);
+	cosim_report("alarm", &g_alarms);
+	printf("session_ms: %.3f\n", (g_first_key >= 0 && g_last_change >= g_first_key) ? g_last_change - g_first_key : 0.0);
+	for (k = 0; k < 2; k++)
+		for (i = (k == 0) ? h : c; i < boards[k]->count; i++)
+			printf("%s%s\n", boards[k]->prefix, boards[k]->lines[i]);
+	return failed;
+}
+
+
+/* Start a runner with its stdout on a pipe (returns FALSE on error) */
+static bool cosim_start(COSIM_Board * const board, char * const argv[], const int link_in, const int link_out,
+		const int close_fds[], const uint8 close_count) {
+	int out[2];
+	uint8 k;
+
+	if (pipe(out) != 0) {
+		perror("pipe");
+		return FALSE;
+	}
+	fflush(NULL);
+	board->pid = fork();
+	if (board->pid < 0) {
+		perror("fork");
+		return FALSE;
+	}
+	if (board->pid == 0) {
+		dup2(out[1], STDOUT_FILENO);
+		close(out[0]);
+		close(out[1]);
+		for (k = 0; k < close_count; k++)
+			if (close_fds[k] != link_in && close_fds[k] != link_out)
+				close(close_fds[k]);
+		execv(argv[0], argv);
+		perror(argv[0]);
+		_exit(2);
+	}
+	close(out[1]);
+	board->fd = out[0];
+	board->lines = malloc(LINES_MAX * sizeof(char *));
+	return board->lines != NULL_PTR;
+}
+
+/* Read the available output of a runner and split it in lines */
+static void cosim_read(COSIM_Board * const board) {
+	char buffer[4096];
+	ssize_t size = read(board->fd, buffer, sizeof(buffer));
+	ssize_t i;
+
+	if (size <= 0) {
+		if (board->length != 0)
+			cosim_store(board);
+		close(board->fd);
+		board->fd = -1;
+		return;
+	}
+	for (i = 0; i < size; i++) {
+		if (buffer[i] == '\n') {
+			cosim_store(board);
+		}
+		else if (board->length < LINE_SIZE - 1) {
+			board->partial[board->length++] = buffer[i];
+		}
+	}
+}
+
+/* End the line being read */
+static void cosim_store(COSIM_Board * const board) {
+	board->partial[board->length] = '\0';
+	board->length = 0;
+	if (board->count < LINES_MAX)
+		board->lines[board->count++] = strdup(board->partial);
+}
+
+/* Get the time of a timed line ("<ms> <kind> ...") */
+static bool cosim_time(const char * const line, double * const ms) {
+	char *end;
+
+	*ms = strtod(line, &end);
+	return end != line && *end == ' ';
+}
+
+/* Print a timed line with its board and update the session metrics */
+static void cosim_event(const COSIM_Board * const board, const char * const line, const double ms) {
+	char kind[16], what[16], state[16];
+	const char *rest;
+
+	for (rest = line; *rest == ' '; rest++);
+	rest = strchr(rest, ' ');
+	if (!g_quiet)
+		printf("%10.3f %s %s\n", ms, board->name, rest + 1);
+
+	kind[0] = what[0] = state[0] = '\0';
+	sscanf(rest, "%15s %15s %15s", kind, what, state);
+	if (strcmp(kind, "key") == 0 && strcmp(state, "down") == 0) {
+		if (g_first_key < 0)
+			g_first_key = ms;
+		g_last_key = ms;
+	}
+	else if (strcmp(kind, "lcd") == 0) {
+		g_last_change = ms;
+	}
+	else if (strcmp(kind, "motor") == 0) {
+		g_last_change = ms;
+		if (strcmp(what, "stop") == 0) {
+			g_motor_on = FALSE;
+		}
+		else if (!g_motor_on) {
+			g_motor_on = TRUE;
+			cosim_latency(&g_unlocks, "unlock", ms);
+		}
+	}
+	else if (strcmp(kind, "buzzer") == 0) {
+		g_last_change = ms;
+		if (strcmp(what, "on") == 0)
+			cosim_latency(&g_alarms, "alarm", ms);
+	}
+}
+
+static void cosim_latency(COSIM_Latency * const latency, const char * const name, const double ms) {
+	double value;
+
+	if (g_last_key < 0)
+		return;
+	value = ms - g_last_key;
+	latency->count++;
+	latency->sum_ms += value;
+	if (value > latency->max_ms)
+		latency->max_ms = value;
+	if (!g_quiet)
+		printf("%10.3f --- %-6s %.3f ms after the last key\n", ms, name, value);
+}
+
+static void cosim_report(const char * const name, const COSIM_Latency * const latency) {
+	printf("%ss: %lu\n", name, (unsigned long)latency->count);
+	printf("%s_latency_ms: %.3f\n", name, latency->count ? latency->sum_ms / latency->count : 0.0);
+	printf("%s_latency_max_ms: %.3f\n", name, latency->max_ms);
+}
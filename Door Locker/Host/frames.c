@@ -0,0 +1,83 @@
+/* Host build: protocol frames seen on the UART line (build and decode, print) */
+
+#include <string.h>
+#include "host.h"
+#include "script.h"
+#include "frames.h"
+
+
+uint8 FRAMES_encode(const PROTOCOL_Frame * const frame, uint8 * const bytes) {
+	bytes[0] = PROTOCOL_SOF;
+	bytes[1] = frame->len;
+	bytes[2] = frame->seq;
+	bytes[3] = frame->cmd;
+	memcpy(&bytes[4], frame->payload, frame->len);
+	bytes[4 + frame->len] = PROTOCOL_crc8(0, &bytes[1], frame->len + 3);
+	return frame->len + 5;
+}
+
+bool FRAMES_decode(FRAMES_Decoder * const decoder, const uint8 data) {
+	PROTOCOL_Frame * const frame = &decoder->frame;
+
+	switch (decoder->count) {
+	case 0:		/* SOF (anything else is noise between frames) */
+		if (data == PROTOCOL_SOF)
+			decoder->count++;
+		return FALSE;
+	case 1:
+		if (data > PROTOCOL_MAX_PAYLOAD) {
+			fprintf(stderr, "frame length %u too long\n", data);
+			decoder->count = 0;
+			return FALSE;
+		}
+		frame->len = data;
+		break;
+	case 2:
+		frame->seq = data;
+		break;
+	case 3:
+		frame->cmd = data;
+		break;
+	default:
+		if (decoder->count < frame->len + 4) {
+			frame->payload[decoder->count - 4] = data;
+			break;
+		}
+		decoder->count = 0;
+		if (data != decoder->crc) {
+			fprintf(stderr, "frame cmd %02X: bad CRC %02X (%02X expected)\n", frame->cmd, data, decoder->crc);
+			return FALSE;
+		}
+		return TRUE;
+	}
+	decoder->crc = PROTOCOL_crc8((decoder->count == 1) ? 0 : decoder->crc, &data, 1);
+	decoder->count++;
+	return FALSE;
+}
+
+bool FRAMES_receive(const char *args, PROTOCOL_Frame * const frame) {
+	uint8 fields[PROTOCOL_MAX_PAYLOAD + 2];
+	uint8 bytes[FRAMES_MAX_SIZE];
+	uint8 count = SCRIPT_parseBytes(args, fields, sizeof(fields));
+	uint8 i;
+
+	if (count < 2)
+		return FALSE;
+	frame->cmd = fields[0];
+	frame->seq = fields[1];
+	frame->len = count - 2;
+	memcpy(frame->payload, &fields[2], frame->len);
+
+	count = FRAMES_encode(frame, bytes);
+	for (i = 0; i < count; i++)
+		HOST_uartReceive(bytes[i]);
+	return TRUE;
+}
+
+void FRAMES_print(FILE * const file, const PROTOCOL_Frame * const frame) {
+	uint8 i;
+
+	fprintf(file, "seq=%02X cmd=%02X", frame->seq, frame->cmd);
+	for (i = 0; i < frame->len; i++)
+		fprintf(file, "%s%02X", (i == 0) ? " payload=" : " ", frame->payload[i]);
+}
@@ -0,0 +1,36 @@
+/* Host build: protocol frames seen on the UART line (build and decode, print) */
+
+#ifndef FRAMES_H_
+#define FRAMES_H_
+
+
+#include <stdio.h>
+#include "std_types.h"
+#include "protocol.h"
+
+
+#define FRAMES_MAX_SIZE (PROTOCOL_MAX_PAYLOAD + 5)	/* SOF, LEN, SEQ, CMD, payload, CRC */
+
+typedef struct {
+	PROTOCOL_Frame frame;
+	uint8 count;			/* bytes of the current frame received so far (0: waiting for SOF) */
+	uint8 crc;
+} FRAMES_Decoder;
+
+
+/* Build the bytes of a frame on the line (returns the number of bytes) */
+uint8 FRAMES_encode(const PROTOCOL_Frame * const frame, uint8 * const bytes);
+
+/* Feed a byte of the line, returns TRUE when decoder->frame holds a complete frame with a good CRC
+ * (bad frames are printed on stderr) */
+bool FRAMES_decode(FRAMES_Decoder * const decoder, const uint8 data);
+
+/* Parse "<cmd> <seq> [payload]" (hex bytes) into frame and queue it on the UART RX line
+ * (returns FALSE if cmd OR seq is missing) */
+bool FRAMES_receive(const char *args, PROTOCOL_Frame * const frame);
+
+/* Print a frame: seq, cmd and payload in hex */
+void FRAMES_print(FILE * const file, const PROTOCOL_Frame * const frame);
+
+
+#endif /* FRAMES_H_ */
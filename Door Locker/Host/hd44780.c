@@ -0,0 +1,168 @@
+/* Host build: model of an HD44780 character LCD (2x16) with an 8-bit bus */
+
+#include <string.h>
+#include "host.h"
+#include "hd44780.h"
+
+
+/* DDRAM addresses of the 2 lines (40 characters each) */
+#define LINE_LENGTH 40
+#define LINE2_START 0x40
+
+
+/* Global wiring */
+static uint8 g_data_port;
+static uint8 g_control_port;
+static uint8 g_rs, g_rw, g_e;
+static bool g_e_high = FALSE;
+
+/* Global LCD state */
+static uint8 g_ddram[2][LINE_LENGTH];
+static uint8 g_ac = 0;					/* address counter */
+static bool g_increment = TRUE;
+static bool g_display_on = FALSE;
+static uint64 g_busy_until;
+
+static void (*g_change_callback)(void) = NULL_PTR;
+static HD44780_Stats g_stats;
+
+
+static void HD44780_execute(const uint8 data, const bool rs);
+static void HD44780_moveAddress(void);
+
+
+void HD44780_init(const uint8 data_port, const uint8 control_port, const uint8 rs, const uint8 rw, const uint8 e) {
+	g_data_port = data_port;
+	g_control_port = control_port;
+	g_rs = rs;
+	g_rw = rw;
+	g_e = e;
+	memset(g_ddram, ' ', sizeof(g_ddram));
+	memset(&g_stats, 0, sizeof(g_stats));
+	g_busy_until = HOST_now() + HOST_MS(HD44780_RESET_MS);
+}
+
+void HD44780_setChangeCallBack(void (*f_ptr)(void)) {
+	g_change_callback = f_ptr;
+}
+
+void HD44780_portWritten(const uint8 port) {
+	uint8 control;
+	bool e;
+
+	if (port != g_control_port)
+		return;
+	control = HOST_getPort(g_control_port) & HOST_getDdr(g_control_port);
+	e = (control >> g_e) & 1;
+
+	/* a write is latched on the falling edge of E */
+	if (g_e_high && !e && !((control >> g_rw) & 1))
+		HD44780_execute(HOST_getPort(g_data_port), (control >> g_rs) & 1);
+	g_e_high = e;
+}
+
+uint8 HD44780_pinLevel(const uint8 port, const uint8 level) {
+	uint8 control = HOST_getPort(g_control_port) & HOST_getDdr(g_control_port);
+	uint8 ddr = HOST_getDdr(g_data_port);
+	uint8 output;
+
+	if (port != g_data_port || !g_e_high || !((control >> g_rw) & 1))
+		return level;
+
+	/* read: busy flag and address counter (RS = 0) OR data (RS = 1) */
+	if ((control >> g_rs) & 1)
+		output = g_ddram[g_ac >= LINE2_START][g_ac % LINE2_START];
+	else {
+		output = ((HOST_now() < g_busy_until) << 7) | g_ac;
+		g_stats.busy_reads++;
+	}
+	return (level & ddr) | (output & ~ddr);
+}
+
+void HD44780_getRow(const uint8 row, char * const text) {
+	uint8 col;
+	for (col = 0; col < HD44780_COLS; col++)
+		text[col] = g_display_on ? g_ddram[row][col] : ' ';
+	text[HD44780_COLS] = '\0';
+}
+
+const HD44780_Stats *HD44780_getStats(void) {
+	return &g_stats;
+}
+
+
+static void HD44780_execute(const uint8 data, const bool rs) {
+	uint32 time = HD44780_EXEC_US;
+	bool changed = FALSE;
+
+	/* the LCD ignores the bus until the instruction in progress is done */
+	if (HOST_now() < g_busy_until) {
+		g_stats.busy_violations++;
+		return;
+	}
+	g_stats.instructions++;
+
+	if (rs) {
+		g_ddram[g_ac >= LINE2_START][g_ac % LINE2_START] = data;
+		HD44780_moveAddress();
+		g_stats.characters++;
+		time = HD44780_WRITE_US;
+		changed = TRUE;
+	}
+	else if (data & 0x80) {
+		/* set DDRAM address: invalid addresses wrap to the other line */
+		g_ac = data & 0x7F;
+		if ((g_ac % LINE2_START) >= LINE_LENGTH)
+			g_ac = (g_ac >= LINE2_START) ? 0 : LINE2_START;
+	}
+	else if (data & 0x40) {
+		/* set CGRAM address: not modelled */
+	}
+	else if (data & 0x20) {
+		/* function set: the model is always 2 lines on an 8-bit bus */
+	}
+	else if (data & 0x10) {
+		/* cursor / display shift: not modelled */
+	}
+	else if (data & 0x08) {
+		changed = (g_display_on != ((data & 0x04) != 0));
+		g_display_on = (data & 0x04) != 0;
+	}
+	else if (data & 0x04) {
+		g_increment = (data & 0x02) != 0;
+	}
+	else if (data & 0x02) {
+		g_ac = 0;
+		time = HD44780_HOME_US;
+	}
+	else if (data & 0x01) {
+		memset(g_ddram, ' ', sizeof(g_ddram));
+		g_ac = 0;
+		g_increment = TRUE;
+		time = HD44780_HOME_US;
+		changed = TRUE;
+	}
+
+	g_busy_until = HOST_now() + HOST_US(time);
+	if (changed && g_change_callback != NULL_PTR)
+		g_change_callback();
+}
+
+/* Move the address counter after a data write (2 line mode: 0x00 -> 0x27 then 0x40 -> 0x67) */
+static void HD44780_moveAddress(void) {
+	uint8 offset = g_ac % LINE2_START;
+	bool line2 = (g_ac >= LINE2_START);
+
+	if (g_increment) {
+		if (offset == LINE_LENGTH - 1)
+			g_ac = line2 ? 0 : LINE2_START;
+		else
+			g_ac++;
+	}
+	else {
+		if (offset == 0)
+			g_ac = (line2 ? 0 : LINE2_START) + LINE_LENGTH - 1;
+		else
+			g_ac--;
+	}
+}
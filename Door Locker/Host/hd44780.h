@@ -0,0 +1,54 @@
+/* Host build: model of an HD44780 character LCD (2x16) with an 8-bit bus */
+
+/* Constraints:
+ * 8-bit data bus on one port, RS / RW / E on another port
+ * an instruction is latched on the falling edge of E, the busy flag and the address counter
+ * are driven on the data port while E is high in a read (RW = 1, RS = 0)
+ * an instruction sent while busy is ignored and counted as a busy violation
+ * no display shift, no CGRAM (user characters)
+ */
+
+
+#ifndef HD44780_H_
+#define HD44780_H_
+
+
+#include "std_types.h"
+
+
+/* Model configurations */
+#define HD44780_ROWS 2
+#define HD44780_COLS 16
+#define HD44780_EXEC_US 37			/* execution time of most instructions */
+#define HD44780_WRITE_US 41			/* execution time of a data write */
+#define HD44780_HOME_US 1520		/* execution time of clear display / return home */
+#define HD44780_RESET_MS 15			/* internal reset after power up (busy) */
+
+typedef struct {
+	uint32 instructions;			/* instructions executed (commands + data) */
+	uint32 characters;				/* data writes */
+	uint32 busy_reads;				/* busy flag reads */
+	uint32 busy_violations;			/* instructions sent while busy (ignored) */
+} HD44780_Stats;
+
+
+/* Reset the LCD: data port, control port and the RS / RW / E pins (port is 'A' -> 'D') */
+void HD44780_init(const uint8 data_port, const uint8 control_port, const uint8 rs, const uint8 rw, const uint8 e);
+
+/* Set the function called each time the displayed text changes */
+void HD44780_setChangeCallBack(void (*f_ptr)(void));
+
+/* Called from the port hook when the firmware wrote a port */
+void HD44780_portWritten(const uint8 port);
+
+/* Called from the pin hook: level of the data port pins driven by the LCD */
+uint8 HD44780_pinLevel(const uint8 port, const uint8 level);
+
+/* Get the text of a row (HD44780_COLS characters, blank while the display is off) */
+void HD44780_getRow(const uint8 row, char * const text);
+
+/* Get the counters of the model */
+const HD44780_Stats *HD44780_getStats(void);
+
+
+#endif /* HD44780_H_ */
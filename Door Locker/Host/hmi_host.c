@@ -0,0 +1,290 @@
+/* Host build: runner of the HMI firmware (LCD, keypad and UART line driven by a script) */
+
+/* Usage: hmi_host [-t time limit ms] [-l in,out] [-w capture] [-q] [script]   (the script is read from stdin by default)
+ * -l links the UART line to the other runner through two file descriptors (see link.h, cosim.c)
+ * -w writes the bytes sent on the UART line to a file (binary, e.g. a trace dump for tracedump)
+ * Script commands (see script.h for the line format):
+ *   press <key> / release <key>	press OR release a keypad key ('0' -> '9', '*', '#')
+ *   keys <keys>					type keys one after the other (KEY_HOLD_MS pressed, KEY_GAP_MS released)
+ *   rx <hex bytes>					bytes received on the UART line
+ *   frame <cmd> <seq> [payload]	frame received on the UART line (hex, the CRC is added)
+ *   screen							print the LCD now
+ * Output: one line per LCD change (once it is stable for LCD_SETTLE_MS), key and UART frame,
+ * prefixed with the simulated time in ms, then the counters of the run ("name: value" lines).
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "host.h"
+#include "hd44780.h"
+#include "keymatrix.h"
+#include "frames.h"
+#include "script.h"
+#include "link.h"
+
+
+/* Board wiring (lcd.h, keypad.h) */
+#define LCD_DATA_PORT 'C'
+#define LCD_CTRL_PORT 'A'
+#define LCD_RS 2
+#define LCD_RW 1
+#define LCD_E 0
+#define KEYPAD_PORT 'B'
+
+/* Runner configurations */
+#define KEY_HOLD_MS 80				/* time a typed key is held (more than the keypad debounce) */
+#define KEY_GAP_MS 80				/* time between two typed keys */
+#define LCD_SETTLE_MS 5				/* the LCD is printed once it didn't change for this time */
+#define TIME_LIMIT_MS 60000			/* default time limit */
+
+
+/* Firmware main (HMI.c is compiled with -Dmain=firmware_main) */
+int firmware_main(void);
+
+static void hmi_port(const uint8 port);
+static uint8 hmi_pin(const uint8 port, const uint8 level);
+static void hmi_tx(const uint8 data);
+static void hmi_linkRx(const uint8 data);
+static void hmi_lcdChanged(void);
+static void hmi_lcdSettled(void *arg);
+static void hmi_printScreen(const bool force);
+static void hmi_keyDown(void *arg);
+static void hmi_keyUp(void *arg);
+static void hmi_press(const char *args);
+static void hmi_release(const char *args);
+static void hmi_keys(const char *args);
+static void hmi_rx(const char *args);
+static void hmi_frame(const char *args);
+static void hmi_screen(const char *args);
+static void hmi_end(void);
+
+
+static const SCRIPT_Command g_commands[] = {
+	{"press", hmi_press},
+	{"release", hmi_release},
+	{"keys", hmi_keys},
+	{"rx", hmi_rx},
+	{"frame", hmi_frame},
+	{"screen", hmi_screen},
+	{NULL_PTR, NULL_PTR}
+};
+
+/* Global state of the runner */
+static bool g_quiet = FALSE;
+static FILE *g_capture = NULL_PTR;
+static FRAMES_Decoder g_tx;
+static FRAMES_Decoder g_rx;
+static uint64 g_lcd_changed = 0;
+static bool g_lcd_pending = FALSE;
+static char g_screen[HD44780_ROWS][HD44780_COLS + 1];
+static uint32 g_keys = 0;
+static uint32 g_frames_tx = 0;
+static uint32 g_frames_rx = 0;
+
+
+int main(int argc, char *argv[]) {
+	FILE *script = stdin;
+	uint64 limit = HOST_MS(TIME_LIMIT_MS);
+	const char *peer = NULL_PTR;
+	int option;
+
+	while ((option = getopt(argc, argv, "t:l:w:q")) != -1) {
+		switch (option) {
+		case 't':
+			limit = HOST_MS(strtoul(optarg, NULL, 10));
+			break;
+		case 'l':
+			peer = optarg;
+			break;
+		case 'w':
+			if ((g_capture = fopen(optarg, "wb")) == NULL) {
+				perror(optarg);
+				return 2;
+			}
+			break;
+		case 'q':
+			g_quiet = TRUE;
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-t time limit ms] [-l in,out] [-w capture] [-q] [script]\n", argv[0]);
+			return 2;
+		}
+	}
+	if (optind < argc && (script = fopen(argv[optind], "r")) == NULL) {
+		perror(argv[optind]);
+		return 2;
+	}
+
+	HOST_init();
+	HD44780_init(LCD_DATA_PORT, LCD_CTRL_PORT, LCD_RS, LCD_RW, LCD_E);
+	HD44780_setChangeCallBack(hmi_lcdChanged);
+	KEYMATRIX_init(KEYPAD_PORT);
+	HOST_setPortHook(hmi_port);
+	HOST_setPinHook(hmi_pin);
+	HOST_setUartTxHook(hmi_tx);
+	HOST_setTimeLimit(limit, hmi_end);
+
+	if (peer != NULL_PTR && !LINK_init(peer, hmi_linkRx)) {
+		fprintf(stderr, "-l: two file descriptors expected (in,out)\n");
+		return 2;
+	}
+	if (!SCRIPT_load(script, g_commands))
+		return 2;
+	SCRIPT_start();
+
+	firmware_main();
+	HOST_finish();
+	return 0;
+}
+
+
+static void hmi_port(const uint8 port) {
+	HD44780_portWritten(port);
+}
+
+static uint8 hmi_pin(const uint8 port, const uint8 level) {
+	return KEYMATRIX_pinLevel(port, HD44780_pinLevel(port, level));
+}
+
+static void hmi_tx(const uint8 data) {
+	if (g_capture != NULL_PTR)
+		fputc(data, g_capture);
+	if (FRAMES_decode(&g_tx, data)) {
+		g_frames_tx++;
+		if (!g_quiet) {
+			printf("%10.3f tx     ", HOST_TO_MS(HOST_now()));
+			FRAMES_print(stdout, &g_tx.frame);
+			printf("\n");
+		}
+	}
+}
+
+/* Count the frames received from the other runner (they are printed by it) */
+static void hmi_linkRx(const uint8 data) {
+	if (FRAMES_decode(&g_rx, data))
+		g_frames_rx++;
+}
+
+static void hmi_lcdChanged(void) {
+	g_lcd_changed = HOST_now();
+	if (!g_lcd_pending) {
+		g_lcd_pending = TRUE;
+		HOST_schedule(g_lcd_changed + HOST_MS(LCD_SETTLE_MS), hmi_lcdSettled, NULL_PTR);
+	}
+}
+
+static void hmi_lcdSettled(void *arg) {
+	(void)arg;
+	if (HOST_now() < g_lcd_changed + HOST_MS(LCD_SETTLE_MS)) {
+		HOST_schedule(g_lcd_changed + HOST_MS(LCD_SETTLE_MS), hmi_lcdSettled, NULL_PTR);
+		return;
+	}
+	g_lcd_pending = FALSE;
+	hmi_printScreen(FALSE);
+}
+
+/* Print the LCD rows if they changed since the last print (OR force) */
+static void hmi_printScreen(const bool force) {
+	char row[HD44780_COLS + 1];
+	bool changed = FALSE;
+	uint8 i;
+
+	for (i = 0; i < HD44780_ROWS; i++) {
+		HD44780_getRow(i, row);
+		if (strcmp(row, g_screen[i]) != 0) {
+			strcpy(g_screen[i], row);
+			changed = TRUE;
+		}
+	}
+	if ((changed || force) && !g_quiet) {
+		printf("%10.3f lcd    ", HOST_TO_MS(HOST_now()));
+		for (i = 0; i < HD44780_ROWS; i++)
+			printf("|%s", g_screen[i]);
+		printf("|\n");
+	}
+}
+
+static void hmi_keyDown(void *arg) {
+	const char key = (char)(intptr_t)arg;
+
+	if (!KEYMATRIX_press(key)) {
+		fprintf(stderr, "no key '%c'\n", key);
+		return;
+	}
+	g_keys++;
+	if (!g_quiet)
+		printf("%10.3f key    %c down\n", HOST_TO_MS(HOST_now()), key);
+}
+
+static void hmi_keyUp(void *arg) {
+	const char key = (char)(intptr_t)arg;
+
+	if (KEYMATRIX_release(key) && !g_quiet)
+		printf("%10.3f key    %c up\n", HOST_TO_MS(HOST_now()), key);
+}
+
+static void hmi_press(const char *args) {
+	hmi_keyDown((void *)(intptr_t)args[0]);
+}
+
+static void hmi_release(const char *args) {
+	hmi_keyUp((void *)(intptr_t)args[0]);
+}
+
+static void hmi_keys(const char *args) {
+	uint64 when = HOST_now();
+
+	for (; *args != '\0'; args++) {
+		if (*args == ' ')
+			continue;
+		HOST_schedule(when, hmi_keyDown, (void *)(intptr_t)*args);
+		HOST_schedule(when + HOST_MS(KEY_HOLD_MS), hmi_keyUp, (void *)(intptr_t)*args);
+		when += HOST_MS(KEY_HOLD_MS + KEY_GAP_MS);
+	}
+}
+
+static void hmi_rx(const char *args) {
+	uint8 bytes[256];
+	uint8 count = SCRIPT_parseBytes(args, bytes, 255);
+	uint8 i;
+
+	if (!g_quiet)
+		printf("%10.3f rx     %s\n", HOST_TO_MS(HOST_now()), args);
+	for (i = 0; i < count; i++)
+		HOST_uartReceive(bytes[i]);
+}
+
+static void hmi_frame(const char *args) {
+	PROTOCOL_Frame frame;
+
+	if (!FRAMES_receive(args, &frame)) {
+		fprintf(stderr, "frame: cmd and seq expected\n");
+		return;
+	}
+	g_frames_rx++;
+	if (!g_quiet) {
+		printf("%10.3f rx     ", HOST_TO_MS(HOST_now()));
+		FRAMES_print(stdout, &frame);
+		printf("\n");
+	}
+}
+
+static void hmi_screen(const char *args) {
+	(void)args;
+	hmi_printScreen(TRUE);
+}
+
+static void hmi_end(void) {
+	const HD44780_Stats *lcd = HD44780_getStats();
+
+	hmi_printScreen(FALSE);
+	HOST_report(stdout);
+	printf("keys: %lu\n", (unsigned long)g_keys);
+	printf("frames_tx: %lu\n", (unsigned long)g_frames_tx);
+	printf("frames_rx: %lu\n", (unsigned long)g_frames_rx);
+	printf("lcd_instructions: %lu\n", (unsigned long)lcd->instructions);
+	printf("lcd_characters: %lu\n", (unsigned long)lcd->characters);
+	printf("lcd_busy_reads: %lu\n", (unsigned long)lcd->busy_reads);
+	printf("lcd_busy_violations: %lu\n", (unsigned long)lcd->busy_violations);
+}
@@ -0,0 +1,1110 @@
+/* Host build: register level mock of the Atmega16 (time, interrupts, TIMERS, UART and TWI) */
+
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <time.h>
+#include <avr/io.h>
+#include "host.h"
+
+
+/* Data memory addresses of the registers handled by the mock
+ * (the names in avr/io.h access the registers through HOST_io8 / HOST_io16) */
+#define A_TWBR		0x20
+#define A_TWSR		0x21
+#define A_TWDR		0x23
+#define A_UBRRL		0x29
+#define A_UCSRB		0x2A
+#define A_UCSRA		0x2B
+#define A_UDR		0x2C
+#define A_PIND		0x30
+#define A_PORTA		0x3B
+#define A_UBRRH		0x40
+#define A_OCR2		0x43
+#define A_TCNT2		0x44
+#define A_TCCR2		0x45
+#define A_ICR1		0x46
+#define A_OCR1B		0x48
+#define A_OCR1A		0x4A
+#define A_TCNT1		0x4C
+#define A_TCCR1B	0x4E
+#define A_TCCR1A	0x4F
+#define A_TCNT0		0x52
+#define A_TCCR0		0x53
+#define A_MCUCR		0x55
+#define A_TWCR		0x56
+#define A_TIFR		0x58
+#define A_TIMSK		0x59
+#define A_OCR0		0x5C
+#define A_SREG		0x5F
+
+#define IO_FIRST	0x20
+#define IO_SIZE		0x60
+#define NEVER		UINT64_MAX
+
+/* PINx, DDRx then PORTx of each port, port A at the highest addresses */
+#define PORT_BASE(port) (0x39 - 3 * ((port) - 'A'))
+
+/* Vectors with a flag handled by the mock */
+#define VECTOR_TIMER2_COMP	3
+#define VECTOR_TIMER2_OVF	4
+#define VECTOR_TIMER1_COMPA	6
+#define VECTOR_TIMER1_COMPB	7
+#define VECTOR_TIMER1_OVF	8
+#define VECTOR_TIMER0_OVF	9
+#define VECTOR_USART_RXC	11
+#define VECTOR_USART_UDRE	12
+#define VECTOR_USART_TXC	13
+#define VECTOR_TWI			17
+#define VECTOR_TIMER0_COMP	19
+#define VECTORS				21
+
+/* TWCR bit 1 is reserved (reads as 0 on the device): the mock sets it in the value the firmware
+ * reads, so every write (always a constant without it) changes the register and is seen */
+#define TWCR_MARKER		(1 << 1)
+#define TWCR_CONTROL	((1 << TWEA) | (1 << TWSTA) | (1 << TWSTO) | (1 << TWEN) | (1 << TWIE))
+
+/* Depth of the AVR USART receive buffer (UDR + one waiting byte) */
+#define RX_FIFO_SIZE 2
+#define RX_LINE_SIZE 256
+
+
+/* TWI operations in progress */
+typedef enum {
+	TWI_NONE, TWI_START, TWI_ADDRESS, TWI_WRITE, TWI_READ, TWI_STOP
+} TwiOperation;
+
+/* TWI master states */
+typedef enum {
+	TWI_IDLE, TWI_ADDRESSING, TWI_TRANSMITTER, TWI_RECEIVER
+} TwiState;
+
+typedef struct {
+	uint16 count;
+	uint64 last;			/* time of the last update of count */
+} Timer;
+
+typedef struct {
+	uint64 when;
+	void (*f_ptr)(void *arg);
+	void *arg;
+} Event;
+
+
+/* ISRs defined by the firmware (a missing one is a bad interrupt) */
+#define VECTOR(n) extern void __vector_##n(void) __attribute__((weak));
+VECTOR(1) VECTOR(2) VECTOR(3) VECTOR(4) VECTOR(5) VECTOR(6) VECTOR(7) VECTOR(8) VECTOR(9) VECTOR(10)
+VECTOR(11) VECTOR(12) VECTOR(13) VECTOR(14) VECTOR(15) VECTOR(16) VECTOR(17) VECTOR(18) VECTOR(19) VECTOR(20)
+
+static void (* const g_vectors[VECTORS])(void) = {
+	NULL_PTR, __vector_1, __vector_2, __vector_3, __vector_4, __vector_5, __vector_6, __vector_7,
+	__vector_8, __vector_9, __vector_10, __vector_11, __vector_12, __vector_13, __vector_14,
+	__vector_15, __vector_16, __vector_17, __vector_18, __vector_19, __vector_20
+};
+
+
+/* Global register file (16-bit registers are little endian pairs) */
+static union {
+	uint8 bytes[IO_SIZE];
+	uint16 words[IO_SIZE / 2];
+} g_io;
+
+/* Global simulated time in CPU cycles and time limit */
+static uint64 g_now = 0;
+static uint64 g_limit = NEVER;
+static void (*g_limit_hook)(void) = NULL_PTR;
+
+/* Global access in progress: register address (0 if none), width and value before the access */
+static uint8 g_pending = 0;
+static bool g_pending_wide = FALSE;
+static uint16 g_pending_value = 0;
+
+/* Global vector of the ISR running (0 in the main program) */
+static uint8 g_vector = 0;
+
+/* Global nesting of the mock functions (the watchdog doesn't interrupt them) */
+static volatile uint8 g_depth = 0;
+static uint64 g_watchdog_accesses = 0;
+
+/* Global scheduled events sorted by time */
+static Event g_events[HOST_EVENTS];
+static uint8 g_event_count = 0;
+
+/* Global board hooks */
+static void (*g_port_hook)(const uint8 port) = NULL_PTR;
+static uint8 (*g_pin_hook)(const uint8 port, const uint8 level) = NULL_PTR;
+static void (*g_uart_tx_hook)(const uint8 data) = NULL_PTR;
+static void (*g_uart_line_hook)(const uint8 data, const uint64 done) = NULL_PTR;
+
+/* Global timers state */
+static Timer g_timers[3];
+
+/* Global UART state */
+static uint8 g_ubrrh = 0;
+static uint8 g_ucsrc = 0;
+static uint8 g_tx_shift;			/* byte being sent */
+static bool g_tx_busy = FALSE;
+static uint8 g_tx_data;				/* byte waiting in UDR */
+static bool g_tx_full = FALSE;
+static uint64 g_tx_done = NEVER;
+static bool g_txc = FALSE;
+static uint8 g_rx_fifo[RX_FIFO_SIZE];
+static uint8 g_rx_count = 0;
+static bool g_dor = FALSE;
+static uint8 g_rx_line[RX_LINE_SIZE];
+static uint64 g_rx_line_time[RX_LINE_SIZE];		/* time each byte is completely received */
+static uint8 g_rx_line_head = 0;
+static uint8 g_rx_line_tail = 0;
+static uint64 g_rx_next = NEVER;				/* time of the byte at the tail OR NEVER */
+
+/* Global TWI state */
+static const HOST_TwiSlave *g_twi_slaves[HOST_TWI_SLAVES];
+static uint8 g_twi_slave_count = 0;
+static const HOST_TwiSlave *g_twi_selected = NULL_PTR;
+static TwiState g_twi_state = TWI_IDLE;
+static TwiOperation g_twi_operation = TWI_NONE;
+static uint8 g_twi_control = 0;
+static uint8 g_twi_byte;
+static uint8 g_twi_status = 0xF8;
+static bool g_twint = FALSE;
+static uint64 g_twi_done = NEVER;
+
+/* Global counters */
+static HOST_Stats g_stats;
+static bool g_finishing = FALSE;
+
+
+static void HOST_stop(const int code);
+static void HOST_fatal(const char * const message);
+static void HOST_settle(void);
+static void HOST_written(const uint8 address, const uint16 value, const bool changed);
+static void HOST_refresh(const uint8 address);
+static void HOST_advance(const uint64 target);
+static uint64 HOST_nextEvent(void);
+static void HOST_events(void);
+static void HOST_interrupts(void);
+static uint8 HOST_pendingVector(void);
+static void HOST_call(const uint8 vector);
+static void HOST_watchdog(int signal);
+static uint32 TIMER_prescaler(const uint8 n);
+static uint16 TIMER_max(const uint8 n);
+static uint16 TIMER_top(const uint8 n);
+static void TIMER_update(const uint8 n);
+static void TIMER_count(const uint8 n, uint64 ticks);
+static void TIMER_match(const uint8 n, const uint32 from, const uint32 to);
+static uint64 TIMER_distance(const uint8 n, const uint16 target);
+static uint64 TIMER_next(const uint8 n);
+static uint32 UART_frameCycles(void);
+static uint8 UART_dataMask(void);
+static void UART_read(void);
+static void UART_write(const uint8 data);
+static void UART_transmitted(void);
+static void UART_arrived(void);
+static uint32 TWI_bitCycles(void);
+static void TWI_control(const uint8 value);
+static void TWI_done(void);
+
+
+void HOST_init(void) {
+	struct itimerval period;
+
+	memset(&g_io, 0, sizeof(g_io));
+	g_io.bytes[A_UCSRA] = (1 << UDRE);
+	g_io.bytes[A_TWSR] = 0xF8;
+	g_ucsrc = (1 << URSEL) | (1 << UCSZ1) | (1 << UCSZ0);
+	g_now = 0;
+	memset(g_timers, 0, sizeof(g_timers));
+	memset(&g_stats, 0, sizeof(g_stats));
+
+	/* advance the time when the firmware spins on RAM variables set by an ISR */
+	signal(SIGALRM, HOST_watchdog);
+	period.it_interval.tv_sec = 0;
+	period.it_interval.tv_usec = HOST_WATCHDOG_MS * 1000;
+	period.it_value = period.it_interval;
+	setitimer(ITIMER_REAL, &period, NULL);
+}
+
+uint64 HOST_now(void) {
+	return g_now;
+}
+
+void HOST_schedule(const uint64 when, void (*f_ptr)(void *arg), void * const arg) {
+	uint8 i;
+
+	if (g_event_count == HOST_EVENTS)
+		HOST_fatal("too many scheduled events");
+
+	/* keep the events sorted, events at the same time run in the order they were scheduled */
+	for (i = g_event_count; i > 0 && g_events[i - 1].when > when; i--)
+		g_events[i] = g_events[i - 1];
+	g_events[i].when = when;
+	g_events[i].f_ptr = f_ptr;
+	g_events[i].arg = arg;
+	g_event_count++;
+}
+
+void HOST_setTimeLimit(const uint64 limit, void (*f_ptr)(void)) {
+	g_limit = limit;
+	g_limit_hook = f_ptr;
+}
+
+void HOST_finish(void) {
+	HOST_stop(0);
+}
+
+void HOST_setPortHook(void (*f_ptr)(const uint8 port)) {
+	g_port_hook = f_ptr;
+}
+
+void HOST_setPinHook(uint8 (*f_ptr)(const uint8 port, const uint8 level)) {
+	g_pin_hook = f_ptr;
+}
+
+uint8 HOST_getPort(const uint8 port) {
+	return g_io.bytes[PORT_BASE(port) + 2];
+}
+
+uint8 HOST_getDdr(const uint8 port) {
+	return g_io.bytes[PORT_BASE(port) + 1];
+}
+
+void HOST_setUartTxHook(void (*f_ptr)(const uint8 data)) {
+	g_uart_tx_hook = f_ptr;
+}
+
+void HOST_setUartLineHook(void (*f_ptr)(const uint8 data, const uint64 done)) {
+	g_uart_line_hook = f_ptr;
+}
+
+void HOST_uartReceive(const uint8 data) {
+	/* the line was idle: the byte is received one frame time from now */
+	if (g_rx_next == NEVER)
+		HOST_uartReceiveAt(data, g_now + UART_frameCycles());
+	else
+		HOST_uartReceiveAt(data, 0);
+}
+
+void HOST_uartReceiveAt(const uint8 data, const uint64 when) {
+	uint8 next = (uint8)(g_rx_line_head + 1);
+	uint64 at = when;
+
+	if (next == g_rx_line_tail)
+		HOST_fatal("UART RX line buffer is full");
+	if (g_rx_next != NEVER && at < g_rx_line_time[(uint8)(g_rx_line_head - 1)] + UART_frameCycles())
+		at = g_rx_line_time[(uint8)(g_rx_line_head - 1)] + UART_frameCycles();
+	else if (at < g_now)
+		HOST_fatal("UART byte received in the past");
+	g_rx_line[g_rx_line_head] = data;
+	g_rx_line_time[g_rx_line_head] = at;
+	g_rx_line_head = next;
+
+	if (g_rx_next == NEVER)
+		g_rx_next = at;
+}
+
+void HOST_attachTwiSlave(const HOST_TwiSlave * const slave) {
+	if (g_twi_slave_count == HOST_TWI_SLAVES)
+		HOST_fatal("too many TWI slaves");
+	g_twi_slaves[g_twi_slave_count++] = slave;
+}
+
+const HOST_Stats *HOST_getStats(void) {
+	return &g_stats;
+}
+
+void HOST_report(FILE * const file) {
+	struct timespec cpu;
+	double host_ms;
+	double sim_ms = HOST_TO_MS(g_now);
+
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &cpu);
+	host_ms = cpu.tv_sec * 1000.0 + cpu.tv_nsec / 1000000.0;
+
+	fprintf(file, "sim_time_ms: %.3f\n", sim_ms);
+	fprintf(file, "host_cpu_ms: %.3f\n", host_ms);
+	fprintf(file, "speed: %.1f\n", host_ms > 0 ? sim_ms / host_ms : 0.0);
+	fprintf(file, "cpu_cycles: %llu\n", (unsigned long long)g_now);
+	fprintf(file, "cpu_busy_percent: %.2f\n", g_now ? 100.0 * (g_now - g_stats.sleep_cycles) / g_now : 0.0);
+	fprintf(file, "register_accesses: %llu\n", (unsigned long long)g_stats.accesses);
+	fprintf(file, "interrupts: %llu\n", (unsigned long long)g_stats.interrupts);
+	fprintf(file, "watchdog_advances: %llu\n", (unsigned long long)g_stats.watchdog_advances);
+	fprintf(file, "uart_tx_bytes: %lu\n", (unsigned long)g_stats.uart_tx_bytes);
+	fprintf(file, "uart_rx_bytes: %lu\n", (unsigned long)g_stats.uart_rx_bytes);
+	fprintf(file, "uart_rx_overruns: %lu\n", (unsigned long)g_stats.uart_rx_overruns);
+	fprintf(file, "twi_bytes: %lu\n", (unsigned long)g_stats.twi_bytes);
+}
+
+
+volatile uint8_t *HOST_io8(const uint8_t address) {
+	if (address < IO_FIRST || address >= IO_SIZE)
+		HOST_fatal("access to an unknown register");
+
+	g_depth++;
+	HOST_settle();
+	g_stats.accesses++;
+	HOST_advance(g_now + HOST_ACCESS_CYCLES);
+	HOST_refresh(address);
+	g_pending = address;
+	g_pending_wide = FALSE;
+	g_pending_value = g_io.bytes[address];
+	g_depth--;
+	return &g_io.bytes[address];
+}
+
+volatile uint16_t *HOST_io16(const uint8_t address) {
+	if (address < IO_FIRST || address >= IO_SIZE || (address & 1))
+		HOST_fatal("access to an unknown register");
+
+	g_depth++;
+	HOST_settle();
+	g_stats.accesses++;
+	/* two 8-bit accesses on the device */
+	HOST_advance(g_now + 2 * HOST_ACCESS_CYCLES);
+	HOST_refresh(address);
+	g_pending = address;
+	g_pending_wide = TRUE;
+	g_pending_value = g_io.words[address / 2];
+	g_depth--;
+	return &g_io.words[address / 2];
+}
+
+void HOST_sei(void) {
+	g_depth++;
+	HOST_settle();
+	/* the interrupts are served from the next access, delay OR sleep */
+	g_io.bytes[A_SREG] |= (1 << SREG_I);
+	g_now++;
+	g_depth--;
+}
+
+void HOST_cli(void) {
+	g_depth++;
+	HOST_settle();
+	g_io.bytes[A_SREG] &= ~(1 << SREG_I);
+	g_now++;
+	g_depth--;
+}
+
+void HOST_delayCycles(const uint32_t cycles) {
+	g_depth++;
+	HOST_settle();
+	HOST_advance(g_now + cycles);
+	g_depth--;
+}
+
+void HOST_sleep(void) {
+	uint64 start, when, interrupts;
+
+	g_depth++;
+	HOST_settle();
+	if (!(g_io.bytes[A_MCUCR] & (1 << SE))) {
+		g_now++;
+		g_depth--;
+		return;
+	}
+
+	/* sleep until an interrupt is served (at once if one is pending) */
+	start = g_now;
+	interrupts = g_stats.interrupts;
+	HOST_advance(g_now + 1);
+	while (g_stats.interrupts == interrupts) {
+		if (!(g_io.bytes[A_SREG] & (1 << SREG_I)))
+			HOST_fatal("sleeping with the global interrupts disabled");
+		when = HOST_nextEvent();
+		if (when == NEVER)
+			HOST_fatal("sleeping with no interrupt left to wake up");
+		HOST_advance(when);
+	}
+	g_stats.sleep_cycles += g_now - start;
+	g_depth--;
+}
+
+/* avr-libc extensions of stdlib used by the firmware */
+char *itoa(int value, char *str, int radix) {
+	/* only radix 10 has a sign */
+	if (radix == 10 && value < 0) {
+		str[0] = '-';
+		ultoa(-(unsigned int)value, &str[1], radix);
+		return str;
+	}
+	return ultoa((unsigned int)value, str, radix);
+}
+
+char *ultoa(unsigned long value, char *str, int radix) {
+	char digits[8 * sizeof(long)];
+	uint8 i = 0, j = 0;
+
+	do {
+		uint8 digit = value % radix;
+		digits[i++] = (digit < 10) ? '0' + digit : 'a' + digit - 10;
+		value /= radix;
+	} while (value != 0);
+
+	while (i != 0)
+		str[j++] = digits[--i];
+	str[j] = '\0';
+	return str;
+}
+
+
+static void HOST_stop(const int code) {
+	/* the time limit function may access registers OR finish again */
+	if (!g_finishing) {
+		g_finishing = TRUE;
+		HOST_settle();
+		if (g_limit_hook != NULL_PTR)
+			g_limit_hook();
+	}
+	fflush(NULL);
+	exit(code);
+}
+
+static void HOST_fatal(const char * const message) {
+	fprintf(stderr, "host: %.3f ms: %s\n", HOST_TO_MS(g_now), message);
+	HOST_stop(2);
+}
+
+/* Let the peripherals see the register access in progress (the firmware may have written it) */
+static void HOST_settle(void) {
+	uint8 address = g_pending;
+	uint16 value;
+
+	if (address == 0)
+		return;
+	g_pending = 0;
+	value = g_pending_wide ? g_io.words[address / 2] : g_io.bytes[address];
+	HOST_written(address, value, value != g_pending_value);
+}
+
+/* Apply a register access: changed is TRUE if the firmware wrote a new value */
+static void HOST_written(const uint8 address, const uint16 value, const bool changed) {
+	uint8 port;
+
+	/* UDR is the only register where reading and writing the same value differ */
+	if (address == A_UDR) {
+		if (g_vector == VECTOR_USART_RXC ||
+			(g_vector != VECTOR_USART_UDRE && !changed && g_rx_count != 0))
+			UART_read();
+		else
+			UART_write((uint8)value);
+		return;
+	}
+	if (!changed)
+		return;
+
+	switch (address) {
+		case A_TWCR:
+			TWI_control((uint8)value & ~TWCR_MARKER);
+			break;
+
+		case A_UCSRA:
+			/* TXC is cleared by writing a one to it */
+			if (value & (1 << TXC))
+				g_txc = FALSE;
+			break;
+
+		case A_UBRRH:
+			/* UCSRC and UBRRH share the address, URSEL selects the register written */
+			if (value & (1 << URSEL))
+				g_ucsrc = (uint8)value;
+			else
+				g_ubrrh = (uint8)value;
+			break;
+
+		case A_TIFR:
+			/* the flags are cleared by writing a one to them */
+			g_io.bytes[A_TIFR] = (uint8)(g_pending_value & ~value);
+			break;
+
+		case A_TCNT0:	g_timers[0].count = (uint8)value;		break;
+		case A_TCNT1:	g_timers[1].count = value;				break;
+		case A_TCNT2:	g_timers[2].count = (uint8)value;		break;
+
+		/* force output compare bits are strobes, they read as zero */
+		case A_TCCR0:	g_io.bytes[A_TCCR0] &= ~(1 << FOC0);	break;
+		case A_TCCR2:	g_io.bytes[A_TCCR2] &= ~(1 << FOC2);	break;
+		case A_TCCR1A:	g_io.bytes[A_TCCR1A] &= ~((1 << FOC1A) | (1 << FOC1B));		break;
+
+		default:
+			/* DDRx OR PORTx of a port */
+			if (address >= A_PIND && address <= A_PORTA && (address - A_PIND) % 3 != 0) {
+				port = 'A' + (A_PORTA - address) / 3;
+				if (g_port_hook != NULL_PTR)
+					g_port_hook(port);
+			}
+			break;
+	}
+}
+
+/* Update the register read by the access that begins */
+static void HOST_refresh(const uint8 address) {
+	uint8 port, ddr, level;
+
+	switch (address) {
+		case A_TCNT0:
+		case A_TCCR0:
+		case A_OCR0:
+			TIMER_update(0);
+			g_io.bytes[A_TCNT0] = (uint8)g_timers[0].count;
+			break;
+
+		case A_TCNT1:
+		case A_TCCR1A:
+		case A_TCCR1B:
+		case A_OCR1A:
+		case A_OCR1B:
+		case A_ICR1:
+			TIMER_update(1);
+			g_io.words[A_TCNT1 / 2] = g_timers[1].count;
+			break;
+
+		case A_TCNT2:
+		case A_TCCR2:
+		case A_OCR2:
+			TIMER_update(2);
+			g_io.bytes[A_TCNT2] = (uint8)g_timers[2].count;
+			break;
+
+		case A_TIFR:
+			TIMER_update(0);
+			TIMER_update(1);
+			TIMER_update(2);
+			break;
+
+		case A_UCSRA:
+			g_io.bytes[A_UCSRA] = (g_io.bytes[A_UCSRA] & ((1 << U2X) | (1 << MPCM))) |
+				((g_rx_count != 0) << RXC) | (g_txc << TXC) | (!g_tx_full << UDRE) | (g_dor << DOR);
+			break;
+
+		case A_UDR:
+			if (g_rx_count != 0)
+				g_io.bytes[A_UDR] = g_rx_fifo[0];
+			break;
+
+		case A_UBRRH:
+			/* a single read returns UBRRH (UCSRC needs two reads in a row) */
+			g_io.bytes[A_UBRRH] = g_ubrrh;
+			break;
+
+		case A_TWCR:
+			g_io.bytes[A_TWCR] = g_twi_control | (g_twint << TWINT) | TWCR_MARKER;
+			break;
+
+		case A_TWSR:
+			g_io.bytes[A_TWSR] = g_twi_status | (g_io.bytes[A_TWSR] & ((1 << TWPS1) | (1 << TWPS0)));
+			break;
+
+		default:
+			/* PINx of a port: driven outputs, inputs pulled up then the board models */
+			if (address >= A_PIND && address <= A_PORTA && (address - A_PIND) % 3 == 0) {
+				port = 'A' + (A_PORTA - address) / 3;
+				ddr = g_io.bytes[address + 1];
+				level = (g_io.bytes[address + 2] & ddr) | (uint8)~ddr;
+				if (g_pin_hook != NULL_PTR)
+					level = g_pin_hook(port, level);
+				g_io.bytes[address] = level;
+			}
+			break;
+	}
+}
+
+/* Run the peripherals until target, serving the interrupts on the way */
+static void HOST_advance(const uint64 target) {
+	uint64 when;
+
+	HOST_interrupts();
+	while ((when = HOST_nextEvent()) <= target) {
+		if (when > g_now)
+			g_now = when;
+		HOST_events();
+		HOST_interrupts();
+	}
+	if (target > g_now)
+		g_now = target;
+}
+
+static uint64 HOST_nextEvent(void) {
+	uint64 next = g_limit;
+	uint64 when;
+	uint8 n;
+
+	for (n = 0; n < 3; n++)
+		if ((when = TIMER_next(n)) < next)
+			next = when;
+	if (g_tx_done < next)
+		next = g_tx_done;
+	if (g_rx_next < next)
+		next = g_rx_next;
+	if (g_twi_done < next)
+		next = g_twi_done;
+	if (g_event_count != 0 && g_events[0].when < next)
+		next = g_events[0].when;
+	return next;
+}
+
+/* Run the peripheral events due now */
+static void HOST_events(void) {
+	Event event;
+
+	TIMER_update(0);
+	TIMER_update(1);
+	TIMER_update(2);
+	if (g_tx_done <= g_now)
+		UART_transmitted();
+	if (g_rx_next <= g_now)
+		UART_arrived();
+	if (g_twi_done <= g_now)
+		TWI_done();
+
+	while (g_event_count != 0 && g_events[0].when <= g_now) {
+		event = g_events[0];
+		g_event_count--;
+		memmove(&g_events[0], &g_events[1], g_event_count * sizeof(Event));
+		event.f_ptr(event.arg);
+	}
+
+	if (g_now >= g_limit)
+		HOST_stop(0);
+}
+
+static void HOST_interrupts(void) {
+	uint8 vector;
+	while ((g_io.bytes[A_SREG] & (1 << SREG_I)) && (vector = HOST_pendingVector()) != 0)
+		HOST_call(vector);
+}
+
+/* Get the pending interrupt with the highest priority (lowest vector) OR 0 */
+static uint8 HOST_pendingVector(void) {
+	uint8 timers = g_io.bytes[A_TIFR] & g_io.bytes[A_TIMSK];
+	uint8 ucsrb = g_io.bytes[A_UCSRB];
+
+	if (timers & (1 << OCF2))										return VECTOR_TIMER2_COMP;
+	if (timers & (1 << TOV2))										return VECTOR_TIMER2_OVF;
+	if (timers & (1 << OCF1A))										return VECTOR_TIMER1_COMPA;
+	if (timers & (1 << OCF1B))										return VECTOR_TIMER1_COMPB;
+	if (timers & (1 << TOV1))										return VECTOR_TIMER1_OVF;
+	if (timers & (1 << TOV0))										return VECTOR_TIMER0_OVF;
+	if ((ucsrb & (1 << RXCIE)) && g_rx_count != 0)					return VECTOR_USART_RXC;
+	if ((ucsrb & (1 << UDRIE)) && !g_tx_full)						return VECTOR_USART_UDRE;
+	if ((ucsrb & (1 << TXCIE)) && g_txc)							return VECTOR_USART_TXC;
+	if ((g_twi_control & (1 << TWIE)) && (g_twi_control & (1 << TWEN)) && g_twint)
+																	return VECTOR_TWI;
+	if (timers & (1 << OCF0))										return VECTOR_TIMER0_COMP;
+	return 0;
+}
+
+static void HOST_call(const uint8 vector) {
+	uint8 previous = g_vector;
+
+	if (g_vectors[vector] == NULL_PTR)
+		HOST_fatal("bad interrupt: no ISR for an enabled interrupt");
+
+	/* the hardware clears the global interrupt enable and the flags of single source vectors */
+	g_stats.interrupts++;
+	g_io.bytes[A_SREG] &= ~(1 << SREG_I);
+	switch (vector) {
+		case VECTOR_TIMER2_COMP:	g_io.bytes[A_TIFR] &= ~(1 << OCF2);		break;
+		case VECTOR_TIMER2_OVF:		g_io.bytes[A_TIFR] &= ~(1 << TOV2);		break;
+		case VECTOR_TIMER1_COMPA:	g_io.bytes[A_TIFR] &= ~(1 << OCF1A);	break;
+		case VECTOR_TIMER1_COMPB:	g_io.bytes[A_TIFR] &= ~(1 << OCF1B);	break;
+		case VECTOR_TIMER1_OVF:		g_io.bytes[A_TIFR] &= ~(1 << TOV1);		break;
+		case VECTOR_TIMER0_OVF:		g_io.bytes[A_TIFR] &= ~(1 << TOV0);		break;
+		case VECTOR_TIMER0_COMP:	g_io.bytes[A_TIFR] &= ~(1 << OCF0);		break;
+		case VECTOR_USART_TXC:		g_txc = FALSE;							break;
+		default:															break;
+	}
+	g_now += HOST_ISR_CYCLES / 2;
+
+	g_vector = vector;
+	g_vectors[vector]();
+	HOST_settle();
+	g_vector = previous;
+
+	g_now += HOST_ISR_CYCLES / 2;
+	g_io.bytes[A_SREG] |= (1 << SREG_I);
+}
+
+/* Host CPU timer signal: the firmware made no register access for a whole period,
+ * it waits for a RAM variable set by an ISR so move the time to the next interrupt */
+static void HOST_watchdog(int signal) {
+	uint64 when;
+	(void)signal;
+
+	if (g_depth != 0 || g_stats.accesses != g_watchdog_accesses) {
+		g_watchdog_accesses = g_stats.accesses;
+		return;
+	}
+	if (!(g_io.bytes[A_SREG] & (1 << SREG_I)) || (when = HOST_nextEvent()) == NEVER)
+		return;
+
+	g_depth++;
+	g_stats.watchdog_advances++;
+	HOST_advance(when);
+	g_depth--;
+}
+
+
+static uint32 TIMER_prescaler(const uint8 n) {
+	static const uint16 prescalers[8] = {0, 1, 8, 64, 256, 1024, 0, 0};		/* 6, 7: external clock */
+	static const uint16 prescalers2[8] = {0, 1, 8, 32, 64, 128, 256, 1024};
+
+	switch (n) {
+		case 0:		return prescalers[g_io.bytes[A_TCCR0] & 0x07];
+		case 1:		return prescalers[g_io.bytes[A_TCCR1B] & 0x07];
+		default:	return prescalers2[g_io.bytes[A_TCCR2] & 0x07];
+	}
+}
+
+static uint16 TIMER_max(const uint8 n) {
+	return (n == 1) ? 0xFFFF : 0xFF;
+}
+
+/* Get the value after which the counter goes back to 0 */
+static uint16 TIMER_top(const uint8 n) {
+	uint8 tccr, wgm;
+
+	if (n == 1) {
+		wgm = ((g_io.bytes[A_TCCR1B] >> WGM12) & 0x03) << 2 | (g_io.bytes[A_TCCR1A] & 0x03);
+		if (wgm == 4)
+			return g_io.words[A_OCR1A / 2];
+		if (wgm == 12)
+			return g_io.words[A_ICR1 / 2];
+		return 0xFFFF;
+	}
+
+	tccr = g_io.bytes[(n == 0) ? A_TCCR0 : A_TCCR2];
+	if ((tccr & (1 << WGM01)) && !(tccr & (1 << WGM00)))
+		return g_io.bytes[(n == 0) ? A_OCR0 : A_OCR2];
+	return 0xFF;
+}
+
+/* Count the timer clock ticks since the last update (the prescaler runs with the CPU clock) */
+static void TIMER_update(const uint8 n) {
+	Timer *timer = &g_timers[n];
+	uint32 prescaler = TIMER_prescaler(n);
+	uint64 ticks = prescaler ? g_now / prescaler - timer->last / prescaler : 0;
+
+	timer->last = g_now;
+	if (ticks != 0)
+		TIMER_count(n, ticks);
+}
+
+static void TIMER_count(const uint8 n, uint64 ticks) {
+	static const uint8 overflow[3] = {1 << TOV0, 1 << TOV1, 1 << TOV2};
+	Timer *timer = &g_timers[n];
+	uint16 max = TIMER_max(n);
+	uint16 top;
+	uint32 left;
+
+	while (ticks != 0) {
+		top = TIMER_top(n);
+		/* the counter is already past the compare value: it counts up to MAX first */
+		if (timer->count > top)
+			top = max;
+		left = top - timer->count;
+		if (ticks <= left) {
+			TIMER_match(n, timer->count + 1, timer->count + ticks);
+			timer->count += ticks;
+			return;
+		}
+
+		TIMER_match(n, timer->count + 1, top);
+		if (top == max)
+			g_io.bytes[A_TIFR] |= overflow[n];
+		ticks -= left + 1;
+		timer->count = 0;
+		TIMER_match(n, 0, 0);
+
+		/* whole periods set the same flags again */
+		top = TIMER_top(n);
+		if (ticks > (uint64)top + 1) {
+			TIMER_match(n, 0, top);
+			if (top == max)
+				g_io.bytes[A_TIFR] |= overflow[n];
+			ticks %= (uint64)top + 1;
+		}
+	}
+}
+
+/* Set the compare match flags of the compare values the counter reached in from -> to */
+static void TIMER_match(const uint8 n, const uint32 from, const uint32 to) {
+	uint16 ocr;
+
+	switch (n) {
+		case 0:
+			ocr = g_io.bytes[A_OCR0];
+			if (ocr >= from && ocr <= to)
+				g_io.bytes[A_TIFR] |= (1 << OCF0);
+			break;
+		case 1:
+			ocr = g_io.words[A_OCR1A / 2];
+			if (ocr >= from && ocr <= to)
+				g_io.bytes[A_TIFR] |= (1 << OCF1A);
+			ocr = g_io.words[A_OCR1B / 2];
+			if (ocr >= from && ocr <= to)
+				g_io.bytes[A_TIFR] |= (1 << OCF1B);
+			break;
+		default:
+			ocr = g_io.bytes[A_OCR2];
+			if (ocr >= from && ocr <= to)
+				g_io.bytes[A_TIFR] |= (1 << OCF2);
+			break;
+	}
+}
+
+/* Get the number of ticks until the counter reaches target (NEVER if it doesn't) */
+static uint64 TIMER_distance(const uint8 n, const uint16 target) {
+	uint16 count = g_timers[n].count;
+	uint16 top = TIMER_top(n);
+	uint16 lap = (count > top) ? TIMER_max(n) : top;
+
+	if (target > count && target <= lap)
+		return target - count;
+	if (target <= top)
+		return (uint64)(lap - count) + 1 + target;
+	return NEVER;
+}
+
+/* Get the time of the next flag set by the timer with its interrupt enabled */
+static uint64 TIMER_next(const uint8 n) {
+	uint32 prescaler = TIMER_prescaler(n);
+	uint8 timsk = g_io.bytes[A_TIMSK];
+	uint16 count = g_timers[n].count;
+	uint16 max = TIMER_max(n);
+	uint16 top = TIMER_top(n);
+	uint64 ticks = NEVER;
+	uint64 distance;
+	bool overflow;
+
+	if (prescaler == 0)
+		return NEVER;
+
+	switch (n) {
+		case 0:
+			if (timsk & (1 << OCIE0))
+				ticks = TIMER_distance(0, g_io.bytes[A_OCR0]);
+			overflow = timsk & (1 << TOIE0);
+			break;
+		case 1:
+			if (timsk & (1 << OCIE1A))
+				ticks = TIMER_distance(1, g_io.words[A_OCR1A / 2]);
+			if ((timsk & (1 << OCIE1B)) && (distance = TIMER_distance(1, g_io.words[A_OCR1B / 2])) < ticks)
+				ticks = distance;
+			overflow = timsk & (1 << TOIE1);
+			break;
+		default:
+			if (timsk & (1 << OCIE2))
+				ticks = TIMER_distance(2, g_io.bytes[A_OCR2]);
+			overflow = timsk & (1 << TOIE2);
+			break;
+	}
+
+	/* the overflow flag is set when the counter wraps from MAX */
+	if (overflow && (top == max || count > top) && (distance = (uint64)(max - count) + 1) < ticks)
+		ticks = distance;
+
+	if (ticks == NEVER)
+		return NEVER;
+	return (g_timers[n].last / prescaler + ticks) * prescaler;
+}
+
+
+static uint32 UART_frameCycles(void) {
+	uint16 ubrr = ((g_ubrrh & 0x0F) << 8) | g_io.bytes[A_UBRRL];
+	uint8 divider = (g_io.bytes[A_UCSRA] & (1 << U2X)) ? 8 : 16;
+	uint8 bits = 1 + 5 + ((g_ucsrc >> UCSZ0) & 0x03) + ((g_ucsrc & (1 << UPM1)) ? 1 : 0) +
+		((g_ucsrc & (1 << USBS)) ? 2 : 1);
+	return (uint32)bits * divider * (ubrr + 1);
+}
+
+/* Mask of the data bits of a frame (5 -> 8 bits) */
+static uint8 UART_dataMask(void) {
+	return (1 << (5 + ((g_ucsrc >> UCSZ0) & 0x03))) - 1;
+}
+
+static void UART_read(void) {
+	uint8 i;
+	if (g_rx_count == 0)
+		return;
+	g_dor = FALSE;
+	g_rx_count--;
+	for (i = 0; i < g_rx_count; i++)
+		g_rx_fifo[i] = g_rx_fifo[i + 1];
+}
+
+static void UART_write(const uint8 data) {
+	if (!(g_io.bytes[A_UCSRB] & (1 << TXEN)))
+		return;
+
+	/* the shift register takes the byte at once when it is free, otherwise it waits in UDR */
+	if (!g_tx_busy) {
+		g_tx_shift = data;
+		g_tx_busy = TRUE;
+		g_tx_done = g_now + UART_frameCycles();
+		if (g_uart_line_hook != NULL_PTR)
+			g_uart_line_hook(data & UART_dataMask(), g_tx_done);
+	}
+	else if (!g_tx_full) {
+		g_tx_data = data;
+		g_tx_full = TRUE;
+	}
+}
+
+static void UART_transmitted(void) {
+	uint8 data = g_tx_shift;
+	uint8 mask = UART_dataMask();
+
+	if (g_tx_full) {
+		g_tx_shift = g_tx_data;
+		g_tx_full = FALSE;
+		g_tx_done += UART_frameCycles();
+		if (g_uart_line_hook != NULL_PTR)
+			g_uart_line_hook(g_tx_shift & mask, g_tx_done);
+	}
+	else {
+		g_tx_busy = FALSE;
+		g_tx_done = NEVER;
+		g_txc = TRUE;
+	}
+
+	g_stats.uart_tx_bytes++;
+	if (g_uart_tx_hook != NULL_PTR)
+		g_uart_tx_hook(data & mask);
+}
+
+static void UART_arrived(void) {
+	uint8 data = g_rx_line[g_rx_line_tail++];
+	uint8 mask = UART_dataMask();
+
+	g_rx_next = (g_rx_line_tail == g_rx_line_head) ? NEVER : g_rx_line_time[g_rx_line_tail];
+	if (!(g_io.bytes[A_UCSRB] & (1 << RXEN)))
+		return;
+
+	g_stats.uart_rx_bytes++;
+	if (g_rx_count == RX_FIFO_SIZE) {
+		/* the byte in the shift register is lost */
+		g_dor = TRUE;
+		g_stats.uart_rx_overruns++;
+		return;
+	}
+	g_rx_fifo[g_rx_count++] = data & mask;
+}
+
+
+static uint32 TWI_bitCycles(void) {
+	uint8 prescaler = g_io.bytes[A_TWSR] & ((1 << TWPS1) | (1 << TWPS0));
+	return 16 + 2 * (uint32)g_io.bytes[A_TWBR] * (1 << (2 * prescaler));
+}
+
+/* The firmware wrote TWCR */
+static void TWI_control(const uint8 value) {
+	g_twi_control = value & TWCR_CONTROL;
+
+	/* disabling the module ends any transfer at once */
+	if (!(value & (1 << TWEN))) {
+		if (g_twi_state != TWI_IDLE && g_twi_selected != NULL_PTR)
+			g_twi_selected->stop();
+		g_twi_selected = NULL_PTR;
+		g_twi_state = TWI_IDLE;
+		g_twi_operation = TWI_NONE;
+		g_twi_done = NEVER;
+		g_twint = FALSE;
+		g_twi_status = 0xF8;
+		return;
+	}
+
+	/* the next operation starts when TWINT is cleared by writing a one to it */
+	if (!(value & (1 << TWINT)))
+		return;
+	g_twint = FALSE;
+	g_twi_status = 0xF8;
+
+	if (value & (1 << TWSTO)) {
+		if (g_twi_state != TWI_IDLE && g_twi_selected != NULL_PTR)
+			g_twi_selected->stop();
+		g_twi_selected = NULL_PTR;
+		g_twi_state = TWI_IDLE;
+		g_twi_operation = TWI_STOP;
+		g_twi_done = g_now + TWI_bitCycles();
+		return;
+	}
+	if (value & (1 << TWSTA)) {
+		g_twi_operation = TWI_START;
+		g_twi_done = g_now + TWI_bitCycles();
+		return;
+	}
+
+	switch (g_twi_state) {
+		case TWI_ADDRESSING:	g_twi_operation = TWI_ADDRESS;	break;
+		case TWI_TRANSMITTER:	g_twi_operation = TWI_WRITE;	break;
+		case TWI_RECEIVER:		g_twi_operation = TWI_READ;		break;
+		default:				g_twi_operation = TWI_NONE;		return;
+	}
+	g_twi_byte = g_io.bytes[A_TWDR];
+	g_twi_done = g_now + 9 * TWI_bitCycles();
+}
+
+/* The operation on the bus is complete */
+static void TWI_done(void) {
+	bool ack = FALSE;
+	uint8 i;
+
+	g_twi_done = NEVER;
+	switch (g_twi_operation) {
+		case TWI_STOP:
+			/* TWSTO is cleared when the stop condition is sent, TWINT isn't set
+			 * (TWSTA written with it: a start condition follows) */
+			g_twi_control &= ~(1 << TWSTO);
+			if (g_twi_control & (1 << TWSTA)) {
+				g_twi_operation = TWI_START;
+				g_twi_done = g_now + TWI_bitCycles();
+				return;
+			}
+			g_twi_operation = TWI_NONE;
+			return;
+
+		case TWI_START:
+			g_twi_status = (g_twi_state == TWI_IDLE) ? 0x08 : 0x10;
+			g_twi_state = TWI_ADDRESSING;
+			g_twi_selected = NULL_PTR;
+			break;
+
+		case TWI_ADDRESS:
+			/* every slave sees the address, the first one acknowledging it is selected */
+			for (i = 0; i < g_twi_slave_count && !ack; i++) {
+				if (g_twi_slaves[i]->start(g_twi_byte)) {
+					g_twi_selected = g_twi_slaves[i];
+					ack = TRUE;
+				}
+			}
+			if (g_twi_byte & 1) {
+				g_twi_status = ack ? 0x40 : 0x48;
+				g_twi_state = TWI_RECEIVER;
+			}
+			else {
+				g_twi_status = ack ? 0x18 : 0x20;
+				g_twi_state = TWI_TRANSMITTER;
+			}
+			g_stats.twi_bytes++;
+			break;
+
+		case TWI_WRITE:
+			ack = (g_twi_selected != NULL_PTR) && g_twi_selected->write(g_twi_byte);
+			g_twi_status = ack ? 0x28 : 0x30;
+			g_stats.twi_bytes++;
+			break;
+
+		case TWI_READ:
+			ack = (g_twi_control & (1 << TWEA)) ? TRUE : FALSE;
+			g_io.bytes[A_TWDR] = (g_twi_selected != NULL_PTR) ? g_twi_selected->read(ack) : 0xFF;
+			g_twi_status = ack ? 0x50 : 0x58;
+			g_stats.twi_bytes++;
+			break;
+
+		default:
+			return;
+	}
+	g_twi_operation = TWI_NONE;
+	g_twint = TRUE;
+}
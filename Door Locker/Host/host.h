@@ -0,0 +1,117 @@
+/* Host build: register level mock of the Atmega16 (time, interrupts, TIMERS, UART and TWI) */
+
+/* The firmware sources are compiled unchanged against the headers in include/, where every register
+ * access calls HOST_io8 / HOST_io16. The mock keeps the simulated time in CPU cycles, runs the
+ * peripherals in it and calls the ISRs when their interrupt is enabled and pending.
+ * The board models (LCD, keypad, EEPROM) are attached with the hooks below.
+ */
+
+/* Constraints:
+ * the time advances HOST_ACCESS_CYCLES per register access, in delays, sleeps and ISR entries,
+ * code that doesn't touch a register takes no time (a watchdog advances the time
+ * when the firmware spins on RAM variables waiting for an ISR)
+ * a register write is seen when the next access begins, by comparing the register with its
+ * value before the access: writing the same value back is only seen for UDR and TWCR
+ * UDR accesses are writes in the UDRE ISR OR when the value changed, reads in the RXC ISR
+ * OR while RXC is set (a polling write of the received byte with RXC set is taken as a read)
+ * writing a 1 to a TIFR flag that is already the only flag set is not seen
+ * TIMERS: NORMAL and CTC modes (the PWM modes count like NORMAL), no output compare pins
+ * UART: asynchronous mode only, the line is idle until HOST_uartReceive
+ * TWI: master mode only, the slaves are attached with HOST_attachTwiSlave
+ */
+
+
+#ifndef HOST_H_
+#define HOST_H_
+
+
+#include <stdint.h>
+#include <stdio.h>
+#include "std_types.h"
+
+
+/* Mock configurations */
+#define HOST_ACCESS_CYCLES 2		/* CPU cycles of one register access (load/store + ALU) */
+#define HOST_ISR_CYCLES 8			/* CPU cycles of an interrupt entry (4) and RETI (4) */
+#define HOST_EVENTS 64				/* max number of scheduled events */
+#define HOST_TWI_SLAVES 4			/* max number of attached TWI slaves */
+#define HOST_WATCHDOG_MS 1			/* host time without any register access before the time is advanced */
+
+/* Time conversions */
+#define HOST_US(us) ((uint64)(us) * (F_CPU / 1000000UL))
+#define HOST_MS(ms) ((uint64)(ms) * (F_CPU / 1000UL))
+#define HOST_TO_MS(cycles) ((double)(cycles) * 1000.0 / F_CPU)
+
+typedef struct {
+	/* address of the slave selected by SLA+R/W after a (repeated) start, TRUE to acknowledge */
+	bool (*start)(const uint8 sla_rw);
+	/* data byte received in master transmitter mode, TRUE to acknowledge */
+	bool (*write)(const uint8 data);
+	/* data byte sent in master receiver mode (ack is TRUE if the master acknowledges it) */
+	uint8 (*read)(const bool ack);
+	/* stop condition OR the TWI module was disabled in the middle of a transfer */
+	void (*stop)(void);
+} HOST_TwiSlave;
+
+typedef struct {
+	uint64 accesses;				/* register accesses */
+	uint64 interrupts;				/* ISR calls */
+	uint64 sleep_cycles;			/* CPU cycles spent sleeping */
+	uint64 watchdog_advances;		/* times the watchdog advanced the time of a spinning firmware */
+	uint32 uart_tx_bytes;
+	uint32 uart_rx_bytes;
+	uint32 uart_rx_overruns;		/* received bytes lost because UDR wasn't read */
+	uint32 twi_bytes;				/* TWI address + data bytes */
+} HOST_Stats;
+
+
+/* Reset the registers, the time and the peripherals (called once before the firmware main) */
+void HOST_init(void);
+
+/* Get the simulated time in CPU cycles since HOST_init */
+uint64 HOST_now(void);
+
+/* Call f_ptr(arg) at time when (in CPU cycles), between two register accesses of the firmware */
+void HOST_schedule(const uint64 when, void (*f_ptr)(void *arg), void * const arg);
+
+/* Call f_ptr then exit when the simulated time reaches limit (in CPU cycles) */
+void HOST_setTimeLimit(const uint64 limit, void (*f_ptr)(void));
+
+/* Call the time limit function then exit now */
+void HOST_finish(void);
+
+/* Set the function called when the firmware wrote PORTx OR DDRx (port is 'A' -> 'D') */
+void HOST_setPortHook(void (*f_ptr)(const uint8 port));
+
+/* Set the function giving the level of the input pins of a port when PINx is read
+ * (level holds the default: driven outputs, inputs pulled up), it returns the new level */
+void HOST_setPinHook(uint8 (*f_ptr)(const uint8 port, const uint8 level));
+
+/* Get the output register / direction register of a port without side effects */
+uint8 HOST_getPort(const uint8 port);
+uint8 HOST_getDdr(const uint8 port);
+
+/* Set the function called with each byte the UART finished sending */
+void HOST_setUartTxHook(void (*f_ptr)(const uint8 data));
+
+/* Set the function called with each byte the UART starts sending (done: time its stop bit ends) */
+void HOST_setUartLineHook(void (*f_ptr)(const uint8 data, const uint64 done));
+
+/* Queue a byte on the UART RX line: bytes arrive back to back, one frame time each */
+void HOST_uartReceive(const uint8 data);
+
+/* Queue a byte on the UART RX line completely received at time when (in CPU cycles, not in the past),
+ * at least one frame time after the previous byte */
+void HOST_uartReceiveAt(const uint8 data, const uint64 when);
+
+/* Attach a TWI slave to the bus */
+void HOST_attachTwiSlave(const HOST_TwiSlave * const slave);
+
+/* Get the counters of the mock */
+const HOST_Stats *HOST_getStats(void);
+
+/* Print the time and counters of the run (simulated time, host CPU time, mock counters) */
+void HOST_report(FILE * const file);
+
+
+#endif /* HOST_H_ */
@@ -0,0 +1,25 @@
+/* Host build: interrupt control of the register level mock (host.c) */
+
+/* Constraints:
+ * an ISR is a plain function called by the mock between two register accesses
+ * sei takes effect at the next register access, delay OR sleep (like after the next instruction)
+ */
+
+
+#ifndef HOST_AVR_INTERRUPT_H_
+#define HOST_AVR_INTERRUPT_H_
+
+
+#include <avr/io.h>
+
+
+void HOST_sei(void);
+void HOST_cli(void);
+
+#define sei() HOST_sei()
+#define cli() HOST_cli()
+
+#define ISR(vector, ...) void vector(void); void vector(void)
+
+
+#endif /* HOST_AVR_INTERRUPT_H_ */
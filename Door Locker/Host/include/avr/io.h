@@ -0,0 +1,258 @@
+/* Host build: Atmega16 I/O registers mapped on the register level mock (host.c) */
+
+/* Constraints:
+ * every register access goes through HOST_io8 / HOST_io16, which advance the simulated time
+ * and let the peripheral models see the previous access before this one
+ * only the registers, bits and vectors of the Atmega16 used by the firmware are defined
+ */
+
+
+#ifndef HOST_AVR_IO_H_
+#define HOST_AVR_IO_H_
+
+
+#include <stdint.h>
+
+
+volatile uint8_t *HOST_io8(const uint8_t address);
+volatile uint16_t *HOST_io16(const uint8_t address);
+
+#define _SFR_MEM8(address) (*HOST_io8(address))
+#define _SFR_MEM16(address) (*HOST_io16(address))
+#define _BV(bit) (1 << (bit))
+
+
+/* Registers (data memory addresses) */
+#define TWBR	_SFR_MEM8(0x20)
+#define TWSR	_SFR_MEM8(0x21)
+#define TWAR	_SFR_MEM8(0x22)
+#define TWDR	_SFR_MEM8(0x23)
+#define ACSR	_SFR_MEM8(0x28)
+#define UBRRL	_SFR_MEM8(0x29)
+#define UCSRB	_SFR_MEM8(0x2A)
+#define UCSRA	_SFR_MEM8(0x2B)
+#define UDR		_SFR_MEM8(0x2C)
+#define PIND	_SFR_MEM8(0x30)
+#define DDRD	_SFR_MEM8(0x31)
+#define PORTD	_SFR_MEM8(0x32)
+#define PINC	_SFR_MEM8(0x33)
+#define DDRC	_SFR_MEM8(0x34)
+#define PORTC	_SFR_MEM8(0x35)
+#define PINB	_SFR_MEM8(0x36)
+#define DDRB	_SFR_MEM8(0x37)
+#define PORTB	_SFR_MEM8(0x38)
+#define PINA	_SFR_MEM8(0x39)
+#define DDRA	_SFR_MEM8(0x3A)
+#define PORTA	_SFR_MEM8(0x3B)
+#define UBRRH	_SFR_MEM8(0x40)		/* shares its address with UCSRC (selected by URSEL) */
+#define UCSRC	_SFR_MEM8(0x40)
+#define ASSR	_SFR_MEM8(0x42)
+#define OCR2	_SFR_MEM8(0x43)
+#define TCNT2	_SFR_MEM8(0x44)
+#define TCCR2	_SFR_MEM8(0x45)
+#define ICR1	_SFR_MEM16(0x46)
+#define OCR1B	_SFR_MEM16(0x48)
+#define OCR1A	_SFR_MEM16(0x4A)
+#define TCNT1	_SFR_MEM16(0x4C)
+#define TCCR1B	_SFR_MEM8(0x4E)
+#define TCCR1A	_SFR_MEM8(0x4F)
+#define SFIOR	_SFR_MEM8(0x50)
+#define TCNT0	_SFR_MEM8(0x52)
+#define TCCR0	_SFR_MEM8(0x53)
+#define MCUCSR	_SFR_MEM8(0x54)
+#define MCUCR	_SFR_MEM8(0x55)
+#define TWCR	_SFR_MEM8(0x56)
+#define TIFR	_SFR_MEM8(0x58)
+#define TIMSK	_SFR_MEM8(0x59)
+#define GIFR	_SFR_MEM8(0x5A)
+#define GICR	_SFR_MEM8(0x5B)
+#define OCR0	_SFR_MEM8(0x5C)
+#define SREG	_SFR_MEM8(0x5F)
+
+
+/* Interrupt vectors */
+#define INT0_vect			__vector_1
+#define INT1_vect			__vector_2
+#define TIMER2_COMP_vect	__vector_3
+#define TIMER2_OVF_vect		__vector_4
+#define TIMER1_CAPT_vect	__vector_5
+#define TIMER1_COMPA_vect	__vector_6
+#define TIMER1_COMPB_vect	__vector_7
+#define TIMER1_OVF_vect		__vector_8
+#define TIMER0_OVF_vect		__vector_9
+#define SPI_STC_vect		__vector_10
+#define USART_RXC_vect		__vector_11
+#define USART_UDRE_vect		__vector_12
+#define USART_TXC_vect		__vector_13
+#define ADC_vect			__vector_14
+#define EE_RDY_vect			__vector_15
+#define ANA_COMP_vect		__vector_16
+#define TWI_vect			__vector_17
+#define INT2_vect			__vector_18
+#define TIMER0_COMP_vect	__vector_19
+#define SPM_RDY_vect		__vector_20
+
+/* Interrupt vector numbers */
+#define TIMER2_COMP_vect_num	3
+#define TIMER2_OVF_vect_num		4
+#define TIMER1_CAPT_vect_num	5
+#define TIMER1_COMPA_vect_num	6
+#define TIMER1_COMPB_vect_num	7
+#define TIMER1_OVF_vect_num		8
+#define TIMER0_OVF_vect_num		9
+#define TIMER0_COMP_vect_num	19
+
+
+/* TWCR */
+#define TWINT	7
+#define TWEA	6
+#define TWSTA	5
+#define TWSTO	4
+#define TWWC	3
+#define TWEN	2
+#define TWIE	0
+
+/* TWAR */
+#define TWGCE	0
+
+/* TWSR */
+#define TWPS1	1
+#define TWPS0	0
+
+/* ACSR */
+#define ACD		7
+
+/* UCSRA */
+#define RXC		7
+#define TXC		6
+#define UDRE	5
+#define FE		4
+#define DOR		3
+#define PE		2
+#define U2X		1
+#define MPCM	0
+
+/* UCSRB */
+#define RXCIE	7
+#define TXCIE	6
+#define UDRIE	5
+#define RXEN	4
+#define TXEN	3
+#define UCSZ2	2
+#define RXB8	1
+#define TXB8	0
+
+/* UCSRC */
+#define URSEL	7
+#define UMSEL	6
+#define UPM1	5
+#define UPM0	4
+#define USBS	3
+#define UCSZ1	2
+#define UCSZ0	1
+#define UCPOL	0
+
+/* TCCR0 */
+#define FOC0	7
+#define WGM00	6
+#define COM01	5
+#define COM00	4
+#define WGM01	3
+#define CS02	2
+#define CS01	1
+#define CS00	0
+
+/* TCCR1A */
+#define COM1A1	7
+#define COM1A0	6
+#define COM1B1	5
+#define COM1B0	4
+#define FOC1A	3
+#define FOC1B	2
+#define WGM11	1
+#define WGM10	0
+
+/* TCCR1B */
+#define ICNC1	7
+#define ICES1	6
+#define WGM13	4
+#define WGM12	3
+#define CS12	2
+#define CS11	1
+#define CS10	0
+
+/* TCCR2 */
+#define FOC2	7
+#define WGM20	6
+#define COM21	5
+#define COM20	4
+#define WGM21	3
+#define CS22	2
+#define CS21	1
+#define CS20	0
+
+/* TIMSK */
+#define OCIE2	7
+#define TOIE2	6
+#define TICIE1	5
+#define OCIE1A	4
+#define OCIE1B	3
+#define TOIE1	2
+#define OCIE0	1
+#define TOIE0	0
+
+/* TIFR */
+#define OCF2	7
+#define TOV2	6
+#define ICF1	5
+#define OCF1A	4
+#define OCF1B	3
+#define TOV1	2
+#define OCF0	1
+#define TOV0	0
+
+/* MCUCR */
+#define SE		6
+#define SM2		7
+#define SM1		5
+#define SM0		4
+
+/* SREG */
+#define SREG_I	7
+
+/* Port pins */
+#define PA7 7
+#define PA6 6
+#define PA5 5
+#define PA4 4
+#define PA3 3
+#define PA2 2
+#define PA1 1
+#define PA0 0
+#define PB7 7
+#define PB6 6
+#define PB5 5
+#define PB4 4
+#define PB3 3
+#define PB2 2
+#define PB1 1
+#define PB0 0
+#define PC7 7
+#define PC6 6
+#define PC5 5
+#define PC4 4
+#define PC3 3
+#define PC2 2
+#define PC1 1
+#define PC0 0
+#define PD7 7
+#define PD6 6
+#define PD5 5
+#define PD4 4
+#define PD3 3
+#define PD2 2
+#define PD1 1
+#define PD0 0
+
+
+#endif /* HOST_AVR_IO_H_ */
@@ -0,0 +1,30 @@
+/* Host build: sleep modes of the register level mock (host.c) */
+
+/* Constraints:
+ * every sleep mode is IDLE: the CPU wakes up on the next enabled interrupt
+ */
+
+
+#ifndef HOST_AVR_SLEEP_H_
+#define HOST_AVR_SLEEP_H_
+
+
+#include <avr/io.h>
+
+
+void HOST_sleep(void);
+
+#define SLEEP_MODE_IDLE			(0x00)
+#define SLEEP_MODE_ADC			(1 << SM0)
+#define SLEEP_MODE_PWR_DOWN		(1 << SM1)
+#define SLEEP_MODE_PWR_SAVE		((1 << SM0) | (1 << SM1))
+#define SLEEP_MODE_STANDBY		((1 << SM1) | (1 << SM2))
+#define SLEEP_MODE_EXT_STANDBY	((1 << SM0) | (1 << SM1) | (1 << SM2))
+
+#define set_sleep_mode(mode) (MCUCR = (MCUCR & ~((1 << SM0) | (1 << SM1) | (1 << SM2))) | (mode))
+#define sleep_enable() (MCUCR |= (1 << SE))
+#define sleep_disable() (MCUCR &= ~(1 << SE))
+#define sleep_cpu() HOST_sleep()
+
+
+#endif /* HOST_AVR_SLEEP_H_ */
@@ -0,0 +1,15 @@
+/* Host build: the C library with the avr-libc extensions used by the firmware */
+
+
+#ifndef HOST_STDLIB_H_
+#define HOST_STDLIB_H_
+
+
+#include_next <stdlib.h>
+
+
+char *itoa(int value, char *str, int radix);
+char *ultoa(unsigned long value, char *str, int radix);
+
+
+#endif /* HOST_STDLIB_H_ */
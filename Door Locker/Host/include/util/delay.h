@@ -0,0 +1,27 @@
+/* Host build: busy wait delays of the register level mock (host.c) */
+
+/* Constraints:
+ * the delay advances the simulated time (interrupts are served during the delay)
+ * it is rounded up to whole CPU cycles at F_CPU
+ */
+
+
+#ifndef HOST_UTIL_DELAY_H_
+#define HOST_UTIL_DELAY_H_
+
+
+#include <stdint.h>
+
+
+#ifndef F_CPU
+#define F_CPU 1000000UL
+#endif
+
+
+void HOST_delayCycles(const uint32_t cycles);
+
+#define _delay_us(us) HOST_delayCycles((uint32_t)((us) * (F_CPU / 1000000.0) + 0.999))
+#define _delay_ms(ms) HOST_delayCycles((uint32_t)((ms) * (F_CPU / 1000.0) + 0.999))
+
+
+#endif /* HOST_UTIL_DELAY_H_ */
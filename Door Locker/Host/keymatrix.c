@@ -0,0 +1,66 @@
+/* Host build: model of a 4x3 keypad matrix (rows on pins 0 -> 3, columns on pins 4 -> 6 of one port) */
+
+#include <string.h>
+#include "host.h"
+#include "keymatrix.h"
+
+
+/* Keys row by row from the top left */
+static const char g_keys[] = "123456789*0#";
+
+/* Global port and pressed keys */
+static uint8 g_port;
+static bool g_pressed[KEYMATRIX_ROWS * KEYMATRIX_COLS];
+
+
+static sint8 KEYMATRIX_find(const char key);
+
+
+void KEYMATRIX_init(const uint8 port) {
+	g_port = port;
+	memset(g_pressed, 0, sizeof(g_pressed));
+}
+
+bool KEYMATRIX_press(const char key) {
+	sint8 i = KEYMATRIX_find(key);
+	if (i < 0)
+		return FALSE;
+	g_pressed[i] = TRUE;
+	return TRUE;
+}
+
+bool KEYMATRIX_release(const char key) {
+	sint8 i = KEYMATRIX_find(key);
+	if (i < 0)
+		return FALSE;
+	g_pressed[i] = FALSE;
+	return TRUE;
+}
+
+uint8 KEYMATRIX_pinLevel(const uint8 port, const uint8 level) {
+	uint8 result = level;
+	uint8 inputs = ~HOST_getDdr(g_port);
+	uint8 row, col, row_pin, col_pin;
+
+	if (port != g_port)
+		return level;
+
+	/* a low row OR column pulls the other line (if it is an input) of each pressed key low */
+	for (row = 0; row < KEYMATRIX_ROWS; row++) {
+		for (col = 0; col < KEYMATRIX_COLS; col++) {
+			if (!g_pressed[row * KEYMATRIX_COLS + col])
+				continue;
+			row_pin = 1 << row;
+			col_pin = 1 << (KEYMATRIX_FIRST_COL + col);
+			if (!(level & row_pin) || !(level & col_pin))
+				result &= ~((row_pin | col_pin) & inputs);
+		}
+	}
+	return result;
+}
+
+
+static sint8 KEYMATRIX_find(const char key) {
+	const char *found = (key != '\0') ? strchr(g_keys, key) : NULL_PTR;
+	return (found != NULL_PTR) ? (sint8)(found - g_keys) : -1;
+}
@@ -0,0 +1,34 @@
+/* Host build: model of a 4x3 keypad matrix (rows on pins 0 -> 3, columns on pins 4 -> 6 of one port) */
+
+/* Constraints:
+ * a pressed key connects its row and column pins: a pin driven low pulls the other one low
+ * (pull ups keep the released lines high), contacts don't bounce
+ * keys: '1' -> '9', '*', '0', '#' (row by row from the top left)
+ */
+
+
+#ifndef KEYMATRIX_H_
+#define KEYMATRIX_H_
+
+
+#include "std_types.h"
+
+
+/* Model configurations */
+#define KEYMATRIX_ROWS 4
+#define KEYMATRIX_COLS 3
+#define KEYMATRIX_FIRST_COL 4		/* pin of the first column */
+
+
+/* Release all keys of the keypad on port ('A' -> 'D') */
+void KEYMATRIX_init(const uint8 port);
+
+/* Press / release a key (returns FALSE if the key doesn't exist) */
+bool KEYMATRIX_press(const char key);
+bool KEYMATRIX_release(const char key);
+
+/* Called from the pin hook: level of the port pins with the pressed keys */
+uint8 KEYMATRIX_pinLevel(const uint8 port, const uint8 level);
+
+
+#endif /* KEYMATRIX_H_ */
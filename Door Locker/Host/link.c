@@ -0,0 +1,114 @@
+/* Host build: UART line between two runners (co-simulation of the HMI and Control boards) */
+
+#include <errno.h>
+#include <signal.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "host.h"
+#include "link.h"
+
+
+/* Bytes started on the line during a quantum (sent to the peer at its end) */
+typedef struct {
+	uint64 done;			/* time the stop bit ends */
+	uint8 data;
+} LINK_Byte;
+
+typedef struct {
+	uint64 end;				/* end of the quantum */
+	uint32 count;
+	LINK_Byte bytes[LINK_MAX_BYTES];	/* only count bytes are sent */
+} LINK_Message;
+
+#define LINK_HEADER_SIZE offsetof(LINK_Message, bytes)
+
+
+/* Global pipes to / from the peer, end of the current quantum and its bytes */
+static int g_in = -1;
+static int g_out = -1;
+static uint64 g_end;
+static LINK_Message g_message;
+static void (*g_received)(const uint8 data) = NULL_PTR;
+
+
+static void LINK_started(const uint8 data, const uint64 done);
+static void LINK_exchange(void *arg);
+static bool LINK_transfer(const int fd, uint8 *buffer, size_t size, const bool reading);
+
+
+bool LINK_init(const char * const fds, void (*f_ptr)(const uint8 data)) {
+	char *end;
+
+	g_in = (int)strtol(fds, &end, 10);
+	if (end == fds || *end != ',')
+		return FALSE;
+	g_out = (int)strtol(end + 1, &end, 10);
+	if (*end != '\0')
+		return FALSE;
+
+	/* a peer gone makes the writes fail instead of killing the process */
+	signal(SIGPIPE, SIG_IGN);
+	g_message.count = 0;
+	g_received = f_ptr;
+	g_end = HOST_now() + HOST_US(LINK_QUANTUM_US);
+	HOST_setUartLineHook(LINK_started);
+	HOST_schedule(g_end, LINK_exchange, NULL_PTR);
+	return TRUE;
+}
+
+
+static void LINK_started(const uint8 data, const uint64 done) {
+	if (g_message.count == LINK_MAX_BYTES) {
+		fprintf(stderr, "link: too many bytes in a quantum\n");
+		HOST_finish();
+	}
+	g_message.bytes[g_message.count].done = done;
+	g_message.bytes[g_message.count].data = data;
+	g_message.count++;
+}
+
+/* End of a quantum: send the bytes started in it, then receive the ones of the peer */
+static void LINK_exchange(void *arg) {
+	LINK_Message peer;
+	uint32 i;
+	(void)arg;
+
+	/* both sides write first: a message is much smaller than the pipe buffer */
+	g_message.end = g_end;
+	if (!LINK_transfer(g_out, (uint8 *)&g_message, LINK_HEADER_SIZE + g_message.count * sizeof(LINK_Byte), FALSE) ||
+			!LINK_transfer(g_in, (uint8 *)&peer, LINK_HEADER_SIZE, TRUE))
+		HOST_finish();
+	g_message.count = 0;
+
+	if (peer.end != g_end || peer.count > LINK_MAX_BYTES) {
+		fprintf(stderr, "link: peer out of step\n");
+		HOST_finish();
+	}
+	if (!LINK_transfer(g_in, (uint8 *)peer.bytes, peer.count * sizeof(LINK_Byte), TRUE))
+		HOST_finish();
+	for (i = 0; i < peer.count; i++) {
+		HOST_uartReceiveAt(peer.bytes[i].data, peer.bytes[i].done);
+		if (g_received != NULL_PTR)
+			g_received(peer.bytes[i].data);
+	}
+
+	g_end += HOST_US(LINK_QUANTUM_US);
+	HOST_schedule(g_end, LINK_exchange, NULL_PTR);
+}
+
+/* Read OR write a whole buffer, returns FALSE when the peer is gone */
+static bool LINK_transfer(const int fd, uint8 *buffer, size_t size, const bool reading) {
+	ssize_t done;
+
+	while (size != 0) {
+		done = reading ? read(fd, buffer, size) : write(fd, buffer, size);
+		if (done < 0 && errno == EINTR)
+			continue;
+		if (done <= 0)
+			return FALSE;
+		buffer += done;
+		size -= done;
+	}
+	return TRUE;
+}
@@ -0,0 +1,30 @@
+/* Host build: UART line between two runners (co-simulation of the HMI and Control boards) */
+
+/* The two mocks run in lockstep in their own process: each one stops every LINK_QUANTUM_US of
+ * simulated time and exchanges with its peer the bytes it started sending during the quantum.
+ * A byte takes one frame time on the line, longer than the quantum, so the peer gets it before
+ * its stop bit ends and receives it at the exact time the sender finishes it.
+ * Constraints:
+ * LINK_QUANTUM_US must be shorter than a UART frame (1.04 ms at 9600 baud, 8N1)
+ * the run ends when the peer ends (its pipe is closed): HOST_finish is called
+ */
+
+
+#ifndef LINK_H_
+#define LINK_H_
+
+
+#include "std_types.h"
+
+
+/* Link configurations */
+#define LINK_QUANTUM_US 1000		/* simulated time between two exchanges */
+#define LINK_MAX_BYTES 64			/* max bytes started in a quantum */
+
+
+/* Connect the UART line to the peer through two file descriptors "<in>,<out>", f_ptr is called with
+ * each byte the peer sends (NULL_PTR: none) (returns FALSE if fds isn't a pair of descriptors) */
+bool LINK_init(const char * const fds, void (*f_ptr)(const uint8 data));
+
+
+#endif /* LINK_H_ */
@@ -0,0 +1,143 @@
+/* Host build: model of a 24Cxx serial EEPROM (24C01 -> 24C16) on the TWI bus */
+
+#include <stdio.h>
+#include <string.h>
+#include "host.h"
+#include "m24cxx.h"
+
+
+/* Bus transfer states */
+typedef enum {
+	M24CXX_IDLE, M24CXX_WORD_ADDRESS, M24CXX_DATA, M24CXX_READ
+} M24CXX_State;
+
+
+/* Global memory, page buffer and address counter */
+static uint8 g_memory[M24CXX_SIZE];
+static uint8 g_page[M24CXX_PAGE_SIZE];
+static bool g_page_used[M24CXX_PAGE_SIZE];
+static uint16 g_page_address;
+static uint16 g_address = 0;
+static uint8 g_block;
+
+/* Global transfer state and end of the write cycle in progress */
+static M24CXX_State g_state = M24CXX_IDLE;
+static bool g_page_written = FALSE;
+static uint64 g_busy_until = 0;
+
+static M24CXX_Stats g_stats;
+
+
+static bool M24CXX_start(const uint8 sla_rw);
+static bool M24CXX_write(const uint8 data);
+static uint8 M24CXX_read(const bool ack);
+static void M24CXX_stop(void);
+
+static const HOST_TwiSlave g_slave = {M24CXX_start, M24CXX_write, M24CXX_read, M24CXX_stop};
+
+
+void M24CXX_init(void) {
+	memset(g_memory, 0xFF, sizeof(g_memory));
+	memset(&g_stats, 0, sizeof(g_stats));
+	HOST_attachTwiSlave(&g_slave);
+}
+
+bool M24CXX_load(const char * const path) {
+	FILE *file = fopen(path, "rb");
+	if (file == NULL)
+		return FALSE;
+	/* a shorter image leaves the rest erased */
+	fread(g_memory, 1, sizeof(g_memory), file);
+	fclose(file);
+	return TRUE;
+}
+
+bool M24CXX_save(const char * const path) {
+	FILE *file = fopen(path, "wb");
+	bool done;
+	if (file == NULL)
+		return FALSE;
+	done = (fwrite(g_memory, 1, sizeof(g_memory), file) == sizeof(g_memory));
+	return (fclose(file) == 0) && done;
+}
+
+const M24CXX_Stats *M24CXX_getStats(void) {
+	return &g_stats;
+}
+
+
+static bool M24CXX_start(const uint8 sla_rw) {
+	uint8 device = sla_rw >> 1;
+
+	/* a (repeated) start without a stop discards the page write */
+	if (g_page_written) {
+		g_page_written = FALSE;
+		g_stats.aborted_writes++;
+	}
+	g_state = M24CXX_IDLE;
+
+	if ((device & ~0x07) != M24CXX_ADDRESS || ((device & 0x07) << 8) >= M24CXX_SIZE)
+		return FALSE;
+	if (HOST_now() < g_busy_until) {
+		g_stats.busy_nacks++;
+		return FALSE;
+	}
+
+	g_block = device & 0x07;
+	g_state = (sla_rw & 1) ? M24CXX_READ : M24CXX_WORD_ADDRESS;
+	return TRUE;
+}
+
+static bool M24CXX_write(const uint8 data) {
+	uint8 offset;
+
+	switch (g_state) {
+		case M24CXX_WORD_ADDRESS:
+			g_address = ((uint16)g_block << 8) | data;
+			g_page_address = g_address & ~(M24CXX_PAGE_SIZE - 1);
+			memset(g_page_used, 0, sizeof(g_page_used));
+			g_state = M24CXX_DATA;
+			return TRUE;
+
+		case M24CXX_DATA:
+			/* the address rolls over inside the page */
+			offset = g_address & (M24CXX_PAGE_SIZE - 1);
+			g_page[offset] = data;
+			g_page_used[offset] = TRUE;
+			g_page_written = TRUE;
+			g_address = g_page_address | ((offset + 1) & (M24CXX_PAGE_SIZE - 1));
+			return TRUE;
+
+		default:
+			return FALSE;
+	}
+}
+
+static uint8 M24CXX_read(const bool ack) {
+	uint8 data = g_memory[g_address];
+	(void)ack;
+
+	/* the address rolls over the whole memory */
+	g_address = (g_address + 1) % M24CXX_SIZE;
+	g_stats.bytes_read++;
+	return data;
+}
+
+static void M24CXX_stop(void) {
+	uint8 i;
+
+	g_state = M24CXX_IDLE;
+	if (!g_page_written)
+		return;
+
+	/* the stop condition starts the internal write cycle of the page */
+	g_page_written = FALSE;
+	for (i = 0; i < M24CXX_PAGE_SIZE; i++) {
+		if (g_page_used[i]) {
+			g_memory[g_page_address + i] = g_page[i];
+			g_stats.bytes_written++;
+		}
+	}
+	g_stats.write_cycles++;
+	g_busy_until = HOST_now() + HOST_US(M24CXX_WRITE_CYCLE_US);
+}
@@ -0,0 +1,44 @@
+/* Host build: model of a 24Cxx serial EEPROM (24C01 -> 24C16) on the TWI bus */
+
+/* Constraints:
+ * the device select bits of the slave address are memory address bits (24C16: 8 blocks of 256 bytes)
+ * a page write is committed by the stop condition, the device doesn't acknowledge its address
+ * during the following write cycle (ACK polling)
+ * a repeated start after data bytes discards the page write
+ */
+
+
+#ifndef M24CXX_H_
+#define M24CXX_H_
+
+
+#include "std_types.h"
+
+
+/* Model configurations (24C16) */
+#define M24CXX_SIZE 2048			/* memory size in bytes (max 2048) */
+#define M24CXX_PAGE_SIZE 16			/* page write buffer size */
+#define M24CXX_WRITE_CYCLE_US 5000	/* internal write cycle time */
+#define M24CXX_ADDRESS 0x50			/* TWI address of the first block */
+
+typedef struct {
+	uint32 write_cycles;			/* page writes committed */
+	uint32 bytes_written;
+	uint32 bytes_read;
+	uint32 busy_nacks;				/* addresses not acknowledged during a write cycle */
+	uint32 aborted_writes;			/* page writes discarded (no stop condition) */
+} M24CXX_Stats;
+
+
+/* Erase the memory (all 0xFF) and attach the device to the TWI bus */
+void M24CXX_init(void);
+
+/* Load / save the memory from / to a binary image file (returns FALSE on error) */
+bool M24CXX_load(const char * const path);
+bool M24CXX_save(const char * const path);
+
+/* Get the counters of the model */
+const M24CXX_Stats *M24CXX_getStats(void);
+
+
+#endif /* M24CXX_H_ */
@@ -0,0 +1,119 @@
+/* Host build: scripted inputs of the runners */
+
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+#include "host.h"
+#include "script.h"
+
+
+#define LINE_SIZE 256
+
+
+typedef struct {
+	uint64 when;
+	const SCRIPT_Command *command;		/* NULL_PTR for "end" */
+	char *args;
+} SCRIPT_Line;
+
+
+/* Global loaded script and the line to run next */
+static SCRIPT_Line *g_lines = NULL_PTR;
+static uint32 g_count = 0;
+static uint32 g_next = 0;
+
+
+static void SCRIPT_run(void *arg);
+
+
+bool SCRIPT_load(FILE * const file, const SCRIPT_Command * const commands) {
+	char buffer[LINE_SIZE];
+	char *line, *name, *end;
+	const SCRIPT_Command *command;
+	uint32 number = 0;
+	uint32 capacity = 0;
+	double ms, last_ms = 0;
+
+	while (fgets(buffer, sizeof(buffer), file) != NULL) {
+		number++;
+		if ((end = strchr(buffer, '#')) != NULL)
+			*end = '\0';
+		for (line = buffer; isspace((unsigned char)*line); line++);
+		if (*line == '\0')
+			continue;
+
+		/* time of the line */
+		ms = strtod((*line == '+') ? line + 1 : line, &end);
+		if (end == line || (*line == '+' && end == line + 1)) {
+			fprintf(stderr, "script line %lu: time expected\n", (unsigned long)number);
+			return FALSE;
+		}
+		if (*line == '+')
+			ms += last_ms;
+		last_ms = ms;
+
+		/* command name then its arguments */
+		for (name = end; isspace((unsigned char)*name); name++);
+		for (end = name; *end != '\0' && !isspace((unsigned char)*end); end++);
+		if (*end != '\0')
+			*end++ = '\0';
+		while (isspace((unsigned char)*end))
+			end++;
+		line = end + strlen(end);
+		while (line > end && isspace((unsigned char)line[-1]))
+			*--line = '\0';
+
+		for (command = commands; command->name != NULL_PTR && strcmp(command->name, name) != 0; command++);
+		if (command->name == NULL_PTR && strcmp(name, "end") != 0) {
+			fprintf(stderr, "script line %lu: unknown command \"%s\"\n", (unsigned long)number, name);
+			return FALSE;
+		}
+
+		if (g_count == capacity) {
+			capacity = capacity ? 2 * capacity : 64;
+			g_lines = realloc(g_lines, capacity * sizeof(SCRIPT_Line));
+		}
+		g_lines[g_count].when = (uint64)(ms * (F_CPU / 1000.0));
+		g_lines[g_count].command = (command->name != NULL_PTR) ? command : NULL_PTR;
+		g_lines[g_count].args = strdup(end);
+		g_count++;
+	}
+	return TRUE;
+}
+
+void SCRIPT_start(void) {
+	g_next = 0;
+	if (g_count != 0)
+		HOST_schedule(g_lines[0].when, SCRIPT_run, NULL_PTR);
+}
+
+uint8 SCRIPT_parseBytes(const char *args, uint8 * const bytes, const uint8 size) {
+	uint8 count = 0;
+	char *end;
+	unsigned long value;
+
+	while (count < size) {
+		value = strtoul(args, &end, 16);
+		if (end == args)
+			break;
+		bytes[count++] = (uint8)value;
+		args = end;
+	}
+	return count;
+}
+
+
+/* Run the lines due now then schedule the next one (a line never runs before the previous one) */
+static void SCRIPT_run(void *arg) {
+	SCRIPT_Line *line;
+	(void)arg;
+
+	while (g_next < g_count && g_lines[g_next].when <= HOST_now()) {
+		line = &g_lines[g_next++];
+		if (line->command == NULL_PTR)
+			HOST_finish();
+		line->command->f_ptr(line->args);
+	}
+	if (g_next < g_count)
+		HOST_schedule(g_lines[g_next].when, SCRIPT_run, NULL_PTR);
+}
@@ -0,0 +1,34 @@
+/* Host build: scripted inputs of the runners */
+
+/* Script format: one command per line, '#' starts a comment
+ *   <time> <command> [arguments]
+ * time is in ms since power up (N) OR since the previous command (+N)
+ * the command "end" ends the run (calls HOST_finish)
+ */
+
+
+#ifndef SCRIPT_H_
+#define SCRIPT_H_
+
+
+#include <stdio.h>
+#include "std_types.h"
+
+
+typedef struct {
+	const char *name;
+	void (*f_ptr)(const char *args);	/* called at the time of the line with the rest of the line */
+} SCRIPT_Command;
+
+
+/* Read a whole script (commands ends with a {NULL_PTR, NULL_PTR} entry), returns FALSE on error */
+bool SCRIPT_load(FILE * const file, const SCRIPT_Command * const commands);
+
+/* Schedule the commands of the loaded script */
+void SCRIPT_start(void);
+
+/* Parse hex bytes separated by spaces (returns the number of bytes, max size) */
+uint8 SCRIPT_parseBytes(const char *args, uint8 * const bytes, const uint8 size);
+
+
+#endif /* SCRIPT_H_ */
@@ -0,0 +1,201 @@
+/* Host build: decoder of the trace dumps (DUMP_TRACE answer) into a timeline */
+
+/* Usage: tracedump [capture]   (the capture is read from stdin by default)
+ * the capture holds the bytes sent by a board on its UART line: a serial port capture of the real
+ * board OR the -w file of a runner, the other frames in it are skipped
+ * Output: for each dump, its header then one line per record from the oldest:
+ *   <ms> <+us since the previous record> <event> <argument>   (">=" before the +us: at least)
+ * the time starts at the oldest record, the TIMER1 count is unwrapped with the period of the dump and
+ * the TRACE_WRAPS records (not printed): the count going down without one is a wrap whose ISR didn't
+ * run yet, the next TRACE_WRAPS record counts it again. A gap of 255 wraps or more is marked with ">=".
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "frames.h"
+#include "trace.h"
+
+
+/* Decoder configurations */
+#define TRACE_INFO_SIZE 6			/* ACK data of DUMP_TRACE */
+#define TRACE_MAX_RECORDS 256		/* records of a dump (number of records is one byte) */
+#define TRACE_MAX_WRAPS 0xFF		/* saturated count of a TRACE_WRAPS record */
+
+typedef struct {
+	uint8 count;					/* records announced by the ACK */
+	uint16 total;					/* records since TRACE_init */
+	uint32 prescaler;				/* TIMER1 clock = F_CPU / prescaler */
+	uint32 period;					/* TIMER1 counts per wrap (top + 1) */
+	TRACE_Record records[TRACE_MAX_RECORDS];
+	uint16 received;
+	uint8 next_seq;
+} TRACEDUMP_Dump;
+
+
+static bool tracedump_header(TRACEDUMP_Dump * const dump, const PROTOCOL_Frame * const frame);
+static void tracedump_records(TRACEDUMP_Dump * const dump, const PROTOCOL_Frame * const frame);
+static void tracedump_print(const TRACEDUMP_Dump * const dump);
+static void tracedump_argument(const TRACE_Record * const record);
+
+
+static const char * const g_events[] = {
+	"?", "isr_entry", "isr_exit", "uart_tx", "uart_rx", "twi_start", "twi_end",
+	"lcd_command", "lcd_data", "key_press", "key_release", "key_long_press", "wraps"
+};
+
+static const char * const g_vectors[] = {
+	"RESET", "INT0", "INT1", "TIMER2_COMP", "TIMER2_OVF", "TIMER1_CAPT", "TIMER1_COMPA",
+	"TIMER1_COMPB", "TIMER1_OVF", "TIMER0_OVF", "SPI_STC", "USART_RXC", "USART_UDRE",
+	"USART_TXC", "ADC", "EE_RDY", "ANA_COMP", "TWI", "INT2", "TIMER0_COMP", "SPM_RDY"
+};
+
+
+int main(int argc, char *argv[]) {
+	FILE *capture = stdin;
+	FRAMES_Decoder decoder;
+	static TRACEDUMP_Dump dump;
+	bool started = FALSE;
+	uint32 dumps = 0;
+	int data;
+
+	if (argc > 2) {
+		fprintf(stderr, "usage: %s [capture]\n", argv[0]);
+		return 2;
+	}
+	if (argc == 2 && (capture = fopen(argv[1], "rb")) == NULL) {
+		perror(argv[1]);
+		return 2;
+	}
+
+	memset(&decoder, 0, sizeof(decoder));
+	while ((data = fgetc(capture)) != EOF) {
+		if (!FRAMES_decode(&decoder, data))
+			continue;
+
+		/* an ACK of TRACE_INFO_SIZE bytes followed by TRACE_DATA frames starting at SEQ 0 */
+		if (decoder.frame.cmd == ACK && decoder.frame.len == TRACE_INFO_SIZE) {
+			if (started)
+				tracedump_print(&dump);
+			started = tracedump_header(&dump, &decoder.frame);
+			dumps += started;
+		}
+		else if (decoder.frame.cmd == TRACE_DATA && started) {
+			tracedump_records(&dump, &decoder.frame);
+		}
+	}
+	if (started)
+		tracedump_print(&dump);
+	if (dumps == 0) {
+		fprintf(stderr, "no trace dump found\n");
+		return 1;
+	}
+	return 0;
+}
+
+
+/* Start a dump from the ACK data (returns FALSE if it isn't a trace dump ACK) */
+static bool tracedump_header(TRACEDUMP_Dump * const dump, const PROTOCOL_Frame * const frame) {
+	static const uint16 prescalers[8] = {0, 1, 8, 64, 256, 1024, 0, 0};		/* 6, 7: external clock */
+	const uint8 *info = frame->payload;
+
+	if (prescalers[info[3] & 0x07] == 0)
+		return FALSE;
+	dump->count = info[0];
+	dump->total = info[1] | (info[2] << 8);
+	dump->prescaler = prescalers[info[3] & 0x07];
+	dump->period = (uint32)(info[4] | (info[5] << 8)) + 1;
+	dump->received = 0;
+	dump->next_seq = 0;
+	return TRUE;
+}
+
+static void tracedump_records(TRACEDUMP_Dump * const dump, const PROTOCOL_Frame * const frame) {
+	uint8 i;
+
+	if (frame->seq != dump->next_seq) {
+		fprintf(stderr, "trace frame %u missing\n", dump->next_seq);
+		dump->next_seq = frame->seq;
+	}
+	dump->next_seq++;
+	for (i = 0; i + sizeof(TRACE_Record) <= frame->len && dump->received < TRACE_MAX_RECORDS; i += sizeof(TRACE_Record)) {
+		TRACE_Record *record = &dump->records[dump->received++];
+		record->id = frame->payload[i];
+		record->arg = frame->payload[i + 1];
+		record->time = frame->payload[i + 2] | (frame->payload[i + 3] << 8);		/* little endian (AVR) */
+	}
+}
+
+static void tracedump_print(const TRACEDUMP_Dump * const dump) {
+	double tick_us = dump->prescaler * 1e6 / F_CPU;
+	uint64 ticks = 0;
+	sint64 delta = 0;				/* since the previous printed record */
+	uint32 pending = 0;				/* wraps already counted, before their ISR reported them */
+	bool saturated = FALSE;
+	uint16 i;
+
+	printf("# trace dump: %u records (%u since the start), TIMER1 clock F_CPU/%lu, period %lu counts\n",
+		dump->received, dump->total, (unsigned long)dump->prescaler, (unsigned long)dump->period);
+	if (dump->received != dump->count)
+		printf("# %u records missing\n", dump->count - dump->received);
+
+	for (i = 0; i < dump->received; i++) {
+		const TRACE_Record *record = &dump->records[i];
+		uint32 wraps = (record->id == TRACE_WRAPS) ? record->arg : 0;
+		sint64 step;
+
+		if (i != 0) {
+			if (wraps >= pending) {
+				wraps -= pending;
+				pending = 0;
+			}
+			else {
+				pending -= wraps;
+				wraps = 0;
+			}
+			step = (sint64)wraps * dump->period + record->time - dump->records[i - 1].time;
+			if (step < 0) {
+				step += dump->period;
+				pending++;
+			}
+			ticks += step;
+			delta += step;
+		}
+
+		/* the wraps record is written just before the event that noticed them, at the same time */
+		if (record->id == TRACE_WRAPS) {
+			saturated = saturated || (record->arg == TRACE_MAX_WRAPS);
+			continue;
+		}
+		printf("%10.3f %s%+9.1f %-14s ", ticks * tick_us / 1000, saturated ? ">=" : "  ", delta * tick_us,
+			(record->id < sizeof(g_events) / sizeof(g_events[0])) ? g_events[record->id] : "?");
+		tracedump_argument(record);
+		printf("\n");
+		delta = 0;
+		saturated = FALSE;
+	}
+}
+
+static void tracedump_argument(const TRACE_Record * const record) {
+	switch (record->id) {
+	case TRACE_ISR_ENTRY:
+	case TRACE_ISR_EXIT:
+		if (record->arg < sizeof(g_vectors) / sizeof(g_vectors[0]))
+			printf("%s", g_vectors[record->arg]);
+		else
+			printf("vector %u", record->arg);
+		break;
+	case TRACE_LCD_DATA:
+		printf("%02X '%c'", record->arg, (record->arg >= 0x20 && record->arg < 0x7F) ? record->arg : '.');
+		break;
+	case TRACE_KEY_PRESS:
+	case TRACE_KEY_RELEASE:
+	case TRACE_KEY_LONG_PRESS:
+		if (record->arg == '*' || record->arg == '#')
+			printf("%c", record->arg);
+		else
+			printf("%u", record->arg);
+		break;
+	default:
+		printf("%02X", record->arg);
+	}
+}